@@ -14,6 +14,27 @@ DEFINES+=SAPI_USE_INTERRUPTS
 USE_FREERTOS=y
 FREERTOS_HEAP_TYPE=4
 
+# O(1) heap: FREERTOS_HEAP_TYPE=tlsf leaves out FreeRTOS heap_N.c and builds src/heap_tlsf.c
+ifeq ($(FREERTOS_HEAP_TYPE),tlsf)
+DEFINES+=USE_HEAP_TLSF
+endif
+
+# Static construction of the frame layer (sf_t, queues, pool, timer), shrinks the heap
+#DEFINES+=SF_ESTATICO=1
+
+# Active objects drain up to AO_LOTE_MAX queued events per wakeup and trigger TX once per batch
+#DEFINES+=AO_LOTE_MAX=8
+#DEFINES+=AO_ESTADISTICAS=1
+
+# Transient active objects wait up to AO_LINGER_MAX_MS, adapted to their arrival rate, before ending, and the
+# APP_OA_TIBIOS most used formats stay alive
+#DEFINES+=AO_LINGER_MAX_MS=50
+#DEFINES+=APP_OA_TIBIOS=1
+
+# Pool geometry generated by tools/sf_pool_autotune.py (inc/sf_pool_geometria.h), or loaded at boot from the stored profile
+#DEFINES+=SF_POOL_GEOMETRIA_GENERADA
+#DEFINES+=SF_PERFIL=1
+
 # Tell SAPI to use FreeRTOS SYSTICK
 DEFINES+=TICK_OVER_RTOS
 DEFINES+=USE_FREERTOS
\ No newline at end of file
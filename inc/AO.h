@@ -19,8 +19,54 @@
 #include "separacion_frames.h"
 
 #define N_QUEUE_AO 		10
+#define AO_STACK        configMINIMAL_STACK_SIZE
+
+/* Eventos que procesa un objeto activo cada vez que despierta, antes de llamar a su flushFunc. Con 1 procesa de a uno */
+#ifndef AO_LOTE_MAX
+#define AO_LOTE_MAX     1
+#endif
+
+/* Cuenta despertares, eventos y ciclos del core en el callback de cada objeto activo, para medir eventos procesados
+   por cambio de contexto y ciclos por evento */
+#ifndef AO_ESTADISTICAS
+#define AO_ESTADISTICAS 0
+#endif
+
+/* Un objeto activo que no es inmortal espera este tiempo como máximo a que llegue otro evento antes de terminar. El
+   tiempo se adapta al ritmo con que le llegan eventos. Con 0 termina apenas se vacía su cola (R_AO_8) */
+#ifndef AO_LINGER_MAX_MS
+#define AO_LINGER_MAX_MS    0
+#endif
+#define AO_LINGER_FACTOR    2       // Veces el tiempo medio entre eventos que espera
+#define AO_EMA_SHIFT        3       // Peso de cada intervalo nuevo en el promedio: 1/8
+#define AO_EMA_FRAC         4       // Bits de fracción del promedio
+#define AO_EMA_TOPE_MS      (4 * AO_LINGER_MAX_MS) // Los intervalos más largos se cuentan como este
+
+/* Suscripciones de objetos activos a los eventos de frame publicados, ver activeObjectPublish */
+#ifndef AO_SUSCRIPCIONES_MAX
+#define AO_SUSCRIPCIONES_MAX    4
+#endif
+#define AO_OPCODE_TODOS         0   // Suscripción a los frames de cualquier opcode
+
+/* Tarea y cola de cada objeto activo en memoria propia, que se reutiliza cada vez que revive */
+#ifndef AO_ESTATICO
+#define AO_ESTATICO     1
+#endif
+
+/* Ciclo de vida de un objeto activo. Las transiciones se hacen con compare-and-swap (ver qf_atomic.h), sin
+   enmascarar interrupciones:
+   AO_MUERTO    -> AO_CREANDO   lo toma el que encola, para crear la tarea
+   AO_CREANDO   -> AO_VIVO      la tarea se creó; si falla vuelve a AO_MUERTO
+   AO_VIVO      -> AO_VACIANDO  la tarea encontró su cola vacía y va a terminar
+   AO_VACIANDO  -> AO_MUERTO    la cola seguía vacía y la tarea termina
+   AO_VACIANDO  -> AO_VIVO      llegó un evento: lo rescata la tarea o el que encola */
+#define AO_MUERTO       0U
+#define AO_CREANDO      1U
+#define AO_VIVO         2U
+#define AO_VACIANDO     3U
 
 typedef void ( *callBackActObj_t )( void* caller_ao, void* data );
+typedef void ( *flushActObj_t )( void* caller_ao );
 
 typedef struct
 {
@@ -28,18 +74,55 @@ typedef struct
     QueueHandle_t 		activeObjectQueue;
     QueueHandle_t 		responseQueue;
     callBackActObj_t 	callbackFunc;
+    flushActObj_t       flushFunc;                              // Al terminar cada lote de eventos, o NULL
     sf_t*               ptr_sf;
-    bool 				itIsAlive;
+    uint32_t volatile   state;                                  // AO_MUERTO, AO_CREANDO, AO_VIVO o AO_VACIANDO
     bool                itIsImmortal;
+    uint32_t            creations;                              // Veces que se creó la tarea
+#if AO_LINGER_MAX_MS > 0
+    TickType_t          lastArrival;                            // Tick del último evento
+    uint32_t            arrivalEma;                             // Tiempo medio entre eventos, ticks << AO_EMA_FRAC
+#endif
+#if AO_ESTADISTICAS
+    uint32_t            wakeups;                                // Veces que despertó con eventos en la cola
+    uint32_t            events;                                 // Eventos procesados
+    uint32_t            cycles;                                 // Ciclos del core dentro del callback (DWT)
+#endif
+#if AO_ESTATICO
+    TaskHandle_t        taskHandle;                             // Tarea que terminó y espera que la borre la próxima creación
+    StaticTask_t        taskBuffer;
+    StackType_t         stackBuffer[AO_STACK];
+    StaticQueue_t       queueBuffer;
+    uint8_t             queueStorage[N_QUEUE_AO * sizeof( tMensaje* )];
+#endif
 
 } activeObject_t;
 
+typedef struct
+{
+    activeObject_t*     ao;
+    uint8_t             opcode;                                 // Opcode de los frames que recibe, o AO_OPCODE_TODOS
+} aoSuscripcion_t;
+
+/* Tabla de suscripciones. Los suscriptores reciben el puntero al evento, lo leen sin modificarlo y lo sueltan con
+   objeto_evento_liberar al terminar. Se suscriben al arrancar, antes de que se publique el primer evento, y tienen que
+   estar vivos y ser inmortales: publicar encola directo, sin pasar por el ciclo de vida. */
+typedef struct
+{
+    aoSuscripcion_t     suscripciones[AO_SUSCRIPCIONES_MAX];
+    uint8_t             cantidad;
+} aoPubSub_t;
+
+void activeObjectInit( activeObject_t* ao, bool immortal );
 bool activeObjectCreate( activeObject_t* ao, callBackActObj_t callback, TaskFunction_t taskForAO );
 
 void activeObjectTask( void* pvParameters );
 
-void activeObjectEnqueue( activeObject_t* ao, void* value );
-bool activeObjectOperationCreate( activeObject_t* ao, callBackActObj_t callback, TaskFunction_t taskForAO, QueueHandle_t response_queue );
-void activeObjectQueueChange( activeObject_t* ao, QueueHandle_t activeObjectNewQueue );
+bool activeObjectPost( activeObject_t* ao, callBackActObj_t callback, TaskFunction_t taskForAO, QueueHandle_t response_queue, tMensaje* evento );
+bool activeObjectOperationCreate( activeObject_t* ao, callBackActObj_t callback, TaskFunction_t taskForAO, QueueHandle_t response_queue, QueueHandle_t event_queue );
+
+void activeObjectPubSubInit( aoPubSub_t* tabla );
+bool activeObjectSubscribe( aoPubSub_t* tabla, activeObject_t* ao, uint8_t opcode );
+uint8_t activeObjectPublish( aoPubSub_t* tabla, uint8_t opcode, tMensaje* evento );
 
 #endif /* AO_H__ */
@@ -60,7 +60,13 @@ extern int DbgConsole_Printf( const char *fmt_s, ... );
 #define configTICK_RATE_HZ                           ( ( TickType_t ) 1000 ) // 1000 ticks per second => 1ms tick rate
 #define configMAX_PRIORITIES                         ( 7 )
 #define configMINIMAL_STACK_SIZE                     ( ( uint16_t ) 90 )
+#if defined( SF_ESTATICO ) && ( SF_ESTATICO != 0 ) && defined( AO_ESTATICO ) && ( AO_ESTATICO == 0 )
+#define configTOTAL_HEAP_SIZE                        ( ( size_t ) ( 3 * 1024 ) )    /* Sólo los objetos activos, la separación de frames es estática. */
+#elif defined( SF_ESTATICO ) && ( SF_ESTATICO != 0 )
+#define configTOTAL_HEAP_SIZE                        ( ( size_t ) ( 512 ) )         /* La aplicación no usa el heap. */
+#else
 #define configTOTAL_HEAP_SIZE                        ( ( size_t ) ( 8 * 1024 ) )    /* 85 Kbytes. */
+#endif
 #define configMAX_TASK_NAME_LEN                      ( 16 )
 #define configUSE_TRACE_FACILITY                     0
 #define configUSE_16_BIT_TICKS                       0
@@ -33,6 +33,20 @@
 #define A_MINUSCULA             32  // 32 es la diferencia entre un caracter en mayúscula y uno en minúscula.
 #define A_MAYUSCULA             -32
 
+/* Cantidad de formatos (C, P y S) más usados cuyos OA siguen vivos aunque se vacíe su cola. Con 0 todos terminan
+   apenas se vacía su cola (R_AO_8) o al vencer su linger (AO_LINGER_MAX_MS) */
+#ifndef APP_OA_TIBIOS
+#define APP_OA_TIBIOS           0
+#endif
+#define APP_FORMATOS            3
+#define APP_USO_VENTANA         64  // Cada cuántos paquetes se reduce a la mitad el uso de cada formato
+
+/* Cada cuánto el OA_app guarda el perfil de los frames recibidos con sf_perfil_guardar, para ajustar la geometría
+   del pool con tools/sf_pool_autotune.py. Con 0 no lo guarda */
+#ifndef APP_PERFIL_PERIODO_MS
+#define APP_PERFIL_PERIODO_MS   60000
+#endif
+
 typedef struct 
 {
 	activeObject_t 	OA_app;
@@ -40,8 +54,22 @@ typedef struct
 	activeObject_t 	OA_P;
 	activeObject_t 	OA_S;
     sf_t* 			handler_sf;                                      ///> Handler para la capa de separación de frame
+    aoPubSub_t      suscriptores;                                    ///> OA que reciben una referencia a cada paquete
+    bool            tx_pendiente;                                    ///> Hay respuestas encoladas sin disparar la transmisión
+    uint32_t        creaciones_por_segundo;                          ///> Creaciones de OA_C, OA_P y OA_S en el último segundo
+    uint32_t        creaciones_base;                                 ///> Creaciones al empezar el segundo en curso
+    TickType_t      creaciones_inicio;                               ///> Tick al empezar el segundo en curso
+#if APP_PERFIL_PERIODO_MS > 0
+    TickType_t      perfil_inicio;                                   ///> Tick de la última vez que se guardó el perfil
+#endif
+#if APP_OA_TIBIOS > 0
+    uint16_t        uso[APP_FORMATOS];                               ///> Paquetes recientes de cada formato, para elegir los OA tibios
+    uint16_t        uso_paquetes;                                    ///> Paquetes desde la última vez que se redujo el uso
+#endif
 } app_t;
 
 bool app_crear(app_t* handler_app , sf_t* handler_sf);
+bool app_suscribir(app_t* handler_app, activeObject_t* ao, uint8_t opcode);
+uint32_t app_creaciones_por_segundo(const app_t* handler_app);
 
 #endif /* APP_H_ */ 
@@ -15,6 +15,7 @@
 
 
 void app_OAapp(void* caller_ao, void* mensaje_a_procesar );
+void app_OAapp_flush(void* caller_ao);
 void app_OAC(void* caller_ao, void* mensaje_a_procesar);
 void app_OAP(void* caller_ao, void* mensaje_a_procesar);
 void app_OAS(void* caller_ao, void* mensaje_a_procesar);
@@ -0,0 +1,66 @@
+/*=============================================================================
+ * Copyright (c) 2021, Fernando Prokopiuk <fernandoprokopiuk@gmail.com>
+ * 					   Jonathan Cagua <jonathan.cagua@gmail.com>
+ * 					   Leandro Arrieta <leandroarrieta@gmail.com>
+ * All rights reserved.
+ * License: Free
+ * Date: 18/10/2026
+ * Version: v1.0
+ *===========================================================================*/
+
+#ifndef APP_CLASIFICAR_H_
+#define APP_CLASIFICAR_H_
+
+/*
+ * Clasificación de caracteres de a 4 bytes por palabra de 32 bits (SWAR).
+ *
+ * Recibe 4 caracteres empaquetados en un uint32_t, el primero en el byte menos significativo, y devuelve una
+ * máscara con el bit 7 de cada byte en 1 si el caracter pertenece a la clase.
+ *
+ * En el LPC4337 (Cortex-M4) se usan las instrucciones SIMD de la extensión DSP (__USUB8 y __SEL).
+ * En cualquier otra arquitectura, por ejemplo al compilar para Linux, se usan operaciones de bits portables.
+ * Se puede forzar la versión portable definiendo APP_SWAR_PORTABLE.
+ */
+
+#include <stdint.h>
+
+#if defined(__ARM_FEATURE_SIMD32) && (__ARM_FEATURE_SIMD32 == 1) && !defined(APP_SWAR_PORTABLE)
+#include "chip.h"
+#define APP_SWAR_SIMD           1
+#else
+#define APP_SWAR_SIMD           0
+#endif
+
+#define APP_SWAR_BYTES          4
+#define APP_SWAR_REP(b)         ((uint32_t)(b) * 0x01010101UL)  // Repite el byte b en los 4 bytes de la palabra
+#define APP_SWAR_BIT7           APP_SWAR_REP(0x80)
+#define APP_SWAR_BITS_0_6       APP_SWAR_REP(0x7F)
+
+/**
+ * @brief Marca los bytes de w que están entre min y max, inclusive.
+ *
+ * @param w     4 caracteres.
+ * @param min   Límite inferior, menor a 0x80.
+ * @param max   Límite superior, menor a 0x80.
+ * @return uint32_t Bit 7 en 1 en cada byte dentro del rango.
+ */
+static inline uint32_t app_swar_rango( uint32_t w, uint8_t min, uint8_t max )
+{
+#if APP_SWAR_SIMD
+    uint32_t mayor_igual_min;
+
+    (void)__USUB8( w, APP_SWAR_REP(min) );                  // GE[i] = (w[i] >= min)
+    mayor_igual_min = __SEL( APP_SWAR_BIT7, 0 );
+    (void)__USUB8( APP_SWAR_REP(max), w );                  // GE[i] = (max >= w[i])
+    return __SEL( mayor_igual_min, 0 );
+#else
+    /* Con el bit 7 en 0, sumar (0x80 - k) prende el bit 7 sólo si el byte es >= k, sin acarreo al byte siguiente */
+    uint32_t bajos = w & APP_SWAR_BITS_0_6;
+    uint32_t mayor_igual_min = bajos + APP_SWAR_REP(0x80 - min);
+    uint32_t mayor_max = bajos + APP_SWAR_REP(0x7F - max);
+
+    return mayor_igual_min & ~mayor_max & ~w & APP_SWAR_BIT7;
+#endif
+}
+
+#endif /* APP_CLASIFICAR_H_ */
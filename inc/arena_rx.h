@@ -0,0 +1,62 @@
+/*=============================================================================
+ * Copyright (c) 2021, Fernando Prokopiuk <fernandoprokopiuk@gmail.com>
+ * 					   Jonathan Cagua <jonathan.cagua@gmail.com>
+ * 					   Leandro Arrieta <leandroarrieta@gmail.com>
+ * All rights reserved.
+ * License: Free
+ * Date: 18/10/2026
+ * Version: v1.0
+ *===========================================================================*/
+
+#ifndef ARENA_RX_H_
+#define ARENA_RX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef ARENA_FRAMES_MAX
+#define ARENA_FRAMES_MAX        32  // Cantidad máxima de frames entregados y todavía no liberados
+#endif
+
+/* Frame entregado, ocupa la arena desde inicio hasta inicio + tam */
+typedef struct
+{
+    uint16_t inicio;                       ///< Offset del frame en la arena.
+    uint16_t tam;                          ///< Bytes reservados para el frame.
+    bool liberado;                         ///< Se liberó pero todavía hay frames más viejos ocupados.
+} arena_frame_t;
+
+typedef struct
+{
+    uint32_t ocupados;                     ///< Bytes reservados por los frames entregados.
+    uint32_t ocupados_max;                 ///< Máximo de bytes reservados al mismo tiempo.
+    uint32_t vueltas;                      ///< Frames que se movieron al principio de la arena por no entrar al final.
+    uint32_t bytes_movidos;                ///< Bytes copiados al dar la vuelta.
+    uint32_t fuera_de_orden;               ///< Frames liberados antes que alguno más viejo.
+    uint32_t sin_lugar;                    ///< Frames descartados por falta de lugar.
+} arena_estadisticas_t;
+
+/*
+ * Arena circular: los frames se escriben uno detrás del otro y se liberan en orden FIFO. Un frame liberado
+ * antes que otro más viejo queda marcado y su lugar se recupera cuando se liberan todos los anteriores.
+ * Cada frame ocupa un segmento contiguo; si no entra al final de la arena se mueve al principio.
+ */
+typedef struct
+{
+    uint8_t* memoria;                      ///< Segmento de memoria de la arena.
+    uint32_t tam;                          ///< Tamaño del segmento en bytes.
+    uint32_t cabeza;                       ///< Offset donde empieza el frame en recepción.
+    arena_frame_t frames[ARENA_FRAMES_MAX]; ///< Frames entregados, del más viejo al más nuevo a partir de primero.
+    uint8_t primero;                       ///< Índice del frame más viejo.
+    uint8_t cant_frames;                   ///< Cantidad de frames entregados sin liberar.
+    arena_estadisticas_t estadisticas;     ///< Ocupación y vueltas, para dimensionar la arena.
+} arena_t;
+
+bool arena_init(arena_t* me, void* memoria, uint32_t tam);
+uint32_t arena_disponible(arena_t* me);
+uint8_t* arena_frame_iniciar(arena_t* me, uint32_t minimo);
+uint8_t* arena_frame_asegurar(arena_t* me, uint32_t cantidad, uint32_t minimo);
+void arena_frame_cerrar(arena_t* me, uint32_t tam);
+void arena_frame_liberar(arena_t* me, void* frame);
+
+#endif /* ARENA_RX_H_ */
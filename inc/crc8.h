@@ -19,6 +19,16 @@
 
 /*
  * CRC8-CCITT, with normal polynomial; 0x07.
+ *
+ * The engine used by crc8_calc() is selected at compile time with
+ * CRC8_ENGINE (e.g. DEFINES+=CRC8_ENGINE=CRC8_ENGINE_SLICE4 in config.mk):
+ *
+ *  CRC8_ENGINE_NIBBLE  two 16-entry lookups per byte (16 bytes of flash).
+ *  CRC8_ENGINE_TABLE   one 256-entry lookup per byte (256 bytes of flash).
+ *  CRC8_ENGINE_SLICE4  4 bytes per iteration, 4 tables (1 Kbyte of flash).
+ *  CRC8_ENGINE_SLICE8  8 bytes per iteration, 8 tables (2 Kbytes of flash).
+ *
+ * All engines produce bit-exact the same result.
  */
 
 #ifndef CRC8_H_
@@ -26,12 +36,22 @@
 
 #include <inttypes.h>
 
+#define CRC8_ENGINE_NIBBLE  0
+#define CRC8_ENGINE_TABLE   1
+#define CRC8_ENGINE_SLICE4  2
+#define CRC8_ENGINE_SLICE8  3
+
+#ifndef CRC8_ENGINE
+#define CRC8_ENGINE         CRC8_ENGINE_TABLE
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 uint8_t crc8_init(void);
 uint8_t crc8_calc(uint8_t val, void *buf, int cnt);
+uint8_t crc8_update(uint8_t val, uint8_t byte);
 
 #ifdef __cplusplus
 }
@@ -20,15 +20,24 @@
 #include "FreeRTOSConfig.h"
 
 /*==================[definiciones y macros]==================================*/
-#define N_QUEUE	10
+#ifndef N_QUEUE
+#define N_QUEUE	32      // Tiene que alcanzar para todos los eventos de separacion_frames (SF_EVENTOS y SF_RESPUESTAS_CORTAS)
+#endif
 #define PAQUETE     1
 #define RESPUESTA   2
 
-typedef struct
+/*
+ * Evento que viaja por las colas. Por las colas pasa sólo el puntero, el evento lo reserva quien lo crea y se
+ * recicla con el destructor cuando el último que lo tiene suelta su referencia.
+ */
+typedef struct tMensaje
 {
-	uint32_t evento_tipo;
-	uint32_t cantidad;
 	uint8_t* ptr_datos;
+	uint16_t cantidad;
+	uint16_t referencias;                          // Consumidores que todavía tienen el evento
+	uint8_t evento_tipo;
+	void (*destructor)(struct tMensaje* evento);   // Recicla el evento y sus datos, en contexto de tarea
+	void* contexto;                                // Dueño del evento, para el destructor
 }tMensaje;
 
 typedef struct
@@ -36,11 +45,23 @@ typedef struct
     QueueHandle_t cola;
 } tObjeto;
 
+/* Objeto con la cola en memoria estática, se crea con objeto_crear_estatico y no se borra */
+typedef struct
+{
+    tObjeto objeto;
+    StaticQueue_t cola;
+    uint8_t almacenamiento[N_QUEUE * sizeof(tMensaje*)];
+} tObjetoEstatico;
+
 tObjeto* objeto_crear();
-void objeto_post( tObjeto* objeto,tMensaje mensaje );
-void objeto_post_fromISR( tObjeto* objeto,tMensaje mensaje, BaseType_t *pxHigherPriorityTaskWoken );
-void objeto_get( tObjeto* objeto,tMensaje* mensaje );
-bool objeto_get_fromISR( tObjeto* objeto,tMensaje* mensaje, BaseType_t *pxHigherPriorityTaskWoken );
+tObjeto* objeto_crear_estatico( tObjetoEstatico* memoria );
+void objeto_post( tObjeto* objeto,tMensaje* mensaje );
+bool objeto_post_fromISR( tObjeto* objeto,tMensaje* mensaje, BaseType_t *pxHigherPriorityTaskWoken );
+void objeto_get( tObjeto* objeto,tMensaje** mensaje );
+bool objeto_get_fromISR( tObjeto* objeto,tMensaje** mensaje, BaseType_t *pxHigherPriorityTaskWoken );
+void objeto_evento_retener( tMensaje* evento );
+bool objeto_evento_soltar( tMensaje* evento );
+void objeto_evento_liberar( tMensaje* evento );
 void objeto_borrar( tObjeto* objeto);
 
 #endif /* OBJETO_H_ */
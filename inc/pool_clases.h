@@ -0,0 +1,42 @@
+/*=============================================================================
+ * Copyright (c) 2021, Fernando Prokopiuk <fernandoprokopiuk@gmail.com>
+ * 					   Jonathan Cagua <jonathan.cagua@gmail.com>
+ * 					   Leandro Arrieta <leandroarrieta@gmail.com>
+ * All rights reserved.
+ * License: Free
+ * Date: 18/10/2026
+ * Version: v1.0
+ *===========================================================================*/
+
+#ifndef POOL_CLASES_H_
+#define POOL_CLASES_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "qmpool.h"
+
+#define POOL_CLASES_MAX         4   // Cantidad máxima de clases de tamaño
+
+/*
+ * Conjunto de pools de memoria (QMPool) con distinto tamaño de bloque, ordenados de menor a mayor.
+ * Todos se arman sobre un mismo segmento de memoria, así que la clase de un bloque se obtiene por su dirección.
+ */
+typedef struct
+{
+    QMPool pool[POOL_CLASES_MAX];          ///< Un pool por clase, de menor a mayor tamaño de bloque.
+    uint8_t cant_clases;                   ///< Cantidad de clases usadas.
+} pool_clases_t;
+
+bool pool_clases_init(pool_clases_t* me, void* memoria, uint32_t tam_memoria,
+                      const uint16_t* tam_bloque, const uint16_t* cant_bloques, uint8_t cant_clases);
+void* pool_clases_get(pool_clases_t* me, uint8_t clase_min, QMPoolMag* mags, uint8_t* clase);
+void pool_clases_put(pool_clases_t* me, void* bloque, QMPoolMag* mags);
+uint8_t pool_clases_clase(pool_clases_t* me, void* bloque);
+uint16_t pool_clases_tam(pool_clases_t* me, uint8_t clase);
+#if (QF_MPOOL_TELEMETRY != 0)
+void pool_clases_dueno(pool_clases_t* me, const void* bloque, uint8_t dueno);
+#else
+#define pool_clases_dueno(me, bloque, dueno)    ((void)0)
+#endif
+
+#endif /* POOL_CLASES_H_ */
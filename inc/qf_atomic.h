@@ -0,0 +1,123 @@
+/**
+* @file
+* @brief Compare-and-swap primitives for the lock-free ::QMPool.
+*
+* @description
+* On ARMv7-M (Cortex-M3/M4) the primitives are built on the exclusive
+* access instructions LDREX/STREX, so they never mask interrupts. An
+* exception between LDREX and STREX clears the exclusive monitor, the
+* STREX fails and the operation is retried. Since the LPC4337 runs the
+* application on a single core, no memory barriers are needed.
+*
+* On any other target (e.g. a host build on Linux) the GCC/Clang
+* __atomic builtins are used, which follow the C11 memory model.
+*/
+#ifndef qf_atomic_h
+#define qf_atomic_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#include "chip.h"       /* CMSIS __LDREXW/__STREXW/__LDREXH/__STREXH/__CLREX */
+
+/*! Atomically replaces *p with @p nuevo if *p equals @p esperado. */
+static inline bool qf_atomic_cas32( uint32_t volatile *p,
+                                    uint32_t esperado, uint32_t nuevo )
+{
+    do
+    {
+        if ( __LDREXW( p ) != esperado )
+        {
+            __CLREX();
+            return false;
+        }
+    } while ( __STREXW( nuevo, p ) != 0U );
+    return true;
+}
+
+/*! Atomically replaces *p with @p nuevo if *p equals @p esperado. */
+static inline bool qf_atomic_cas16( uint16_t volatile *p,
+                                    uint16_t esperado, uint16_t nuevo )
+{
+    do
+    {
+        if ( __LDREXH( p ) != esperado )
+        {
+            __CLREX();
+            return false;
+        }
+    } while ( __STREXH( nuevo, p ) != 0U );
+    return true;
+}
+
+#else
+
+/*! Atomically replaces *p with @p nuevo if *p equals @p esperado. */
+static inline bool qf_atomic_cas32( uint32_t volatile *p,
+                                    uint32_t esperado, uint32_t nuevo )
+{
+    return __atomic_compare_exchange_n( p, &esperado, nuevo, false,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST );
+}
+
+/*! Atomically replaces *p with @p nuevo if *p equals @p esperado. */
+static inline bool qf_atomic_cas16( uint16_t volatile *p,
+                                    uint16_t esperado, uint16_t nuevo )
+{
+    return __atomic_compare_exchange_n( p, &esperado, nuevo, false,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST );
+}
+
+#endif
+
+/*! Atomically adds @p delta to *p and returns the new value. */
+static inline uint16_t qf_atomic_add16( uint16_t volatile *p, int16_t delta )
+{
+    uint16_t viejo;
+    do
+    {
+        viejo = *p;
+    } while ( !qf_atomic_cas16( p, viejo, ( uint16_t )( viejo + delta ) ) );
+    return ( uint16_t )( viejo + delta );
+}
+
+/*! Atomically adds @p delta to *p. */
+static inline void qf_atomic_add32( uint32_t volatile *p, uint32_t delta )
+{
+    uint32_t viejo;
+    do
+    {
+        viejo = *p;
+    } while ( !qf_atomic_cas32( p, viejo, viejo + delta ) );
+}
+
+/*! Atomically raises *p to @p v if @p v is greater. */
+static inline void qf_atomic_max16( uint16_t volatile *p, uint16_t v )
+{
+    uint16_t viejo;
+    do
+    {
+        viejo = *p;
+        if ( viejo >= v )
+        {
+            return;
+        }
+    } while ( !qf_atomic_cas16( p, viejo, v ) );
+}
+
+/*! Atomically lowers *p to @p v if @p v is smaller. */
+static inline void qf_atomic_min16( uint16_t volatile *p, uint16_t v )
+{
+    uint16_t viejo;
+    do
+    {
+        viejo = *p;
+        if ( viejo <= v )
+        {
+            return;
+        }
+    } while ( !qf_atomic_cas16( p, viejo, v ) );
+}
+
+#endif /* qf_atomic_h */
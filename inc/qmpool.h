@@ -40,6 +40,8 @@
 #ifndef qmpool_h
 #define qmpool_h
 
+#include <stdint.h>
+
 /****************************************************************************/
 /*! structure representing a free block in the Native QF Memory Pool */
 typedef struct QFreeBlock
@@ -103,6 +105,96 @@ typedef uint32_t QMPoolCtr;
 #endif
 
 /****************************************************************************/
+#ifndef QF_MPOOL_LOCKFREE
+/*! macro to select the lock-free ::QMPool implementation, which never
+* masks interrupts (see qf_atomic.h). Valid values 0 or 1; default 0
+*/
+#define QF_MPOOL_LOCKFREE 0
+#endif
+#ifndef QF_MPOOL_LAZY
+/*! macro to select lazy carving: QMPool_init() does not link the blocks,
+* which are carved from the never used storage on demand, so the pool
+* initialization takes constant time. Valid values 0 or 1; default 0
+*/
+#define QF_MPOOL_LAZY 0
+#endif
+#ifndef QF_MPOOL_TELEMETRY
+/*! macro to enable the pool telemetry: get/put/failure counters, the
+* owner stage of each block and a histogram of the block hold times
+* (see ::QMPoolTelemetry). Valid values 0 or 1; default 0
+*/
+#define QF_MPOOL_TELEMETRY 0
+#endif
+#if (QF_MPOOL_CTR_SIZE != 2)
+#error "QMPool counters are updated with 16-bit atomics, QF_MPOOL_CTR_SIZE must be 2"
+#endif
+#if (QF_MPOOL_LOCKFREE != 0)
+
+/*! free list index that marks the end of the list */
+#define QF_MPOOL_NULL_IDX   0xFFFFU
+#endif
+
+#if (QF_MPOOL_TELEMETRY != 0)
+#ifndef QF_MPOOL_OWNERS
+/*! macro to override the number of owner stages tracked; default 8 */
+#define QF_MPOOL_OWNERS 8U
+#endif
+
+#ifndef QF_MPOOL_HIST_BINS
+/*! macro to override the number of bins of the hold time histogram; bin
+* 0 counts the blocks held less than one QF_MPOOL_TIMESTAMP() unit and bin
+* i the ones held from 2^(i-1) to 2^i - 1 units; default 16
+*/
+#define QF_MPOOL_HIST_BINS 16U
+#endif
+
+#ifndef QF_MPOOL_TIMESTAMP
+/*! time base of the hold time histogram, called from tasks and ISRs;
+* default the RTOS tick, it can be defined as a cycle counter for a finer
+* resolution
+*/
+#define QF_MPOOL_TIMESTAMP() ( ( uint32_t )xTaskGetTickCountFromISR() )
+#endif
+
+/*! owner of a block that is free (in the pool or in a magazine) */
+#define QF_MPOOL_OWNER_FREE 0xFFU
+
+/*! Telemetry of a block, see QMPool_attachInfo() */
+typedef struct
+{
+    /*! QF_MPOOL_TIMESTAMP() when the block was taken from the pool */
+    uint32_t stamp;
+
+    /*! current owner stage, 0 when it is taken from the pool */
+    uint8_t owner;
+} QMPoolBlockInfo;
+
+/*! Telemetry of a memory pool */
+typedef struct
+{
+    /*! number of blocks obtained */
+    uint32_t volatile nGet;
+
+    /*! number of blocks recycled */
+    uint32_t volatile nPut;
+
+    /*! number of requests that could not be satisfied */
+    uint32_t volatile nFail;
+
+    /*! histogram of the hold times, from get to put (log2 bins) */
+    uint32_t volatile holdHist[QF_MPOOL_HIST_BINS];
+
+    /*! number of blocks held by each owner stage */
+    QMPoolCtr volatile nOwned[QF_MPOOL_OWNERS];
+
+    /*! maximum number of blocks ever held by each owner stage */
+    QMPoolCtr volatile nOwnedMax[QF_MPOOL_OWNERS];
+
+    /*! per block telemetry, NULL if only the counters are kept */
+    QMPoolBlockInfo *info;
+} QMPoolTelemetry;
+#endif
+
 /*! Native QF Memory Pool */
 /**
 * @description
@@ -126,8 +218,17 @@ typedef uint32_t QMPoolCtr;
 */
 typedef struct
 {
+#if (QF_MPOOL_LOCKFREE != 0)
+    /*! The head of the linked list of free blocks: index of the first
+    * free block in the low 16 bits and, in the high 16 bits, a tag that
+    * changes on every update so a stale compare-and-swap fails (ABA).
+    * Free blocks are linked by index too, in their first 16 bits.
+    */
+    uint32_t volatile free_head;
+#else
     /*! The head of the linked list of free blocks */
     void * volatile free_head;
+#endif
 
     /*! the original start this pool */
     void *start;
@@ -144,6 +245,17 @@ typedef struct
     /*! number of free blocks remaining */
     QMPoolCtr volatile nFree;
 
+    /*! number of free blocks held in magazines (see ::QMPoolMag) */
+    QMPoolCtr volatile nMag;
+
+#if (QF_MPOOL_LAZY != 0)
+    /*! number of blocks carved so far; the blocks from this index on
+    * have never been used and are not in the free list, but they are
+    * counted in nFree
+    */
+    QMPoolCtr volatile nCarved;
+#endif
+
     /*! minimum number of free blocks ever present in this pool */
     /**
     * @description
@@ -152,8 +264,35 @@ typedef struct
     * @sa QF_getPoolMin().
     */
     QMPoolCtr nMin;
+
+#if (QF_MPOOL_TELEMETRY != 0)
+    /*! counters, owners and hold times of the blocks */
+    QMPoolTelemetry telemetry;
+#endif
 } QMPool;
 
+#ifndef QF_MPOOL_MAG_SIZE
+/*! macro to override the default capacity of a ::QMPoolMag; default 4 */
+#define QF_MPOOL_MAG_SIZE 4U
+#endif
+
+/*! Magazine: free blocks cached by one execution context */
+/**
+* @description
+* A context that gets and puts blocks often (e.g. an ISR) keeps a few free
+* blocks in its own magazine and only goes to the pool, in bulk, when the
+* magazine runs empty or full. The blocks in a magazine are still counted
+* as free by the pool.
+*/
+typedef struct
+{
+    /*! cached free blocks */
+    void *blocks[QF_MPOOL_MAG_SIZE];
+
+    /*! number of cached blocks */
+    unsigned short n;
+} QMPoolMag;
+
 /* public functions: */
 
 /*! Initializes the native QF memory pool */
@@ -167,9 +306,36 @@ void *QMPool_get( QMPool * const me, unsigned short const margin );
 void QMPool_put( QMPool * const me, void *b );
 
 
+/*! Obtains up to @p n memory blocks from a memory pool in one operation. */
+unsigned short QMPool_getN( QMPool * const me, void **blocks,
+                            unsigned short n, unsigned short const margin );
+
+/*! Recycles @p n memory blocks back to a memory pool in one operation. */
+void QMPool_putN( QMPool * const me, void * const *blocks, unsigned short n );
+
+/*! Obtains a memory block through a magazine. */
+void *QMPool_magGet( QMPool * const me, QMPoolMag * const mag,
+                     unsigned short const margin );
+
+/*! Recycles a memory block into a magazine. */
+void QMPool_magPut( QMPool * const me, QMPoolMag * const mag, void *b );
+
+/*! Returns all the blocks of a magazine to the memory pool. */
+void QMPool_magFlush( QMPool * const me, QMPoolMag * const mag );
+
 /*! Returns the minimum number of unused blocks in the given event pool. */
 unsigned short QMPool_getMin( QMPool * const me );
 
+#if (QF_MPOOL_TELEMETRY != 0)
+/*! Provides the storage for the per block telemetry, one per block. */
+void QMPool_attachInfo( QMPool * const me, QMPoolBlockInfo * const info );
+
+/*! Records the owner stage of a block taken from the pool. */
+void QMPool_setOwner( QMPool * const me, void const * const b, uint8_t const owner );
+#else
+#define QMPool_setOwner( me_, b_, owner_ ) ( ( void )0 )
+#endif
+
 /*! Memory pool element to allocate correctly aligned storage
 * for QMPool class.
 */
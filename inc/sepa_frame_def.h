@@ -11,13 +11,20 @@
 #ifndef SEPA_FRAME_DEF_H_
 #define SEPA_FRAME_DEF_H_
 
+/* Geometría del pool generada por tools/sf_pool_autotune.py a partir del perfil de frames recibidos */
+#ifdef SF_POOL_GEOMETRIA_GENERADA
+#include "sf_pool_geometria.h"
+#endif
+
 #define MSG_MAX_SIZE            200     // R_C2_2
 #define SOM_BYTE                '('
 #define EOM_BYTE                ')'
 #define INDICE_INICIO_MENSAJE   5       // El mensaje para la aplicación comienza en el 5to byte
 #define INDICE_INICIO_ID        1
 #define CANT_BYTE_FUERA_CRC     4
+#ifndef POOL_SIZE
 #define POOL_SIZE             	2000
+#endif
 #define UART_IE                 true
 
 #define ASCII_9                 '9'
@@ -43,4 +50,125 @@
 #define TIMEOUT_MS              4 // R_C2_19
 #define TIMEOUT                 pdMS_TO_TICKS(TIMEOUT_MS)
 
+#ifndef TIMEOUT_US
+#define TIMEOUT_US              (TIMEOUT_MS * 1000UL)   // Timeout entre bytes en us, puede ser menor a un tick
+#endif
+
+/* Modos de detección del timeout entre bytes (R_C2_17) */
+#define SF_TIMEOUT_TIMER        0   // Timer de software reiniciado con cada byte recibido
+#define SF_TIMEOUT_TIMESTAMP    1   // Marca de tiempo por byte, comparada al llegar el byte siguiente
+
+#ifndef SF_TIMEOUT_MODO
+#define SF_TIMEOUT_MODO         SF_TIMEOUT_TIMESTAMP
+#endif
+
+/* Estados del separador de frames, ver sf_transicion en separacion_frames.c */
+#define SF_ESTADO_ESPERA        0   // Esperando el SOM
+#define SF_ESTADO_ID_0          1   // Se recibió el SOM
+#define SF_ESTADO_ID_1          2   // Se recibieron 1, 2 o 3 bytes del ID
+#define SF_ESTADO_ID_2          3
+#define SF_ESTADO_ID_3          4
+#define SF_ESTADO_ID_4          5   // ID completo
+#define SF_ESTADO_DATOS         6   // El último byte no es ASCII hexa
+#define SF_ESTADO_CRC_H         7   // El último byte es ASCII hexa, puede ser el primer dígito del CRC
+#define SF_ESTADO_CRC_L         8   // Los dos últimos bytes son ASCII hexa, pueden ser el CRC
+#define SF_ESTADO_EOM           9   // Se recibió el EOM detrás de un CRC con formato válido
+#define SF_CANT_ESTADOS         10
+
+/* Clases de byte recibido */
+#define SF_CLASE_OTRO           0
+#define SF_CLASE_HEX            1   // ASCII entre 0 y 9 o A y F
+#define SF_CLASE_SOM            2
+#define SF_CLASE_EOM            3
+#define SF_CANT_CLASES          4
+
+/* Recepción en ráfagas: cada interrupción de RX vacía la FIFO de la UART */
+#define SF_RX_RAFAGA_MAX        16  // Profundidad de la FIFO de RX de la UART
+
+#ifndef SF_RX_ESTADISTICAS
+#define SF_RX_ESTADISTICAS      1   // Histograma de bytes leídos por interrupción de RX, para ajustar SF_RX_FIFO_NIVEL
+#endif
+/* Histograma de largo de los frames recibidos y máximo de bloques en uso, para ajustar la geometría del pool
+   (ver sf_perfil.h y tools/sf_pool_autotune.py) */
+#define SF_HIST_LARGO_PASO      8   // Bytes por intervalo del histograma
+#define SF_HIST_LARGO_BINS      (MSG_MAX_SIZE / SF_HIST_LARGO_PASO + 1)
+
+/* Nivel de disparo de la FIFO de RX: UART_FCR_TRG_LEV0, 1, 2 o 3 (1, 4, 8 o 14 bytes). Sin definir queda el de la sAPI */
+// #define SF_RX_FIFO_NIVEL     UART_FCR_TRG_LEV2
+
+#define SF_TX_FIFO_MAX          16  // Profundidad de la FIFO de TX de la UART
+
+/* Validación diferida: la ISR de RX sólo separa frames y una tarea de alta prioridad valida ID y CRC */
+#ifndef SF_VALIDACION_DIFERIDA
+#define SF_VALIDACION_DIFERIDA  0
+#endif
+#define SF_VALIDADOR_PRIORIDAD  (configMAX_PRIORITIES - 1)
+#define SF_VALIDADOR_STACK      (configMINIMAL_STACK_SIZE * 2)
+
+/* Clases de tamaño del pool de memoria (ver pool_clases.h). Cada frame empieza en un bloque de la clase más chica y
+   pasa a uno más grande sólo si no entra. La última clase tiene que ser de MSG_MAX_SIZE, y la suma de los bloques
+   redondeados a múltiplos de puntero no puede superar POOL_SIZE. Con 6 bloques de MSG_MAX_SIZE una ráfaga de frames
+   largos retiene 6 frames (10 con un solo tamaño), una de frames de 12 a 200 bytes 12 y una de 12 a 40 bytes 22
+   (test/test_sf_mezcla.c). */
+#ifndef SF_POOL_CANT_CLASES
+#define SF_POOL_CANT_CLASES     3
+#define SF_POOL_TAMANIOS        { 40, 56, MSG_MAX_SIZE }
+#define SF_POOL_CANTIDADES      { 8, 8, 6 }
+#define SF_POOL_BLOQUES         (8 + 8 + 6)     // Total de bloques, igual a la suma de SF_POOL_CANTIDADES
+#endif
+/* Las ISR de RX y TX toman y devuelven los bloques a través de su magazine (mag_uart), así la mayoría de los frames
+   no entra a una sección crítica del pool. En 0 van directo al pool, para comparar (test/test_sf_framer.c bench). */
+#ifndef SF_MAG_UART
+#define SF_MAG_UART             1
+#endif
+/* Al arrancar se toma la geometría del pool del perfil guardado (sf_perfil_cargar), si es válida. Si no, se usan
+   las clases de arriba. La geometría del perfil tiene que entrar en POOL_SIZE. */
+#ifndef SF_PERFIL
+#define SF_PERFIL               0
+#endif
+/* La respuesta se arma sobre el mismo bloque y puede ser más larga que el pedido: snake_case agrega hasta
+   CANT_PALABRAS_MAX - 1 guiones bajos. Un frame pasa a la clase siguiente al llegar a tamaño de bloque - margen. */
+#define SF_MARGEN_RESPUESTA     16
+
+/* Eventos de frame que pueden estar en las colas al mismo tiempo: uno por frame recibido hasta que termina de
+   transmitirse la respuesta. Con menos eventos que bloques los frames que sobran se descartan como sin cola. Junto
+   con las respuestas cortas tienen que entrar en una cola de N_QUEUE, así nunca falla un envío a una cola. */
+#ifndef SF_EVENTOS
+#define SF_EVENTOS              (N_QUEUE - SF_RESPUESTAS_CORTAS)
+#endif
+
+/* Respuestas cortas (los errores) en eventos propios, con el bloque dentro del evento. Se usan cuando los
+   suscriptores todavía leen el frame y no hay bloque para copiarlo, así la aplicación responde sin esperarlos. */
+#ifndef SF_RESPUESTAS_CORTAS
+#define SF_RESPUESTAS_CORTAS    4
+#endif
+#define SF_CORTO_DATOS          3   // Datos de una respuesta corta: E0x
+#define SF_CORTO_BLOQUE         (INDICE_INICIO_MENSAJE + SF_CORTO_DATOS + LEN_CRC + LEN_EOM)
+
+/* Etapas que pueden tener un bloque del pool, para la telemetría del pool (QF_MPOOL_TELEMETRY en qmpool.h) */
+#define SF_DUENO_RX             0   // En recepción, el pool asigna el dueño 0 al entregar el bloque
+#define SF_DUENO_VALIDADOR      1   // En la cola de la tarea validadora
+#define SF_DUENO_APP            2   // En la cola hacia la aplicación
+#define SF_DUENO_OBJETO_C       3   // En el objeto activo de camelCase
+#define SF_DUENO_OBJETO_P       4   // En el objeto activo de PascalCase
+#define SF_DUENO_OBJETO_S       5   // En el objeto activo de snake_case
+#define SF_DUENO_TX             6   // En la cola de TX o transmitiéndose
+#define SF_TELEMETRIA           ((QF_MPOOL_TELEMETRY != 0) && !SF_RX_ARENA) // Sólo para los bloques del pool
+
+/* Recepción sobre una arena circular (ver arena_rx.h) en lugar de bloques del pool: los frames se escriben uno
+   detrás del otro en el segmento de POOL_SIZE bytes y la recepción nunca se detiene por falta de memoria, si no
+   hay lugar se descarta el frame. */
+#ifndef SF_RX_ARENA
+#define SF_RX_ARENA             0
+#endif
+
+/* Construcción estática: sf_crear toma la estructura de un arreglo de SF_INSTANCIAS y las colas, el pool, el timer
+   y la tarea validadora quedan dentro de ella (sf_memoria_t), sin usar el heap de FreeRTOS. */
+#ifndef SF_ESTATICO
+#define SF_ESTATICO             0
+#endif
+#ifndef SF_INSTANCIAS
+#define SF_INSTANCIAS           1
+#endif
+
 #endif
@@ -15,32 +15,117 @@
 #include "crc8.h"
 #include "objeto.h"
 #include "qmpool.h"
+#include "pool_clases.h"
+#include "arena_rx.h"
 #include "timers.h"
 #include "sepa_frame_def.h"
 
+/* Todos los eventos, los de frame y las respuestas cortas, pueden estar a la vez en la misma cola */
+#if (SF_EVENTOS + SF_RESPUESTAS_CORTAS) > N_QUEUE
+#error "SF_EVENTOS + SF_RESPUESTAS_CORTAS no entran en una cola de N_QUEUE"
+#endif
+
+#if SF_ESTATICO
+/* Memoria de una instancia en construcción estática */
+typedef struct
+{
+    union
+    {
+        uint8_t bytes[POOL_SIZE];
+        uint64_t alineacion;               ///< Los bloques tienen que quedar alineados a puntero.
+    } pool;                                ///< Segmento del pool de memoria o de la arena.
+    tObjetoEstatico objeto1;
+    tObjetoEstatico objeto2;
+#if SF_VALIDACION_DIFERIDA
+    tObjetoEstatico objeto_validar;
+    StaticTask_t validador_tcb;
+    StackType_t validador_stack[SF_VALIDADOR_STACK];
+#endif
+#if (SF_TIMEOUT_MODO == SF_TIMEOUT_TIMER)
+    StaticTimer_t timerRx;
+#endif
+#if SF_TELEMETRIA
+    QMPoolBlockInfo info_bloques[SF_POOL_BLOQUES];
+#endif
+} sf_memoria_t;
+#endif
+
+/* Respuesta corta: el evento y su bloque, con el SOM y el ID del paquete que responde */
+typedef struct
+{
+    tMensaje evento;
+    uint8_t bloque[SF_CORTO_BLOQUE];
+} sf_corto_t;
+
 typedef struct
 {
     uartMap_t uart;                        ///< Nombre de la UART del LPC4337 a utilizar.
     uint32_t baudRate;                     ///< BaudRate seleccionado para la comunicacion serie.
     uint8_t *buffer;                       ///< Buffer para la recepción de bytes.
     uint32_t cantidad;                     ///< Cantidad de bytes recibidos.    
-    bool SOM;                              ///< Flag para indicar si llego el SOM.
-    bool EOM;                              ///< Flag para indicar si llego el EOM.
+    uint8_t estado;                        ///< Estado del separador de frames (SF_ESTADO_*).
     bool out_of_memory;                    ///< Indica que se quedo sin bloque de memoria.
+    uint8_t crc_rx;                        ///< CRC acumulado byte a byte del paquete en recepción.
+    uint8_t crc_linea[LEN_CRC];            ///< Línea de retardo con los últimos LEN_CRC bytes, que todavía no entran al CRC.
     tObjeto *ptr_objeto1;                  ///< Puntero al objeto usado para enviar el mensaje del driver a la aplicacion.
     tObjeto *ptr_objeto2;                  ///< Puntero al objeto usado para enviar el mensaje de la aplicacion al driver.
-    tMensaje mensaje;                      ///< Mensaje a recibirse a través del objeto.
+#if SF_VALIDACION_DIFERIDA
+    tObjeto *ptr_objeto_validar;           ///< Puntero al objeto usado para enviar los frames sin validar de la ISR a la tarea validadora.
+#endif
+    tMensaje *mensaje;                     ///< Evento en transmisión, recibido a través del objeto.
+    QMPool pool_eventos;                   ///< Eventos de frame, sólo el puntero pasa por las colas.
+    tMensaje eventos[SF_EVENTOS];          ///< Memoria del pool de eventos.
+    QMPool pool_cortos;                    ///< Respuestas cortas, ver sf_mensaje_corto.
+    sf_corto_t cortos[SF_RESPUESTAS_CORTAS]; ///< Memoria del pool de respuestas cortas.
+    uint32_t tx_indice;                    ///< Índice del próximo byte a transmitir del mensaje en curso.
     void *prt_pool;                        ///< Puntero al pool de memoria.
-    QMPool pool_memoria;                   ///< Memory pool (contienen la información que necesita la biblioteca qmpool.h)
+#if SF_RX_ARENA
+    arena_t arena;                         ///< Arena circular donde se reciben los frames.
+#else
+    pool_clases_t pool_memoria;            ///< Memory pools, uno por clase de tamaño de bloque.
+    QMPoolMag mag_uart[POOL_CLASES_MAX];   ///< Magazines de bloques de las ISR de RX y TX, que comparten la interrupción de la UART.
+    uint8_t clase_rx;                      ///< Clase del bloque en recepción.
+#endif
+    uint32_t limite_rx;                    ///< Cantidad de bytes a la que el paquete en recepción pasa a un bloque más grande.
+#if SF_TELEMETRIA
+    uint32_t rx_sin_memoria;               ///< Veces que se detuvo la recepción por falta de bloques (R_C2_9).
+#endif
+#if SF_RX_ESTADISTICAS
+    uint32_t rx_bytes_por_irq[SF_RX_RAFAGA_MAX + 1]; ///< Cantidad de interrupciones de RX según los bytes leídos en cada una.
+    uint32_t largo_frames[SF_HIST_LARGO_BINS]; ///< Cantidad de frames recibidos por intervalo de SF_HIST_LARGO_PASO bytes de largo.
+#if !SF_RX_ARENA
+    uint16_t bloques_en_uso;               ///< Bloques del pool tomados por la recepción y todavía no liberados.
+    uint16_t bloques_en_uso_max;           ///< Máximo de bloques en uso al mismo tiempo.
+#endif
+#endif
+#if (SF_TIMEOUT_MODO == SF_TIMEOUT_TIMER)
     TimerHandle_t timerRx;                 ///< TimerRx
     TimerHandle_t timerTx;                 ///< TimerTx
     TickType_t periodo_timerRx;              ///< Periodo del timer
+#else
+    uint32_t ultimo_byte_ciclos;           ///< Contador de ciclos al recibir el último byte del paquete.
+    TickType_t ultimo_byte_tick;           ///< Tick al recibir el último byte del paquete.
+    uint32_t timeout_ciclos;               ///< TIMEOUT_US expresado en ciclos de CPU.
+#endif
+#if SF_ESTATICO
+    sf_memoria_t memoria;                  ///< Colas, pool, timer y tarea validadora de la instancia.
+#endif
 } sf_t;
 
 sf_t* sf_crear(void);
 bool sf_init(sf_t* handler, uartMap_t uart, uint32_t baudRate);
+uint32_t sf_recibir_bytes(sf_t* handler, const uint8_t* ptr_datos, uint32_t cantidad, BaseType_t* pxHigherPriorityTaskWoken);
 
-bool sf_mensaje_recibir(sf_t* handler, tMensaje* ptr_mensaje);
-void sf_mensaje_procesado_enviar(sf_t* handler, tMensaje mensaje);
+bool sf_mensaje_recibir(sf_t* handler, tMensaje** ptr_mensaje);
+void sf_mensaje_procesado_enviar(sf_t* handler, tMensaje* mensaje);
+void sf_mensaje_procesado_encolar(sf_t* handler, tMensaje* mensaje);
+void sf_transmitir(sf_t* handler);
+tMensaje* sf_mensaje_escribible(sf_t* handler, tMensaje* mensaje);
+tMensaje* sf_mensaje_corto(sf_t* handler, tMensaje* mensaje);
+#if SF_TELEMETRIA
+void sf_mensaje_dueno(sf_t* handler, const tMensaje* mensaje, uint8_t dueno);
+#else
+#define sf_mensaje_dueno(handler, mensaje, dueno)   ((void)0)
+#endif
 
 #endif /* separacion_frames_H_ */
@@ -0,0 +1,37 @@
+/*=============================================================================
+ * Copyright (c) 2021, Fernando Prokopiuk <fernandoprokopiuk@gmail.com>
+ * 					   Jonathan Cagua <jonathan.cagua@gmail.com>
+ * 					   Leandro Arrieta <leandroarrieta@gmail.com>
+ * All rights reserved.
+ * License: Free
+ * Date: 18/10/2026
+ * Version: v1.0
+ *===========================================================================*/
+
+#ifndef SF_PERFIL_H_
+#define SF_PERFIL_H_
+
+#include "separacion_frames.h"
+
+/*
+ * Perfil de los frames recibidos y geometría del pool de memoria. El histograma de largos que guarda
+ * sf_perfil_guardar (el OA_app lo llama cada APP_PERFIL_PERIODO_MS) se convierte con tools/sf_pool_autotune.py en
+ * una geometría, que se compila como sf_pool_geometria.h o se carga al arrancar con sf_perfil_cargar (SF_PERFIL).
+ *
+ * En el target las dos funciones no hacen nada y se pueden reemplazar por otras con el mismo nombre que usen
+ * la memoria no volátil. En el host, definiendo SF_PERFIL_ARCHIVO y SF_PERFIL_HISTOGRAMA_ARCHIVO se usan
+ * archivos de texto.
+ */
+
+/* Geometría del pool de memoria */
+typedef struct
+{
+    uint8_t cant_clases;                   ///< Cantidad de clases, hasta POOL_CLASES_MAX.
+    uint16_t tamanios[POOL_CLASES_MAX];    ///< Tamaño de bloque de cada clase, de menor a mayor.
+    uint16_t cantidades[POOL_CLASES_MAX];  ///< Cantidad de bloques de cada clase.
+} sf_geometria_t;
+
+bool sf_perfil_cargar(sf_geometria_t* geometria);
+bool sf_perfil_guardar(const sf_t* handler);
+
+#endif /* SF_PERFIL_H_ */
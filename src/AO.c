@@ -9,33 +9,82 @@
  *===========================================================================*/
 
 #include "AO.h"
+#include "qf_atomic.h"
 
-bool activeObjectCreate( activeObject_t* ao, callBackActObj_t callback, TaskFunction_t taskForAO )
+#if AO_LINGER_MAX_MS > 0
+static void activeObjectArrival( activeObject_t* ao );
+static TickType_t activeObjectLinger( activeObject_t* ao );
+#endif
+
+void activeObjectInit( activeObject_t* ao, bool immortal )
 {
-    // Una variable local para saber si hemos creado correctamente los objetos.
-    BaseType_t retValue = pdFALSE;
+    // El objeto activo arranca sin tarea ni cola, se crean con activeObjectCreate o activeObjectPost.
+    ao->state = AO_MUERTO;
+    ao->itIsImmortal = immortal;
+    ao->activeObjectQueue = NULL;
+    ao->flushFunc = NULL;
+    ao->creations = 0;
+#if AO_ESTATICO
+    ao->taskHandle = NULL;
+#endif
+#if AO_LINGER_MAX_MS > 0
+    // Hasta conocer su ritmo, el objeto activo termina apenas se vacía su cola.
+    ao->lastArrival = xTaskGetTickCount();
+    ao->arrivalEma = pdMS_TO_TICKS( AO_EMA_TOPE_MS ) << AO_EMA_FRAC;
+#endif
+}
 
-    // Creamos la cola asociada a este objeto activo.
-    ao->activeObjectQueue = xQueueCreate( N_QUEUE_AO, sizeof( tMensaje ) );
+static bool activeObjectQueueInit( activeObject_t* ao )
+{
+    // La cola se crea una sola vez y se conserva entre vidas: así el que encola nunca escribe en una cola borrada.
+    if( ao->activeObjectQueue == NULL )
+#if AO_ESTATICO
+        ao->activeObjectQueue = xQueueCreateStatic( N_QUEUE_AO, sizeof( tMensaje* ), ao->queueStorage, &ao->queueBuffer );
+#else
+        ao->activeObjectQueue = xQueueCreate( N_QUEUE_AO, sizeof( tMensaje* ) );
+#endif
 
-    // Asignamos la tarea al objeto activo.
-    ao->taskName = taskForAO;
+    return ( ao->activeObjectQueue != NULL );
+}
 
-    // Si la cola se creó sin inconvenientes.
-    if( ao->activeObjectQueue != NULL )
-    {
-        // Asignamos el callback al objeto activo.
-        ao->callbackFunc = callback;
+static bool activeObjectTaskCreate( activeObject_t* ao )
+{
+    // Una variable local para saber si hemos creado correctamente la tarea.
+    BaseType_t retValue;
 
-        // Creamos la tarea asociada al objeto activo. A la tarea se le pasar� el objeto activo como par�metro.
-        retValue = xTaskCreate( ao->taskName, ( const char * )"Task For AO", configMINIMAL_STACK_SIZE, ao, tskIDLE_PRIORITY+2, NULL );
+#if AO_ESTATICO
+    // La tarea anterior quedó bloqueada al terminar, recién ahora se puede reutilizar su memoria.
+    if( ao->taskHandle != NULL )
+    {
+        vTaskDelete( ao->taskHandle );
+        ao->taskHandle = NULL;
     }
 
-    // Chequeamos si la tarea se cre� correctamente o no.
+    // Creamos la tarea asociada al objeto activo. A la tarea se le pasar� el objeto activo como par�metro.
+    ao->taskHandle = xTaskCreateStatic( ao->taskName, ( const char * )"Task For AO", AO_STACK, ao, tskIDLE_PRIORITY+2, ao->stackBuffer, &ao->taskBuffer );
+    retValue = ( ao->taskHandle != NULL ) ? pdPASS : pdFAIL;
+#else
+    retValue = xTaskCreate( ao->taskName, ( const char * )"Task For AO", AO_STACK, ao, tskIDLE_PRIORITY+2, NULL );
+#endif
+
+    // Contamos la creación, para medir cuánto cuesta que los objetos activos terminen al vaciarse su cola.
     if( retValue == pdPASS )
+        ao->creations++;
+
+    return ( retValue == pdPASS );
+}
+
+bool activeObjectCreate( activeObject_t* ao, callBackActObj_t callback, TaskFunction_t taskForAO )
+{
+    // Asignamos la tarea y el callback al objeto activo.
+    ao->taskName = taskForAO;
+    ao->callbackFunc = callback;
+
+    // Si la cola y la tarea se crearon sin inconvenientes.
+    if( activeObjectQueueInit( ao ) && activeObjectTaskCreate( ao ) )
     {
-        // Cargamos en la variable de estado del objeto activo el valor "true" para indicar que se ha creado.
-        ao->itIsAlive = TRUE;
+        // Cargamos en la variable de estado del objeto activo que se ha creado.
+        ao->state = AO_VIVO;
 
         // Devolvemos "true" para saber que el objeto activo se instanci� correctamente.
         return( TRUE );
@@ -52,8 +101,19 @@ void activeObjectTask( void* pvParameters )
     // Una variable para evaluar la lectura de la cola.
     BaseType_t retQueueVal;
 
-    // Una variable local para almacenar el dato desde la cola.
-    void*  auxValue;
+    // Por la cola llega el puntero al evento, no el evento.
+    tMensaje* evento;
+
+    // Eventos procesados en este despertar.
+    uint32_t lote;
+
+    // Cuánto espera un evento antes de procesarlo o de terminar.
+    TickType_t espera;
+
+#if AO_ESTADISTICAS
+    // Contador de ciclos al llamar al callback.
+    uint32_t ciclos;
+#endif
 
     // Obtenemos el puntero al objeto activo.
     activeObject_t* actObj = ( activeObject_t* ) pvParameters;
@@ -61,61 +121,232 @@ void activeObjectTask( void* pvParameters )
     // Cuando hay un evento, lo procesamos.
     while( TRUE )
     {
-        // Verifico si hay elementos para procesar en la cola. Si los hay, los proceso. Si soy inmortal entro siempre y si no hay mensajes espero.
-        if( (uxQueueMessagesWaiting( actObj->activeObjectQueue )) || actObj->itIsImmortal )
-        {
-            // Hago una lectura de la cola.
-            retQueueVal = xQueueReceive( actObj->activeObjectQueue, &auxValue, portMAX_DELAY );
+        // Si soy inmortal espero siempre. Si no, espero el linger antes de terminar, que por defecto es 0. R_AO_8
+#if AO_LINGER_MAX_MS > 0
+        espera = actObj->itIsImmortal ? portMAX_DELAY : activeObjectLinger( actObj );
+#else
+        espera = actObj->itIsImmortal ? portMAX_DELAY : 0;
+#endif
 
-            // Si la lectura fue exitosa, proceso el dato.
-            if( retQueueVal )
+        // Hago una lectura de la cola.
+        retQueueVal = xQueueReceive( actObj->activeObjectQueue, &evento, espera );
+
+        // Si la lectura fue exitosa, proceso el dato y los que ya estén esperando, hasta AO_LOTE_MAX.
+        if( retQueueVal )
+        {
+            lote = 0;
+            do
             {
+#if AO_LINGER_MAX_MS > 0
+                activeObjectArrival( actObj );
+#endif
                 // Llamamos al callback correspondiente en base al comando que se le pas�.
                 /* TODO:INFO a la funcion llamante le mando el ao que la llamo coo referenca porq
                    es necesario */
-                ( actObj->callbackFunc )( actObj,  &auxValue );
-            }
+#if AO_ESTADISTICAS
+                ciclos = cyclesCounterRead();
+#endif
+                ( actObj->callbackFunc )( actObj, evento );
+#if AO_ESTADISTICAS
+                actObj->cycles += cyclesCounterRead() - ciclos;
+#endif
+                lote++;
+            } while( ( lote < AO_LOTE_MAX ) && xQueueReceive( actObj->activeObjectQueue, &evento, 0 ) );
+
+            // Una sola notificación a la etapa siguiente por todo el lote.
+            if( actObj->flushFunc != NULL )
+                ( actObj->flushFunc )( actObj );
+#if AO_ESTADISTICAS
+            actObj->wakeups++;
+            actObj->events += lote;
+#endif
         }
 
         // Caso contrario, la cola est� vac�a, lo que significa que debo eliminar la tarea. R_AO_8
-        else
+        // Mientras esperaba pudo haber pasado a ser inmortal (ver APP_OA_TIBIOS), en ese caso sigue.
+        else if( !actObj->itIsImmortal )
         {
-            // Cambiamos el estado de la variable de estado, para indicar que el objeto activo no existe más.
-            actObj->itIsAlive = FALSE;
+            // Si todavía me están creando, el que me crea termina enseguida de marcarme vivo.
+            if( !qf_atomic_cas32( &actObj->state, AO_VIVO, AO_VACIANDO ) )
+            {
+                vTaskDelay( 1 );
+                continue;
+            }
 
-            // Borramos la cola del objeto activo.
-            vQueueDelete( actObj->activeObjectQueue );
+            // Pudo haber llegado un evento desde que se consultó la cola, o el que encola me pudo haber rescatado.
+            if( ( uxQueueMessagesWaiting( actObj->activeObjectQueue ) != 0 ) ||
+                !qf_atomic_cas32( &actObj->state, AO_VACIANDO, AO_MUERTO ) )
+            {
+                ( void )qf_atomic_cas32( &actObj->state, AO_VACIANDO, AO_VIVO );
+                continue;
+            }
 
-            // Y finalmente tenemos que eliminar la tarea asociada (suicidio).
+#if AO_ESTATICO
+            // FreeRTOS libera el TCB de una tarea que se borra a sí misma recién cuando corre la tarea idle, y
+            // hasta entonces no se puede reutilizar. La tarea queda bloqueada y la borra la próxima creación.
+            while( TRUE )
+                ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+#else
+            // Y finalmente tenemos que eliminar la tarea asociada (suicidio). La cola queda para la próxima vida.
             vTaskDelete( NULL );
-            
+#endif
         }
     }
 }
 
-void activeObjectEnqueue( activeObject_t* ao, void* value )
+bool activeObjectPost( activeObject_t* ao, callBackActObj_t callback, TaskFunction_t taskForAO, QueueHandle_t response_queue, tMensaje* evento )
 {
-    // Y lo enviamos a la cola.
-    if(xQueueSend( ao->activeObjectQueue, value, 0 ) != pdPASS)
+    // Si el evento ya está en la cola.
+    bool enviado = false;
+
+    // El evento se encola sin enmascarar interrupciones: cada vuelta mira el estado y lo cambia con compare-and-swap.
+    while( TRUE )
     {
-    	while(1);
+        switch( ao->state )
+        {
+            case AO_MUERTO:
+            // Hay un solo productor por objeto activo (el OA_app) y la tarea terminó con la cola vacía, así que en la
+            // cola sólo puede estar este evento. Si ya no está, la tarea lo procesó antes de terminar.
+            if( enviado && ( uxQueueMessagesWaiting( ao->activeObjectQueue ) == 0 ) )
+                return true;
+            if( !qf_atomic_cas32( &ao->state, AO_MUERTO, AO_CREANDO ) )
+                break;
+
+            // El evento se encola antes de crear la tarea, que puede correr enseguida y no tiene que encontrar la cola vacía.
+            ao->responseQueue = response_queue;
+            ao->taskName = taskForAO;
+            ao->callbackFunc = callback;
+            if( !activeObjectQueueInit( ao ) )
+            {
+                ao->state = AO_MUERTO;
+                return false;
+            }
+            if( !enviado )
+                ( void )xQueueSend( ao->activeObjectQueue, &evento, 0 );
+
+            // Si no se pudo crear la tarea se saca el evento, para que lo responda el que encola.  R_AO_9
+            if( !activeObjectTaskCreate( ao ) )
+            {
+                ( void )xQueueReceive( ao->activeObjectQueue, &evento, 0 );
+                ao->state = AO_MUERTO;
+                return false;
+            }
+            ao->state = AO_VIVO;
+            return true;
+
+            case AO_CREANDO:
+            // Sólo el que encola crea la tarea y hay un solo productor por objeto activo: otro productor es un error.
+            // Sin el evento en la cola lo responde el que encola.  R_AO_9
+            configASSERT( 0 );
+            return enviado;
+
+            case AO_VACIANDO:
+            // La tarea está por terminar, la rescato para que siga con este evento.
+            ( void )qf_atomic_cas32( &ao->state, AO_VACIANDO, AO_VIVO );
+            break;
+
+            default:
+            // Con la tarea viva, si el evento ya estaba en la cola la tarea lo va a ver al revisarla antes de terminar.
+            if( enviado )
+                return true;
+
+            // Con la cola llena el evento no se encola.
+            if( xQueueSend( ao->activeObjectQueue, &evento, 0 ) != pdPASS )
+                return false;
+
+            // Vuelvo a mirar el estado: la tarea pudo haber terminado entre la consulta y el envío.
+            enviado = true;
+            break;
+        }
     }
 }
 
-bool activeObjectOperationCreate( activeObject_t* ao, callBackActObj_t callback, TaskFunction_t taskForAO, QueueHandle_t response_queue )
+#if AO_LINGER_MAX_MS > 0
+static void activeObjectArrival( activeObject_t* ao )
+{
+    TickType_t ahora = xTaskGetTickCount();
+    uint32_t intervalo = ( uint32_t )( ahora - ao->lastArrival );
+
+    // Promedio exponencial del tiempo entre eventos, en ticks con AO_EMA_FRAC bits de fracción.
+    ao->lastArrival = ahora;
+    if( intervalo > pdMS_TO_TICKS( AO_EMA_TOPE_MS ) )
+        intervalo = pdMS_TO_TICKS( AO_EMA_TOPE_MS );
+    ao->arrivalEma += ( int32_t )( ( intervalo << AO_EMA_FRAC ) - ao->arrivalEma ) >> AO_EMA_SHIFT;
+}
+
+static TickType_t activeObjectLinger( activeObject_t* ao )
+{
+    // Espera AO_LINGER_FACTOR veces el tiempo medio entre eventos. Si así no llega a ver el próximo antes de
+    // AO_LINGER_MAX_MS no vale la pena esperar, y termina enseguida como indica R_AO_8.
+    uint32_t linger = ( ao->arrivalEma * AO_LINGER_FACTOR ) >> AO_EMA_FRAC;
+
+    if( linger > pdMS_TO_TICKS( AO_LINGER_MAX_MS ) )
+        return 0;
+
+    // Con eventos más seguidos que un tick espera al menos un tick.
+    return ( linger > 0 ) ? ( TickType_t )linger : 1;
+}
+#endif
+
+bool activeObjectOperationCreate( activeObject_t* ao, callBackActObj_t callback, TaskFunction_t taskForAO, QueueHandle_t response_queue, QueueHandle_t event_queue )
 {
     /* cargo miembro que no estaba */
     ao->responseQueue= response_queue;
+    /* con una cola de eventos ajena, activeObjectQueueInit no crea la propia y la tarea arranca leyendo de esa */
+    if (event_queue != NULL)
+        ao->activeObjectQueue = event_queue;
     /* creo oa padre */
     if (activeObjectCreate( ao, callback, taskForAO ) == false)
         return false;
     else
         return true;
 }
-void activeObjectQueueChange( activeObject_t* ao, QueueHandle_t activeObjectNewQueue )
+
+void activeObjectPubSubInit( aoPubSub_t* tabla )
 {
-    // Borramos la cola del objeto activo.
-    vQueueDelete( ao->activeObjectQueue );
+    // La tabla arranca sin suscriptores.
+    tabla->cantidad = 0;
+}
 
-    ao->activeObjectQueue = activeObjectNewQueue;
+bool activeObjectSubscribe( aoPubSub_t* tabla, activeObject_t* ao, uint8_t opcode )
+{
+    // Si no hay lugar en la tabla, la suscripción falla.
+    if( tabla->cantidad == AO_SUSCRIPCIONES_MAX )
+        return false;
+
+    // Publicar no pasa por el ciclo de vida: sólo se suscriben objetos activos vivos e inmortales, cuya tarea no
+    // termina nunca, así ningún evento queda en la cola de una tarea que ya decidió terminar.
+    if( !ao->itIsImmortal || ( ao->state != AO_VIVO ) )
+        return false;
+
+    // Cargamos el objeto activo y el opcode que le interesa.
+    tabla->suscripciones[tabla->cantidad].ao = ao;
+    tabla->suscripciones[tabla->cantidad].opcode = opcode;
+    tabla->cantidad++;
+    return true;
+}
+
+uint8_t activeObjectPublish( aoPubSub_t* tabla, uint8_t opcode, tMensaje* evento )
+{
+    // Cantidad de suscriptores que recibieron el evento.
+    uint8_t entregados = 0;
+    uint8_t i;
+
+    // El que publica conserva su referencia mientras reparte, así el evento no se recicla a mitad de camino.
+    for( i = 0; i < tabla->cantidad; i++ )
+    {
+        aoSuscripcion_t* s = &tabla->suscripciones[i];
+
+        // Sólo reciben los suscriptores que esperan este opcode. Son inmortales, ver activeObjectSubscribe.
+        if( ( s->opcode != AO_OPCODE_TODOS ) && ( s->opcode != opcode ) )
+            continue;
+
+        // A cada suscriptor le llega el mismo evento, con una referencia más: se encola sólo el puntero.
+        objeto_evento_retener( evento );
+        if( xQueueSend( s->ao->activeObjectQueue, &evento, 0 ) == pdPASS )
+            entregados++;
+        else
+            ( void )objeto_evento_soltar( evento );     // Con la cola llena el suscriptor pierde el evento
+    }
+    return entregados;
 }
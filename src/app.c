@@ -10,6 +10,7 @@
 
 #include "app.h"
 #include "app_callbacks.h"
+#include <string.h>
 /**
  * @brief Asigna memoria para una estructura de app, la inicializa y crea el OA_app.
  * 
@@ -24,28 +25,75 @@ bool app_crear(app_t* handler_app , sf_t* handler_sf)
     {
         /* Inicializo el OA_app*/ 
         handler_app->handler_sf = handler_sf;
-        handler_app->OA_app.itIsAlive = false;
-        handler_app->OA_app.itIsImmortal = true; // El OA_app no debe morir nunca.
+        activeObjectInit( &handler_app->OA_app, true );    // El OA_app no debe morir nunca.
+        handler_app->OA_app.flushFunc = app_OAapp_flush; // Dispara la transmisión una vez por lote de respuestas
+        handler_app->tx_pendiente = false;
         
+        /* Todavía no hay suscriptores a los paquetes */
+        activeObjectPubSubInit( &handler_app->suscriptores );
+
         /* Cargo los punteros de los OA de procesamiento en el OA_app*/
-        
-        handler_app->OA_C.itIsAlive = false;
-        handler_app->OA_C.itIsImmortal = false;
-        
-        handler_app->OA_P.itIsAlive = false;
-        handler_app->OA_P.itIsImmortal = false;
-        
-        handler_app->OA_S.itIsAlive = false;
-        handler_app->OA_S.itIsImmortal = false;
-        
-        // Se crea el objeto activo, con el comando correspondiente y tarea asociada.
-        activeObjectOperationCreate( &handler_app->OA_app, app_OAapp, activeObjectTask , handler_sf->ptr_objeto2->cola);
+        activeObjectInit( &handler_app->OA_C, false );
+        handler_app->OA_C.ptr_sf = handler_sf;
+        activeObjectInit( &handler_app->OA_P, false );
+        handler_app->OA_P.ptr_sf = handler_sf;
+        activeObjectInit( &handler_app->OA_S, false );
+        handler_app->OA_S.ptr_sf = handler_sf;
 
-        /* Cargo cola para recibir los paquetes provenientes de C2*/ 
-        activeObjectQueueChange( &handler_app->OA_app , handler_sf->ptr_objeto1->cola);
+        /* Creaciones de los OA de procesamiento, para medir el costo de que terminen al vaciarse su cola */
+        handler_app->creaciones_por_segundo = 0;
+        handler_app->creaciones_base = 0;
+        handler_app->creaciones_inicio = xTaskGetTickCount();
+#if APP_PERFIL_PERIODO_MS > 0
+        handler_app->perfil_inicio = handler_app->creaciones_inicio;
+#endif
+#if APP_OA_TIBIOS > 0
+        memset( handler_app->uso, 0, sizeof( handler_app->uso ) );
+        handler_app->uso_paquetes = 0;
+#endif
+        
+        // Se crea el objeto activo, con el comando correspondiente y tarea asociada. Recibe los paquetes provenientes
+        // de C2 directamente en la cola de C2, sin crear una propia.
+        activeObjectOperationCreate( &handler_app->OA_app, app_OAapp, activeObjectTask , handler_sf->ptr_objeto2->cola,
+                                     handler_sf->ptr_objeto1->cola );
         
         return true;
     }
 
     return false;
 } 
+
+/**
+ * @brief Suscribe un OA a los paquetes recibidos, por ejemplo para auditarlos o reenviarlos por otra UART.
+ * 
+ * @details El OA recibe el puntero al mismo evento que procesa la aplicación, no tiene que modificarlo y al
+ *          terminar lo suelta con objeto_evento_liberar. Tiene que estar creado y ser inmortal, y suscribirse
+ *          antes de que lleguen paquetes. Los OA de procesamiento no se pueden suscribir: con APP_OA_TIBIOS
+ *          dejan de ser inmortales cuando baja su uso.
+ * 
+ * @param handler_app   Puntero del tipo app_t, ya creado con app_crear
+ * @param ao            OA suscriptor
+ * @param opcode        Campo C de los paquetes que recibe, o AO_OPCODE_TODOS
+ * @return true         Si se suscribió
+ * @return false        Si no hay lugar para más suscripciones, o si el OA no está vivo o no es inmortal
+ */
+bool app_suscribir(app_t* handler_app, activeObject_t* ao, uint8_t opcode)
+{
+    if ( (ao == &handler_app->OA_C) || (ao == &handler_app->OA_P) || (ao == &handler_app->OA_S) )
+        return false;
+    return activeObjectSubscribe( &handler_app->suscriptores, ao, opcode );
+}
+
+/**
+ * @brief Devuelve cuántas veces por segundo se crearon los OA de procesamiento en el último segundo medido.
+ * 
+ * @details Sirve para ajustar AO_LINGER_MAX_MS y APP_OA_TIBIOS: cada creación es una tarea nueva y, con memoria
+ *          dinámica, una cola nueva.
+ * 
+ * @param handler_app   Puntero del tipo app_t
+ * @return uint32_t     Creaciones por segundo
+ */
+uint32_t app_creaciones_por_segundo(const app_t* handler_app)
+{
+    return handler_app->creaciones_por_segundo;
+}
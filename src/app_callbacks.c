@@ -1,26 +1,32 @@
-/*=============================================================================
- * Copyright (c) 2021, Fernando Prokopiuk <fernandoprokopiuk@gmail.com>
- * 					   Jonathan Cagua <jonathan.cagua@gmail.com>
- * 					   Leandro Arrieta <leandroarrieta@gmail.com>
- * All rights reserved.
- * License: Free
- * Date: 29/11/2021
- * Version: v1.0
- *===========================================================================*/
-
 #include "app_callbacks.h"
 #include "app.h"
+#include "app_clasificar.h"
+#include "sf_perfil.h"
+#include <string.h>
+
+#define APP_SOLO_VALIDAR    0       // Formato para app_procesar que sólo valida, sin escribir el mensaje
 
-static void app_extraer_palabras( uint8_t (*palabras)[CANT_LETRAS_MAX] , tMensaje* mensaje );
-static void app_inicializar_array_palabras(uint8_t (*palabras)[CANT_LETRAS_MAX]);
-static bool app_validar_paquete( tMensaje* mensaje );
+static void app_formatear( activeObject_t* ptr_me, tMensaje* mensaje, uint8_t formato );
+static bool app_procesar( tMensaje* mensaje, uint8_t formato );
+static bool app_snake_expandir( tMensaje* mensaje, uint32_t palabras );
 static void app_insertar_mensaje_error(uint8_t error_type, tMensaje* mensaje );
+static void app_responder_error( app_t* ptr_me, uint8_t error_type, tMensaje* mensaje );
+static void app_enviar( app_t* ptr_me, tMensaje* mensaje );
+static void app_creaciones_actualizar( app_t* ptr_me );
+#if APP_PERFIL_PERIODO_MS > 0
+static void app_perfil_guardar( app_t* ptr_me );
+#endif
+#if APP_OA_TIBIOS > 0
+static void app_uso_actualizar( app_t* ptr_me, uint8_t formato );
+#endif
 
 /**
  * @brief   Callback para el OA_app. Recibe dos tipos de evento, uno de paquete a procesar y otro de paquete procesado
  *          Cuando llega un paquete a procesar valida el paquete y si es correcto de acuerdo al campo C, deriva el 
  *          paquete al OA activo correspondiente para que lo procese. Si el OA no existe lo crea.
  *          Cuando llega un paquete procesado lo devuelve a la capa 2.
+ *          Antes de derivarlo, publica el paquete a los OA suscriptos a su opcode (ver app_suscribir), que
+ *          comparten el mismo evento sólo para lectura.
  * 
  * @param caller_ao             Estructura del OA
  * @param mensaje_a_procesar    Paquete con el mensaje a procesar.
@@ -30,74 +36,53 @@ void app_OAapp( void* caller_ao, void* mensaje_a_procesar )
     app_t* ptr_me = (app_t*) caller_ao; // Recibo por herencia el puntero a la estructura app_t
     tMensaje* mensaje = (tMensaje*) mensaje_a_procesar;
     
+    app_creaciones_actualizar( ptr_me );
+#if APP_PERFIL_PERIODO_MS > 0
+    app_perfil_guardar( ptr_me );
+#endif
+
     /* Verifico si es un evento proveniente del driver que signifique “llegó un paquete procesar”. */    // R_AO_2
     if ( mensaje->evento_tipo == PAQUETE)
     {
-        if (app_validar_paquete( mensaje ) == false )                            // R_AO_3
-        {
-            app_insertar_mensaje_error( ERROR_INVALID_DATA , mensaje );
-            sf_mensaje_procesado_enviar(ptr_me->handler_sf, *mensaje);
-        }
+#if APP_OA_TIBIOS > 0
+        /* Los OA de los formatos más usados no terminan al vaciarse su cola */
+        app_uso_actualizar( ptr_me, mensaje->ptr_datos[INDICE_CAMPO_C] );
+#endif
+
+        /* Los suscriptores reciben el mismo evento, sin copiar el bloque */
+        activeObjectPublish( &ptr_me->suscriptores, mensaje->ptr_datos[INDICE_CAMPO_C], mensaje );
+
+        if ( app_procesar( mensaje, APP_SOLO_VALIDAR ) == false )                    // R_AO_3
+            app_responder_error( ptr_me, ERROR_INVALID_DATA , mensaje );
         else switch( mensaje->ptr_datos[INDICE_CAMPO_C] ) // R_C3_12
     	{
             case 'C':
-            taskENTER_CRITICAL();
-            if ( ptr_me->OA_C.itIsAlive == false )
-            {
-            	// Se crea el objeto activo, con el comando correspondiente y tarea asociada.       //R_AO_5 R_AO_6
-				if( activeObjectOperationCreate( &ptr_me->OA_C , app_OAC, activeObjectTask, ptr_me->handler_sf->ptr_objeto1->cola ) == false )
-                {
-                    app_insertar_mensaje_error( ERROR_SYSTEM , mensaje ); // R_AO_9
-                    sf_mensaje_procesado_enviar(ptr_me->handler_sf, *mensaje);
-                    break;
-                }
-			}
-            // Y enviamos el dato a la cola para procesar.
-            activeObjectEnqueue( &ptr_me->OA_C, mensaje);
-            taskEXIT_CRITICAL();
+            // Enviamos el dato a la cola para procesar. Si el OA no existe se crea, con el comando correspondiente y tarea asociada.    //R_AO_5 R_AO_6
+            sf_mensaje_dueno(ptr_me->handler_sf, mensaje, SF_DUENO_OBJETO_C);
+            if( activeObjectPost( &ptr_me->OA_C , app_OAC, activeObjectTask, ptr_me->handler_sf->ptr_objeto1->cola, mensaje ) == false )
+                app_responder_error( ptr_me, ERROR_SYSTEM , mensaje ); // R_AO_9
 
             break; 
             
             case 'P':                       // A PascalCase
-            taskENTER_CRITICAL();
-            if( ptr_me->OA_P.itIsAlive == false )
-            {
-                // Se crea el objeto activo, con el comando correspondiente y tarea asociada.       //R_AO_5 R_AO_6
-                if( activeObjectOperationCreate( &ptr_me->OA_P , app_OAP, activeObjectTask, ptr_me->handler_sf->ptr_objeto1->cola ) == false )
-                {
-                    app_insertar_mensaje_error( ERROR_SYSTEM , mensaje ); // R_AO_9
-                    sf_mensaje_procesado_enviar(ptr_me->handler_sf, *mensaje);
-                    break;
-                }
-            }
-            // Y enviamos el dato a la cola para procesar.
-            activeObjectEnqueue( &ptr_me->OA_P, mensaje);
-            taskEXIT_CRITICAL();
+            // Enviamos el dato a la cola para procesar. Si el OA no existe se crea, con el comando correspondiente y tarea asociada.    //R_AO_5 R_AO_6
+            sf_mensaje_dueno(ptr_me->handler_sf, mensaje, SF_DUENO_OBJETO_P);
+            if( activeObjectPost( &ptr_me->OA_P , app_OAP, activeObjectTask, ptr_me->handler_sf->ptr_objeto1->cola, mensaje ) == false )
+                app_responder_error( ptr_me, ERROR_SYSTEM , mensaje ); // R_AO_9
 
             break;
             
             case 'S':                       // A snake_case
-            taskENTER_CRITICAL();
-            if( ptr_me->OA_S.itIsAlive == false)
-            {
-                // Se crea el objeto activo, con el comando correspondiente y tarea asociada.       //R_AO_5 R_AO_6
-                if( activeObjectOperationCreate( &ptr_me->OA_S , app_OAS, activeObjectTask, ptr_me->handler_sf->ptr_objeto1->cola ) == false )
-                {
-                    app_insertar_mensaje_error( ERROR_SYSTEM , mensaje ); // R_AO_9
-                    sf_mensaje_procesado_enviar(ptr_me->handler_sf, *mensaje);
-                    break;
-                }
-            }
-            // Y enviamos el dato a la cola para procesar.
-            activeObjectEnqueue( &ptr_me->OA_S, mensaje);
-            taskEXIT_CRITICAL();
+            // Enviamos el dato a la cola para procesar. Si el OA no existe se crea, con el comando correspondiente y tarea asociada.    //R_AO_5 R_AO_6
+            sf_mensaje_dueno(ptr_me->handler_sf, mensaje, SF_DUENO_OBJETO_S);
+            if( activeObjectPost( &ptr_me->OA_S , app_OAS, activeObjectTask, ptr_me->handler_sf->ptr_objeto1->cola, mensaje ) == false )
+                app_responder_error( ptr_me, ERROR_SYSTEM , mensaje ); // R_AO_9
 
             break; // Para salir del case.
             
             default:                                                // R_C3_6 - R_C3_11
             {
-                app_insertar_mensaje_error( ERROR_INVALID_OPCODE , mensaje );
-                sf_mensaje_procesado_enviar(ptr_me->handler_sf, *mensaje);
+                app_responder_error( ptr_me, ERROR_INVALID_OPCODE , mensaje );
             }
             
         }
@@ -105,53 +90,37 @@ void app_OAapp( void* caller_ao, void* mensaje_a_procesar )
     /* Verifico si el mensaje que llego es un evento con la respuesta procesada*/       //R_AO_2
     if ( mensaje->evento_tipo == RESPUESTA)
     {
-    	sf_mensaje_procesado_enviar(ptr_me->handler_sf, *mensaje);
+    	app_enviar(ptr_me, mensaje);
     }
     
 }
 
 /**
- * @brief  Callback para el OA que se encarga de formatear el mensaje en camelCase
+ * @brief   Se llama al terminar cada lote de eventos del OA_app y dispara una sola vez la transmisión de todas
+ *          las respuestas que se encolaron en el lote.
  * 
  * @param caller_ao             Estructura del OA
- * @param mensaje_a_procesar    Paquete con el mensaje a procesar.
  */
-void app_OAC(void* caller_ao, void* mensaje_a_procesar)
+void app_OAapp_flush( void* caller_ao )
 {
-    activeObject_t* ptr_me = (activeObject_t*)caller_ao;
-    tMensaje* mensaje = (tMensaje*) mensaje_a_procesar;
-
-    static uint8_t palabras[CANT_PALABRAS_MAX][CANT_LETRAS_MAX];  ///> Array de strings para extraer las palabras del mensaje
-
-    app_inicializar_array_palabras(palabras);
-
-    app_extraer_palabras( palabras , mensaje );
+    app_t* ptr_me = (app_t*) caller_ao;
 
-    mensaje->evento_tipo = RESPUESTA;
-    mensaje->cantidad = INDICE_CAMPO_DATOS;
-    /* Bucle para recorrer todas las palabras*/ 
-    for (uint32_t i = 0 ; i < CANT_PALABRAS_MAX ; i++)
+    if ( ptr_me->tx_pendiente )
     {
-        if (palabras[i][CARACTER_INICIAL] == 0 ) 
-            break;  // Si el primer caracter de la palabra es cero, significa que termine con todas las palabras y salgo del for
-        for (uint32_t j = 0 ; j < CANT_LETRAS_MAX ; j++)
-        {
-            if (palabras[i][j] == 0 ) 
-                break; //Si es cero, llegué al final de la palabra y salgo del for.
-            
-            /* A partir de la segunda palabra, pongo la primer letra de la palabra en mayúscula */
-            if ( (i > 0) && (j == 0))
-                palabras[i][j] += A_MAYUSCULA;
-            
-            /* Cargo en el mensaje el caracter correspondiente*/ 
-            mensaje->ptr_datos[mensaje->cantidad] = palabras[i][j];
-
-            /* Incremento el tamaño del paquete*/
-            mensaje->cantidad++;
-        }
+        ptr_me->tx_pendiente = false;
+        sf_transmitir(ptr_me->handler_sf);
     }
-    // Y enviamos el dato a la cola para procesar.
-    xQueueSend( ptr_me->responseQueue , mensaje, 0 );
+}
+
+/**
+ * @brief  Callback para el OA que se encarga de formatear el mensaje en camelCase
+ * 
+ * @param caller_ao             Estructura del OA
+ * @param mensaje_a_procesar    Paquete con el mensaje a procesar.
+ */
+void app_OAC(void* caller_ao, void* mensaje_a_procesar)
+{
+    app_formatear( (activeObject_t*)caller_ao, (tMensaje*) mensaje_a_procesar, 'C' );
 }
 
 /**
@@ -162,41 +131,7 @@ void app_OAC(void* caller_ao, void* mensaje_a_procesar)
  */
 void app_OAP(void* caller_ao, void* mensaje_a_procesar)
 {
-    activeObject_t* ptr_me = (activeObject_t*)caller_ao;
-    tMensaje* mensaje = (tMensaje*) mensaje_a_procesar;
-
-    static uint8_t palabras[CANT_PALABRAS_MAX][CANT_LETRAS_MAX];  ///> Array de strings para extraer las palabras del mensaje
-
-    app_inicializar_array_palabras(palabras);
-
-    app_extraer_palabras( palabras , mensaje );
-
-    mensaje->evento_tipo = RESPUESTA;
-    mensaje->cantidad = INDICE_CAMPO_DATOS;
-    /* Bucle para recorrer todas las palabras*/
-    for (uint32_t i = 0 ; i < CANT_PALABRAS_MAX ; i++)
-    {
-        if (palabras[i][CARACTER_INICIAL] == 0 )
-            break;  // Si el primer caracter de la palabra es cero, significa que termine con todas las palabras y salgo del for
-        for (uint32_t j = 0 ; j < CANT_LETRAS_MAX ; j++)
-        {
-            if (palabras[i][j] == 0 )
-                break; //Si es cero, llegué al final de la palabra y salgo del for.
-
-            /* Pongo la primer letra de la palabra en mayúscula */
-            if ( j == 0 )
-                palabras[i][j] += A_MAYUSCULA;
-
-            /* Cargo en el mensaje el caracter correspondiente*/
-            mensaje->ptr_datos[mensaje->cantidad] = palabras[i][j];
-
-            /* Incremento el tamaño del paquete*/
-            mensaje->cantidad++;
-        }
-    }
-    // Y enviamos el dato a la cola para procesar.
-    xQueueSend( ptr_me->responseQueue , mensaje, 0 );
-
+    app_formatear( (activeObject_t*)caller_ao, (tMensaje*) mensaje_a_procesar, 'P' );
 }
 
 /**
@@ -207,179 +142,211 @@ void app_OAP(void* caller_ao, void* mensaje_a_procesar)
  */
 void app_OAS(void* caller_ao, void* mensaje_a_procesar)
 {
-    activeObject_t* ptr_me = (activeObject_t*)caller_ao;
-    tMensaje* mensaje = (tMensaje*) mensaje_a_procesar;
-
-    static uint8_t palabras[CANT_PALABRAS_MAX][CANT_LETRAS_MAX];  ///> Array de strings para extraer las palabras del mensaje
+    app_formatear( (activeObject_t*)caller_ao, (tMensaje*) mensaje_a_procesar, 'S' );
+}
 
-    app_inicializar_array_palabras(palabras);
+/**
+ * @brief Arma la respuesta de un OA de formato y la envía al OA_app
+ * 
+ * @details La respuesta se arma sobre el bloque del paquete. Si otro suscriptor todavía lo lee se trabaja sobre
+ *          una copia, y si no hay lugar para la copia se responde el error de sistema en una respuesta corta, sin
+ *          esperar a que lo suelten.
+ * 
+ * @param ptr_me    Estructura del OA
+ * @param mensaje   Paquete con el mensaje a procesar
+ * @param formato   'C', 'P' o 'S'
+ */
+static void app_formatear( activeObject_t* ptr_me, tMensaje* mensaje, uint8_t formato )
+{
+    tMensaje* respuesta = sf_mensaje_escribible( ptr_me->ptr_sf, mensaje );
 
-    app_extraer_palabras( palabras , mensaje );
-    
-    mensaje->evento_tipo = RESPUESTA;
-    mensaje->cantidad = INDICE_CAMPO_DATOS;
-    /* Bucle para recorrer todas las palabras*/
-    for (uint32_t i = 0 ; i < CANT_PALABRAS_MAX ; i++)
+    if ( respuesta == NULL )
     {
-        if (palabras[i][CARACTER_INICIAL] == 0 )
-            break;  // Si el primer caracter de la palabra es cero, significa que termine con todas las palabras y salgo del for
-        for (uint32_t j = 0 ; j < CANT_LETRAS_MAX ; j++)
+        respuesta = sf_mensaje_corto( ptr_me->ptr_sf, mensaje );
+        /* Sin memoria ni para el error, el paquete se descarta */
+        if ( respuesta == NULL )
         {
-            if (palabras[i][j] == 0 )
-                break; //Si es cero, llegué al final de la palabra y salgo del for.
-
-            /* A partir de la segunda palabra, inserto un '_' al inicio */
-            if ( (i > 0) && (j == 0) )
-            {
-            	mensaje->ptr_datos[mensaje->cantidad] = '_';
-            	mensaje->cantidad++;
-                if(mensaje->cantidad >= MSG_MAX_SIZE - LEN_HEADER_COMPLETO)
-                {
-                    app_insertar_mensaje_error( ERROR_INVALID_DATA , mensaje );
-                    xQueueSend( ptr_me->responseQueue , mensaje, 0 );
-                    return;
-                }
-            }
-
-            /* Cargo en el mensaje el caracter correspondiente*/
-            mensaje->ptr_datos[mensaje->cantidad] = palabras[i][j];
-
-            /* Incremento el tamaño del paquete*/
-            mensaje->cantidad++;
-            if(mensaje->cantidad >= MSG_MAX_SIZE - LEN_HEADER_COMPLETO)
-            {
-                app_insertar_mensaje_error( ERROR_INVALID_DATA , mensaje );
-                xQueueSend( ptr_me->responseQueue , mensaje, 0 );
-                return;
-            }
+            objeto_evento_liberar( mensaje );
+            return;
         }
+        app_insertar_mensaje_error( ERROR_SYSTEM , respuesta );                    // R_AO_9
     }
-    // Y enviamos el dato a la cola para procesar.
-    xQueueSend( ptr_me->responseQueue , mensaje, 0 );
-
+    else if ( app_procesar( respuesta, formato ) == false )
+        app_insertar_mensaje_error( ERROR_INVALID_DATA , respuesta );
+    respuesta->evento_tipo = RESPUESTA;
+    // Y enviamos el dato a la cola para procesar. La cola alcanza para todos los eventos (ver separacion_frames.h),
+    // pero si se llenara la respuesta se descarta en lugar de perder el evento y su bloque.
+    if ( xQueueSend( ptr_me->responseQueue , &respuesta, 0 ) != pdPASS )
+        objeto_evento_liberar( respuesta );
 }
 
 /**
- * @brief Función interna para validar el paquete a nivel de C3
+ * @brief Valida el paquete a nivel de C3 y lo convierte al formato pedido en una sola pasada.
+ * 
+ * @details Recorre el mensaje una vez y escribe la salida directamente sobre el mismo mensaje, sin buffers
+ *          intermedios. Dentro de una palabra valida y copia de a APP_SWAR_BYTES minúsculas con una sola
+ *          comparación (ver app_clasificar.h), y de a un caracter en los cambios de palabra.
+ *          En camelCase y PascalCase la salida nunca supera a la entrada leída. snake_case se arma primero en
+ *          PascalCase, que marca cada palabra con su mayúscula, y después se expande de atrás hacia adelante
+ *          (ver app_snake_expandir), así la salida tampoco pisa bytes sin leer.
+ *          Si el mensaje es inválido el contenido queda modificado y se debe reemplazar por el error.
  * 
- * @param mensaje   Mensaje a validar
+ * @param mensaje   Mensaje a validar y convertir. Al terminar, cantidad es el largo de la salida.
+ * @param formato   'C', 'P' o 'S' para convertir, o APP_SOLO_VALIDAR para validar sin modificar el mensaje.
  * @return true     Si el mensaje es correcto
  * @return false    Si el mensaje es incorrecto
  */
-static bool app_validar_paquete( tMensaje* mensaje )
+static bool app_procesar( tMensaje* mensaje, uint8_t formato )
 {
-    uint32_t palabra = PALABRA_INICIAL;
-    uint32_t caracter = CARACTER_INICIAL;
-    
-    /* Si el caracter final es guion bajo o espacio salgo con error*/       // R_C3_9
-    if ( (mensaje->ptr_datos[mensaje->cantidad -1] == ' ') || (mensaje->ptr_datos[mensaje->cantidad -1] == '_') )
-            return false;
-    
-    /* Recorro todo el mensaje para verificar que los caracteres sean válidos. */
-    for ( uint32_t i = INDICE_CAMPO_DATOS; i < mensaje->cantidad ; i++)
+    uint8_t* datos = mensaje->ptr_datos;
+    uint32_t fin = mensaje->cantidad;
+    uint32_t i = INDICE_CAMPO_DATOS;            // Próximo byte de entrada
+    uint32_t escrito = INDICE_CAMPO_DATOS;      // Próxima posición de la salida, nunca pasa a i
+    uint32_t palabras = 0;                      // Palabras empezadas
+    uint32_t caracter = CARACTER_INICIAL;       // Letras de la palabra actual, CARACTER_INICIAL entre palabras
+    uint8_t anterior = 0;
+    uint8_t c;
+    uint32_t w;
+    bool escribir = ( formato != APP_SOLO_VALIDAR );
+    /* Número de palabra desde el que la inicial va en mayúscula. snake_case pasa primero por PascalCase */
+    uint32_t palabra_mayuscula = ((formato == 'P') || (formato == 'S')) ? 1 :
+                                 (formato == 'C') ? 2 : CANT_PALABRAS_MAX + 1;
+
+    while ( i < fin )
     {
-        if ( ('A' <= mensaje->ptr_datos[i]) && ( mensaje->ptr_datos[i]<= 'Z'))          // R_C3_7
+        /* Caso más común: dentro de una palabra, APP_SWAR_BYTES minúsculas se validan y copian de una vez */
+        if ( (caracter != CARACTER_INICIAL) && (caracter + APP_SWAR_BYTES <= CANT_LETRAS_MAX) &&     // R_C3_3
+             (i + APP_SWAR_BYTES <= fin) )
+        {
+            memcpy( &w, &datos[i], APP_SWAR_BYTES );
+            if ( app_swar_rango( w, 'a', 'z' ) == APP_SWAR_BIT7 )
             {
-                /* Si no es la primer palabra o el primer carácter, cambio de palabra. */
-                if ((caracter != CARACTER_INICIAL))
-                {
-                    /* Verifico que la palabra tenga la cantidad de letras mínimas*/    // R_C3_4
-                    if (caracter < CANT_LETRAS_MIN)
-                        return false;
-                    palabra++;                   // Incremento para cambiar de palabra.
-                    caracter = CARACTER_INICIAL; // Cambio al caracter inicial de la palabra.
-                }
-                caracter++;                  // Avanzo un caracter para la próxima iteración.
+                if ( escribir )
+                    memcpy( &datos[escrito], &w, APP_SWAR_BYTES );
+                i += APP_SWAR_BYTES;
+                escrito += APP_SWAR_BYTES;
+                caracter += APP_SWAR_BYTES;
+                continue;
             }
-        else if ( ('a' <= mensaje->ptr_datos[i]) && (mensaje->ptr_datos[i] <= 'z'))     // R_C3_7
-            caracter++;                     // Avanzo un caracter para la próxima iteración.
-        else if ( (mensaje->ptr_datos[i] == '_' ) || (mensaje->ptr_datos[i] == ' ' ) )
+        }
+
+        c = datos[i++];
+        if ( (uint8_t)(c - 'a') <= 'z' - 'a' )
         {
-            /* Si hay 2 guiones bajos o espacios seguidos salgo con error*/             // R_C3_8
-            if (mensaje->ptr_datos[i] == mensaje->ptr_datos[i+1])
-                    return false;
-            /* Si el caracter no es el inicial salto de palabra.*/
-            if (caracter != CARACTER_INICIAL)
+            if ( caracter == CARACTER_INICIAL )
             {
-                /* Verifico que la palabra tenga la cantidad de letras mínimas*/    // R_C3_4
-                if (caracter < CANT_LETRAS_MIN)
+                /* Si llegue a la cantidad máxima de palabras, marco el error y salgo*/  // R_C3_1
+                if ( palabras == CANT_PALABRAS_MAX )
                     return false;
-                palabra++;                   // Incremento para cambiar de palabra.
-                caracter = CARACTER_INICIAL; // Cambio al caracter inicial de la palabra.
+                if ( ++palabras >= palabra_mayuscula )
+                    c += A_MAYUSCULA;
             }
+            /* Si llegue a la cantidad máxima de caracteres, marco el error y salgo*/  // R_C3_3
+            else if ( caracter >= CANT_LETRAS_MAX )
+                return false;
+            caracter++;
+        }
+        else if ( (uint8_t)(c - 'A') <= 'Z' - 'A' )
+        {
+            /* Una mayúscula siempre empieza una palabra nueva. */
+            if ( palabras == CANT_PALABRAS_MAX )                                    // R_C3_1
+                return false;
+            if ( ++palabras < palabra_mayuscula )
+                c += A_MINUSCULA;
+            caracter = CARACTER_INICIAL + 1;
         }
-        /* Si no era un caracter, o guion bajo o espacio, marco el error y salgo. */
+        else if ( (c == '_') || (c == ' ') )
+        {
+            /* Si hay 2 guiones bajos o espacios seguidos salgo con error*/             // R_C3_8
+            if ( c == anterior )
+                return false;
+            /* Termina la palabra, si había una */
+            caracter = CARACTER_INICIAL;
+            anterior = c;
+            continue;
+        }
+        /* Si no era un caracter, o guion bajo o espacio, marco el error y salgo. */     // R_C3_7
         else
             return false;
-        /* Si llegue a la cantidad máxima de palabras o caracteres, marco el error y salgo*/
-        if ( (caracter > CANT_LETRAS_MAX) || (palabra == CANT_PALABRAS_MAX))
-            return false;
+        anterior = c;
+        if ( escribir )
+            datos[escrito] = c;
+        escrito++;
     }
-    /* Verifico que la  cantidad de palabras que llegaron se mayor que las mínimas definidas.*/ // R_C3_2
-    if (palabra < CANT_PALABRAS_MIN -1)
-            return false;
-        
-    return true;
+    /* Si el caracter final es guion bajo o espacio salgo con error*/       // R_C3_9
+    if ( (anterior == '_') || (anterior == ' ') )
+        return false;
+
+    if ( !escribir )
+        return true;
+    mensaje->cantidad = escrito;
+    if ( formato != 'S' )
+        return true;
+    return app_snake_expandir( mensaje, palabras );
 }
 
 /**
- * @brief Extrae las palabras del mensaje y las guarda en una matriz.
+ * @brief Pasa a snake_case un mensaje en PascalCase, sobre el mismo mensaje.
+ * 
+ * @details Cada mayúscula salvo la primera se reemplaza por '_' y la letra en minúscula. Se recorre de atrás hacia
+ *          adelante, con la salida siempre a la derecha de la entrada sin leer, y de a APP_SWAR_BYTES caracteres
+ *          hasta la mayúscula siguiente. Cuando ya se insertaron todos los '_' el resto del mensaje está en su lugar.
  * 
- * @param mensaje   Mensaje a procesar
- * @param palabras  Matriz para guardar las palabras
+ * @param mensaje   Mensaje en PascalCase. Al terminar, cantidad es el largo de la salida.
+ * @param palabras  Cantidad de palabras, que es la cantidad de mayúsculas del mensaje.
+ * @return true     Si la respuesta entra en el bloque junto con el encabezado
+ * @return false    Si no entra
  */
-static void app_extraer_palabras( uint8_t (*palabras)[CANT_LETRAS_MAX] , tMensaje* mensaje )
+static bool app_snake_expandir( tMensaje* mensaje, uint32_t palabras )
 {
-    uint32_t palabra = PALABRA_INICIAL;
-    uint32_t caracter = CARACTER_INICIAL;
-    
-    /* Recorro todo el mensaje para extraer las palabras */
-    for ( uint32_t i = INDICE_CAMPO_DATOS; i < mensaje->cantidad ; i++)
+    uint8_t* datos = mensaje->ptr_datos;
+    uint32_t origen = mensaje->cantidad;        // Fin de la entrada sin leer
+    uint32_t destino;                           // Fin de la salida sin escribir
+    uint32_t w;
+    uint32_t mayusculas;
+    uint8_t c;
+
+    if ( palabras == 0 )
+        return true;
+    destino = origen + palabras - 1;
+    /* La respuesta tiene que entrar en el bloque junto con el encabezado */
+    if ( destino >= MSG_MAX_SIZE - LEN_HEADER_COMPLETO )
+        return false;
+    mensaje->cantidad = destino;
+
+    /* Entre origen y destino quedan tantos bytes como '_' faltan insertar */
+    while ( destino > origen )
     {
-        /* Si el caracter está entre 'A' y 'Z' lo convierto a minúscula y lo copio en el array de palabras. */
-        if ( ('A' <= mensaje->ptr_datos[i]) && ( mensaje->ptr_datos[i]<= 'Z'))          // R_C3_7
-            {
-                /* Si no es la primer palabra o el primer carácter, cambio de palabra. */
-                if ((caracter != CARACTER_INICIAL))
-                {
-                    palabra++;                   // Incremento para cambiar de palabra.
-                    caracter = CARACTER_INICIAL; // Cambio al caracter inicial de la palabra.
-                }
-                /* Guardo caracter en minúscula. */
-                palabras[palabra][caracter] = mensaje->ptr_datos[i] + A_MINUSCULA;
-                caracter++;                  // Avanzo un caracter para la próxima iteración.
-            }
-        /* Si el caracter está entre 'a' y 'z' lo copio al array de palabras. */ 
-        else if ( ('a' <= mensaje->ptr_datos[i]) && (mensaje->ptr_datos[i] <= 'z'))     // R_C3_7
-        {
-            palabras[palabra][caracter] = mensaje->ptr_datos[i];
-            caracter++;                     // Avanzo un caracter para la próxima iteración.
-        }
-        /* Si el caracter es guion bajo o espacio cambio de palabra. */ 
-        else if ( (mensaje->ptr_datos[i] == '_' ) || (mensaje->ptr_datos[i] == ' ' ) )
+        if ( origen >= INDICE_CAMPO_DATOS + APP_SWAR_BYTES )
         {
-            /* Si el caracter no es el inicial salto de palabra.*/
-            if (caracter != CARACTER_INICIAL)
+            memcpy( &w, &datos[origen - APP_SWAR_BYTES], APP_SWAR_BYTES );
+            mayusculas = app_swar_rango( w, 'A', 'Z' );
+            if ( mayusculas == 0 )
             {
-                palabra++;                   // Incremento para cambiar de palabra.
-                caracter = CARACTER_INICIAL; // Cambio al caracter inicial de la palabra.
+                origen -= APP_SWAR_BYTES;
+                destino -= APP_SWAR_BYTES;
+                memcpy( &datos[destino], &w, APP_SWAR_BYTES );
+                continue;
             }
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+            mayusculas = __builtin_bswap32( mayusculas );
+#endif
+            /* Las minúsculas detrás de la última mayúscula se copian sin cambios */
+            for ( uint32_t n = (uint32_t)__builtin_clz( mayusculas ) / 8; n > 0; n-- )
+                datos[--destino] = datos[--origen];
         }
-    }
-}
-
-/**
- * @brief Inicializa la matriz de palabras.
- * 
- * @param palabras Matriz de palabras a inicializar 
- */
-static void app_inicializar_array_palabras(uint8_t (*palabras)[CANT_LETRAS_MAX])
-{
-    for (uint32_t i = 0 ; i < CANT_PALABRAS_MAX ; i++)
-        for (uint32_t j = 0 ; j < CANT_LETRAS_MAX ; j++)
+        c = datos[--origen];
+        if ( ('A' <= c) && (c <= 'Z') )
         {
-            palabras[i][j] = 0;
+            datos[--destino] = c + A_MINUSCULA;
+            datos[--destino] = '_';
         }
+        else
+            datos[--destino] = c;
+    }
+    /* La primera palabra no lleva '_', sólo se pasa su inicial a minúscula */
+    datos[INDICE_CAMPO_DATOS] += A_MINUSCULA;
+    return true;
 }
 
 /**
@@ -396,3 +363,124 @@ static void app_insertar_mensaje_error(uint8_t error_type, tMensaje* mensaje )
     mensaje->ptr_datos[pos++] = error_type + '0';
     mensaje->cantidad = 3;
 }
+
+/**
+ * @brief       Responde el paquete con un mensaje de error
+ * 
+ * @details     El paquete pudo haberse publicado a otros OA, así que el error se escribe en una respuesta corta
+ *              propia (ver sf_mensaje_corto), sin esperar a que los suscriptores lo suelten.
+ * 
+ * @param ptr_me        Estructura de la aplicación
+ * @param error_type    Tipo de error
+ * @param mensaje       Paquete a responder
+ */
+static void app_responder_error( app_t* ptr_me, uint8_t error_type, tMensaje* mensaje )
+{
+    tMensaje* respuesta = sf_mensaje_corto( ptr_me->handler_sf, mensaje );
+
+    /* Sin memoria para el error, el paquete se descarta */
+    if ( respuesta == NULL )
+    {
+        objeto_evento_liberar( mensaje );
+        return;
+    }
+    app_insertar_mensaje_error( error_type , respuesta );
+    app_enviar( ptr_me, respuesta );
+}
+
+/**
+ * @brief       Encola la respuesta hacia la capa 2, la transmisión la dispara app_OAapp_flush al final del lote
+ * 
+ * @param ptr_me        Estructura de la aplicación
+ * @param mensaje       Respuesta a enviar
+ */
+static void app_enviar( app_t* ptr_me, tMensaje* mensaje )
+{
+    sf_mensaje_procesado_encolar( ptr_me->handler_sf, mensaje );
+    ptr_me->tx_pendiente = true;
+}
+
+/**
+ * @brief       Cada un segundo calcula cuántas veces se crearon los OA de procesamiento
+ * 
+ * @param ptr_me        Estructura de la aplicación
+ */
+static void app_creaciones_actualizar( app_t* ptr_me )
+{
+    TickType_t ahora = xTaskGetTickCount();
+    TickType_t transcurrido = ahora - ptr_me->creaciones_inicio;
+    uint32_t creaciones;
+
+    if ( transcurrido >= pdMS_TO_TICKS( 1000 ) )
+    {
+        creaciones = ptr_me->OA_C.creations + ptr_me->OA_P.creations + ptr_me->OA_S.creations;
+        ptr_me->creaciones_por_segundo = ( creaciones - ptr_me->creaciones_base ) * configTICK_RATE_HZ / transcurrido;
+        ptr_me->creaciones_base = creaciones;
+        ptr_me->creaciones_inicio = ahora;
+    }
+}
+
+#if APP_PERFIL_PERIODO_MS > 0
+/**
+ * @brief       Cada APP_PERFIL_PERIODO_MS guarda el perfil de los frames recibidos
+ * 
+ * @details     Se llama desde la tarea del OA_app, fuera de las ISR, así sf_perfil_guardar puede escribir en la
+ *              memoria no volátil. Sin paquetes no se llama, pero tampoco cambia el perfil.
+ * 
+ * @param ptr_me        Estructura de la aplicación
+ */
+static void app_perfil_guardar( app_t* ptr_me )
+{
+    TickType_t ahora = xTaskGetTickCount();
+
+    if ( ( ahora - ptr_me->perfil_inicio ) >= pdMS_TO_TICKS( APP_PERFIL_PERIODO_MS ) )
+    {
+        ptr_me->perfil_inicio = ahora;
+        ( void )sf_perfil_guardar( ptr_me->handler_sf );
+    }
+}
+#endif
+
+#if APP_OA_TIBIOS > 0
+/**
+ * @brief       Cuenta el paquete en el uso de su formato y deja inmortales los OA de los APP_OA_TIBIOS formatos
+ *              más usados
+ * 
+ * @details     Cada APP_USO_VENTANA paquetes el uso se reduce a la mitad, así pesa más el tráfico reciente. Un OA
+ *              que deja de estar entre los más usados termina la próxima vez que se vacíe su cola.
+ * 
+ * @param ptr_me        Estructura de la aplicación
+ * @param formato       Campo C del paquete
+ */
+static void app_uso_actualizar( app_t* ptr_me, uint8_t formato )
+{
+    static const uint8_t formatos[APP_FORMATOS] = { 'C', 'P', 'S' };
+    activeObject_t* oa[APP_FORMATOS] = { &ptr_me->OA_C, &ptr_me->OA_P, &ptr_me->OA_S };
+    uint8_t mas_usados;
+    uint8_t i, j;
+
+    for ( i = 0; i < APP_FORMATOS; i++ )
+    {
+        if ( formatos[i] == formato )
+            ptr_me->uso[i]++;
+    }
+    if ( ++ptr_me->uso_paquetes == APP_USO_VENTANA )
+    {
+        ptr_me->uso_paquetes = 0;
+        for ( i = 0; i < APP_FORMATOS; i++ )
+            ptr_me->uso[i] /= 2;
+    }
+
+    for ( i = 0; i < APP_FORMATOS; i++ )
+    {
+        /* Formatos más usados que este, a igual uso gana el primero */
+        mas_usados = 0;
+        for ( j = 0; j < APP_FORMATOS; j++ )
+        {
+            if ( ( ptr_me->uso[j] > ptr_me->uso[i] ) || ( ( ptr_me->uso[j] == ptr_me->uso[i] ) && ( j < i ) ) )
+                mas_usados++;
+        }
+        oa[i]->itIsImmortal = ( mas_usados < APP_OA_TIBIOS ) && ( ptr_me->uso[i] > 0 );
+    }
+}
+#endif
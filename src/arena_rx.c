@@ -0,0 +1,167 @@
+/*=============================================================================
+ * Copyright (c) 2021, Fernando Prokopiuk <fernandoprokopiuk@gmail.com>
+ * 					   Jonathan Cagua <jonathan.cagua@gmail.com>
+ * 					   Leandro Arrieta <leandroarrieta@gmail.com>
+ * All rights reserved.
+ * License: Free
+ * Date: 18/10/2026
+ * Version: v1.0
+ *===========================================================================*/
+
+#include "arena_rx.h"
+#include "FreeRTOS.h"
+#include <string.h>
+
+/**
+ * @brief Inicializa la arena vacía.
+ *
+ * @param[in] me        Puntero a la arena.
+ * @param[in] memoria   Segmento de memoria.
+ * @param[in] tam       Tamaño del segmento en bytes, hasta 64 kB.
+ *
+ * @return true  Si los parámetros son válidos.
+ * @return false Si los parámetros son inválidos.
+ */
+bool arena_init(arena_t* me, void* memoria, uint32_t tam)
+{
+	if ((me == NULL) || (memoria == NULL) || (tam == 0) || (tam > UINT16_MAX))
+		return false;
+	memset(me, 0, sizeof(arena_t));
+	me->memoria = (uint8_t*)memoria;
+	me->tam = tam;
+	return true;
+}
+
+/**
+ * @brief Indica si la cabeza dio la vuelta y quedó antes del frame más viejo.
+ *
+ * @param[in] me Puntero a la arena.
+ */
+static bool arena_cabeza_atras(arena_t* me)
+{
+	return (me->cant_frames > 0) && (me->cabeza <= me->frames[me->primero].inicio);
+}
+
+/**
+ * @brief Calcula los bytes contiguos libres a partir de la cabeza.
+ *
+ * @param[in] me Puntero a la arena.
+ *
+ * @return uint32_t Bytes libres, sin contar el lugar al principio de la arena.
+ */
+uint32_t arena_disponible(arena_t* me)
+{
+	if (arena_cabeza_atras(me))
+		return me->frames[me->primero].inicio - me->cabeza;
+	return me->tam - me->cabeza;
+}
+
+/**
+ * @brief Empieza un frame en la cabeza.
+ *
+ * @details Si la arena está vacía el frame empieza al principio.
+ *
+ * @param[in] me        Puntero a la arena.
+ * @param[in] minimo    Bytes contiguos que tiene que tener libres el frame.
+ *
+ * @return uint8_t* Inicio del frame o NULL si no hay lugar.
+ */
+uint8_t* arena_frame_iniciar(arena_t* me, uint32_t minimo)
+{
+	if (me->cant_frames == ARENA_FRAMES_MAX)
+	{
+		me->estadisticas.sin_lugar++;
+		return NULL;
+	}
+	if (me->cant_frames == 0)
+		me->cabeza = 0;
+	return arena_frame_asegurar(me, 0, minimo);
+}
+
+/**
+ * @brief Se asegura que el frame en recepción tenga un mínimo de bytes contiguos libres.
+ *
+ * @details Si no hay lugar hasta el final de la arena y el principio está libre, mueve los bytes ya
+ *          recibidos al principio.
+ *
+ * @param[in] me        Puntero a la arena.
+ * @param[in] cantidad  Bytes del frame ya recibidos.
+ * @param[in] minimo    Bytes contiguos que tiene que tener libres el frame, contando los recibidos.
+ *
+ * @return uint8_t* Inicio del frame, que pudo haberse movido, o NULL si no hay lugar.
+ */
+uint8_t* arena_frame_asegurar(arena_t* me, uint32_t cantidad, uint32_t minimo)
+{
+	uint32_t libre_al_principio;
+
+	if (arena_disponible(me) >= minimo)
+		return me->memoria + me->cabeza;
+
+	// Sólo se puede dar la vuelta si la cabeza está delante del frame más viejo
+	libre_al_principio = (me->cant_frames == 0) ? me->tam : me->frames[me->primero].inicio;
+	if (arena_cabeza_atras(me) || (libre_al_principio < minimo))
+	{
+		me->estadisticas.sin_lugar++;
+		return NULL;
+	}
+	memmove(me->memoria, me->memoria + me->cabeza, cantidad);
+	me->cabeza = 0;
+	me->estadisticas.vueltas++;
+	me->estadisticas.bytes_movidos += cantidad;
+	return me->memoria;
+}
+
+/**
+ * @brief Entrega el frame en recepción: queda reservado hasta que se libere y el próximo empieza a continuación.
+ *
+ * @param[in] me    Puntero a la arena.
+ * @param[in] tam   Bytes a reservar, a lo sumo los asegurados al recibir el frame.
+ */
+void arena_frame_cerrar(arena_t* me, uint32_t tam)
+{
+	arena_frame_t* frame;
+
+	configASSERT((me->cant_frames < ARENA_FRAMES_MAX) && (tam <= arena_disponible(me)));
+	frame = &me->frames[(me->primero + me->cant_frames) % ARENA_FRAMES_MAX];
+	frame->inicio = me->cabeza;
+	frame->tam = tam;
+	frame->liberado = false;
+	me->cant_frames++;
+	me->cabeza += tam;
+	me->estadisticas.ocupados += tam;
+	if (me->estadisticas.ocupados > me->estadisticas.ocupados_max)
+		me->estadisticas.ocupados_max = me->estadisticas.ocupados;
+}
+
+/**
+ * @brief Libera un frame entregado.
+ *
+ * @details Normalmente es el más viejo. Si no, se marca y su lugar se recupera junto con el de los anteriores.
+ *
+ * @param[in] me    Puntero a la arena.
+ * @param[in] frame Inicio del frame.
+ */
+void arena_frame_liberar(arena_t* me, void* frame)
+{
+	uint32_t inicio = (uint8_t*)frame - me->memoria;
+	uint8_t i;
+	uint8_t indice = me->primero;
+
+	for (i = 0; i < me->cant_frames; i++)
+	{
+		indice = (me->primero + i) % ARENA_FRAMES_MAX;
+		if ((me->frames[indice].inicio == inicio) && !me->frames[indice].liberado)
+			break;
+	}
+	configASSERT(i < me->cant_frames);
+	me->frames[indice].liberado = true;
+	if (i > 0)
+		me->estadisticas.fuera_de_orden++;
+
+	while ((me->cant_frames > 0) && me->frames[me->primero].liberado)
+	{
+		me->estadisticas.ocupados -= me->frames[me->primero].tam;
+		me->primero = (me->primero + 1) % ARENA_FRAMES_MAX;
+		me->cant_frames--;
+	}
+}
@@ -46,29 +46,157 @@
  *}
  */
 
+/*
+ * The 256-entry tables are built by the preprocessor, so they are const data
+ * placed in flash. CRC8 is linear over GF(2): the entry for any byte is the
+ * XOR of the entries for its set bits, so each table is described only by
+ * its 8 single-bit entries (the basis).
+ *
+ * crc8_table_k[b] is the CRC of byte b followed by k zero bytes, that is,
+ * crc8_table_k[b] = crc8_table_0[crc8_table_(k-1)[b]]. The bases below were
+ * obtained with:
+ *
+ * for (k = 0; k < 8; k++)
+ *	for (i = 0; i < 8; i++)
+ *		basis[k][i] = (k == 0) ? gen_byte(1 << i) :
+ *		    table[0][basis[k - 1][i]];
+ */
+
+#include <string.h>
 #include "crc8.h"
 
-static uint8_t crc8_small_table[16] = {
+#if (CRC8_ENGINE == CRC8_ENGINE_NIBBLE)
+
+static const uint8_t crc8_small_table[16] = {
     0x00, 0x07, 0x0e, 0x09, 0x1c, 0x1b, 0x12, 0x15,
     0x38, 0x3f, 0x36, 0x31, 0x24, 0x23, 0x2a, 0x2d
 };
 
+#else
+
+#define CRC8_BASIS_0    0x07, 0x0e, 0x1c, 0x38, 0x70, 0xe0, 0xc7, 0x89
+#define CRC8_BASIS_1    0x15, 0x2a, 0x54, 0xa8, 0x57, 0xae, 0x5b, 0xb6
+#define CRC8_BASIS_2    0x6b, 0xd6, 0xab, 0x51, 0xa2, 0x43, 0x86, 0x0b
+#define CRC8_BASIS_3    0x16, 0x2c, 0x58, 0xb0, 0x67, 0xce, 0x9b, 0x31
+#define CRC8_BASIS_4    0x62, 0xc4, 0x8f, 0x19, 0x32, 0x64, 0xc8, 0x97
+#define CRC8_BASIS_5    0x29, 0x52, 0xa4, 0x4f, 0x9e, 0x3b, 0x76, 0xec
+#define CRC8_BASIS_6    0xdf, 0xb9, 0x75, 0xea, 0xd3, 0xa1, 0x45, 0x8a
+#define CRC8_BASIS_7    0x13, 0x26, 0x4c, 0x98, 0x37, 0x6e, 0xdc, 0xbf
+
+#define CRC8_LIN(b, c0, c1, c2, c3, c4, c5, c6, c7)                     \
+    (uint8_t)((((b) & 0x01) ? (c0) : 0) ^ (((b) & 0x02) ? (c1) : 0) ^   \
+              (((b) & 0x04) ? (c2) : 0) ^ (((b) & 0x08) ? (c3) : 0) ^   \
+              (((b) & 0x10) ? (c4) : 0) ^ (((b) & 0x20) ? (c5) : 0) ^   \
+              (((b) & 0x40) ? (c6) : 0) ^ (((b) & 0x80) ? (c7) : 0))
+#define CRC8_E(b, k)            CRC8_E_(b, CRC8_BASIS_##k)
+#define CRC8_E_(b, ...)         CRC8_LIN(b, __VA_ARGS__)
+#define CRC8_R4(b, k)           CRC8_E((b), k), CRC8_E((b) + 1, k), \
+                                CRC8_E((b) + 2, k), CRC8_E((b) + 3, k)
+#define CRC8_R16(b, k)          CRC8_R4((b), k), CRC8_R4((b) + 4, k), \
+                                CRC8_R4((b) + 8, k), CRC8_R4((b) + 12, k)
+#define CRC8_R64(b, k)          CRC8_R16((b), k), CRC8_R16((b) + 16, k), \
+                                CRC8_R16((b) + 32, k), CRC8_R16((b) + 48, k)
+#define CRC8_TABLE(k)           { CRC8_R64(0, k), CRC8_R64(64, k), \
+                                  CRC8_R64(128, k), CRC8_R64(192, k) }
+
+static const uint8_t crc8_table[][256] = {
+    CRC8_TABLE(0),
+#if (CRC8_ENGINE == CRC8_ENGINE_SLICE4) || (CRC8_ENGINE == CRC8_ENGINE_SLICE8)
+    CRC8_TABLE(1),
+    CRC8_TABLE(2),
+    CRC8_TABLE(3),
+#endif
+#if (CRC8_ENGINE == CRC8_ENGINE_SLICE8)
+    CRC8_TABLE(4),
+    CRC8_TABLE(5),
+    CRC8_TABLE(6),
+    CRC8_TABLE(7),
+#endif
+};
+
+#endif
+
 uint8_t
 crc8_init(void)
 {
     return 0xff;
 }
 
+/*
+ * Feeds a single byte into a running CRC, for callers that see the data one
+ * byte at a time. crc8_update(crc8_update(v, a), b) == crc8_calc(v, {a, b}, 2).
+ */
+uint8_t
+crc8_update(uint8_t val, uint8_t byte)
+{
+#if (CRC8_ENGINE == CRC8_ENGINE_NIBBLE)
+	val ^= byte;
+	val = (val << 4) ^ crc8_small_table[val >> 4];
+	val = (val << 4) ^ crc8_small_table[val >> 4];
+	return val;
+#else
+	return crc8_table[0][val ^ byte];
+#endif
+}
+
+#if (CRC8_ENGINE == CRC8_ENGINE_SLICE4) || (CRC8_ENGINE == CRC8_ENGINE_SLICE8)
+/*
+ * Loads 4 bytes as a word with p[0] in the least significant byte.
+ */
+static inline uint32_t
+crc8_load32(const uint8_t *p)
+{
+	uint32_t w;
+
+	memcpy(&w, p, sizeof(w));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	w = __builtin_bswap32(w);
+#endif
+	return w;
+}
+#endif
+
 uint8_t
 crc8_calc(uint8_t val, void *buf, int cnt)
 {
-	int i;
+	int i = 0;
 	uint8_t *p = buf;
 
-	for (i = 0; i < cnt; i++) {
+#if (CRC8_ENGINE == CRC8_ENGINE_NIBBLE)
+	for (; i < cnt; i++) {
 		val ^= p[i];
 		val = (val << 4) ^ crc8_small_table[val >> 4];
 		val = (val << 4) ^ crc8_small_table[val >> 4];
 	}
+#else
+#if (CRC8_ENGINE == CRC8_ENGINE_SLICE8)
+	for (; i + 8 <= cnt; i += 8) {
+		uint32_t lo = crc8_load32(p + i);
+		uint32_t hi = crc8_load32(p + i + 4);
+
+		val = crc8_table[7][(val ^ lo) & 0xff] ^
+		    crc8_table[6][(lo >> 8) & 0xff] ^
+		    crc8_table[5][(lo >> 16) & 0xff] ^
+		    crc8_table[4][lo >> 24] ^
+		    crc8_table[3][hi & 0xff] ^
+		    crc8_table[2][(hi >> 8) & 0xff] ^
+		    crc8_table[1][(hi >> 16) & 0xff] ^
+		    crc8_table[0][hi >> 24];
+	}
+#endif
+#if (CRC8_ENGINE == CRC8_ENGINE_SLICE4) || (CRC8_ENGINE == CRC8_ENGINE_SLICE8)
+	for (; i + 4 <= cnt; i += 4) {
+		uint32_t w = crc8_load32(p + i);
+
+		val = crc8_table[3][(val ^ w) & 0xff] ^
+		    crc8_table[2][(w >> 8) & 0xff] ^
+		    crc8_table[1][(w >> 16) & 0xff] ^
+		    crc8_table[0][w >> 24];
+	}
+#endif
+	for (; i < cnt; i++) {
+		val = crc8_table[0][val ^ p[i]];
+	}
+#endif
 	return val;
 }
@@ -0,0 +1,413 @@
+/*
+ * Two-Level Segregated Fit (TLSF) heap for FreeRTOS, a drop-in replacement
+ * for heap_4.c with O(1) pvPortMalloc() and vPortFree().
+ *
+ * Free blocks are kept in segregated lists indexed by a first level (power
+ * of two of the size) and a second level (linear subdivision of that power
+ * of two). Two bitmaps tell which lists are non-empty, so finding a fit is a
+ * couple of bit scans instead of a walk of the free list. Neighbouring free
+ * blocks are coalesced on free, as in heap_4.
+ *
+ * Selected with FREERTOS_HEAP_TYPE=tlsf in config.mk, which leaves out the
+ * FreeRTOS heap_N.c and defines USE_HEAP_TLSF.
+ */
+
+#ifdef USE_HEAP_TLSF
+
+#include <stdlib.h>
+#include <stddef.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#if( configSUPPORT_DYNAMIC_ALLOCATION == 0 )
+    #error This file must not be used if configSUPPORT_DYNAMIC_ALLOCATION is 0
+#endif
+
+/* Second level subdivisions per power of two, as log2. Eight subdivisions
+bound the internal fragmentation to 1/8 of the request and keep the list
+heads small enough for an MCU. */
+#ifndef configTLSF_SL_INDEX_COUNT_LOG2
+    #define configTLSF_SL_INDEX_COUNT_LOG2   3
+#endif
+
+/* log2 of the largest block the heap can hold, must cover
+configTOTAL_HEAP_SIZE. */
+#ifndef configTLSF_FL_INDEX_MAX
+    #define configTLSF_FL_INDEX_MAX          16
+#endif
+
+#define heapALIGNMENT_LOG2          ( ( portBYTE_ALIGNMENT == 8 ) ? 3 : ( ( portBYTE_ALIGNMENT == 4 ) ? 2 : 1 ) )
+#define heapSL_INDEX_COUNT          ( 1U << configTLSF_SL_INDEX_COUNT_LOG2 )
+#define heapFL_INDEX_SHIFT          ( configTLSF_SL_INDEX_COUNT_LOG2 + heapALIGNMENT_LOG2 )
+#define heapFL_INDEX_COUNT          ( configTLSF_FL_INDEX_MAX - heapFL_INDEX_SHIFT + 1 )
+#define heapSMALL_BLOCK_SIZE        ( ( size_t ) 1 << heapFL_INDEX_SHIFT )
+
+/* Bit 0 of xSize marks a free block, sizes are always aligned. */
+#define heapBLOCK_FREE_BIT          ( ( size_t ) 1 )
+
+/*-----------------------------------------------------------*/
+
+/* The header of every block. pxNextFree and pxPrevFree are only valid while
+the block is free, when allocated they are part of the payload. */
+typedef struct A_BLOCK_HEADER
+{
+    struct A_BLOCK_HEADER *pxPrevPhys;  /*<< The block just before this one in memory, NULL for the first. */
+    size_t xSize;                       /*<< Size of the block including the header, and the free bit. */
+    struct A_BLOCK_HEADER *pxNextFree;  /*<< The next free block in the same list. */
+    struct A_BLOCK_HEADER *pxPrevFree;  /*<< The previous free block in the same list. */
+} BlockHeader_t;
+
+/* Bytes of header in front of the memory handed to the application. */
+static const size_t xHeapHeaderSize = ( offsetof( BlockHeader_t, pxNextFree ) + ( portBYTE_ALIGNMENT - 1 ) ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+/* A free block has to be able to hold the list pointers. */
+static const size_t xHeapMinimumBlockSize = ( sizeof( BlockHeader_t ) + ( portBYTE_ALIGNMENT - 1 ) ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+/*-----------------------------------------------------------*/
+
+/* Allocate the memory for the heap. */
+#if( configAPPLICATION_ALLOCATED_HEAP == 1 )
+    /* The application writer has already defined the array used for the RTOS
+    heap - probably so it can be placed in a special segment or address. */
+    extern uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
+#else
+    static uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
+#endif /* configAPPLICATION_ALLOCATED_HEAP */
+
+/* Bitmap of first level lists that have a non-empty second level list. */
+static uint32_t ulFLBitmap = 0;
+
+/* For each first level, bitmap of the non-empty second level lists. */
+static uint32_t ulSLBitmap[ heapFL_INDEX_COUNT ];
+
+/* Heads of the free lists. */
+static BlockHeader_t *pxFreeBlocks[ heapFL_INDEX_COUNT ][ heapSL_INDEX_COUNT ];
+
+/* Zero sized, always allocated block at the end of the heap, stops the last
+block from being coalesced past the end. */
+static BlockHeader_t *pxEnd = NULL;
+
+/* Keeps track of the number of free bytes remaining, but says nothing about
+fragmentation. */
+static size_t xFreeBytesRemaining = 0U;
+static size_t xMinimumEverFreeBytesRemaining = 0U;
+
+/*-----------------------------------------------------------*/
+
+static void prvHeapInit( void );
+
+/*-----------------------------------------------------------*/
+
+/* Index of the most significant set bit. */
+static size_t prvFls( size_t xValue )
+{
+    return ( sizeof( unsigned long ) * 8U ) - 1U - ( size_t ) __builtin_clzl( ( unsigned long ) xValue );
+}
+
+/* Index of the least significant set bit. */
+static uint32_t prvFfs( uint32_t ulValue )
+{
+    return ( uint32_t ) __builtin_ctz( ulValue );
+}
+
+/* The lists a block of xSize bytes belongs to. */
+static void prvMappingInsert( size_t xSize, uint32_t *pulFL, uint32_t *pulSL )
+{
+    size_t xFL;
+
+    if( xSize < heapSMALL_BLOCK_SIZE )
+    {
+        *pulFL = 0U;
+        *pulSL = ( uint32_t ) ( xSize >> heapALIGNMENT_LOG2 );
+    }
+    else
+    {
+        xFL = prvFls( xSize );
+        *pulSL = ( uint32_t ) ( xSize >> ( xFL - configTLSF_SL_INDEX_COUNT_LOG2 ) ) ^ heapSL_INDEX_COUNT;
+        *pulFL = ( uint32_t ) ( xFL - ( heapFL_INDEX_SHIFT - 1U ) );
+    }
+}
+
+/* The first lists whose blocks are all at least xSize bytes, so the search
+never has to look inside a list. */
+static void prvMappingSearch( size_t xSize, uint32_t *pulFL, uint32_t *pulSL )
+{
+    if( xSize >= heapSMALL_BLOCK_SIZE )
+    {
+        xSize += ( ( size_t ) 1 << ( prvFls( xSize ) - configTLSF_SL_INDEX_COUNT_LOG2 ) ) - 1U;
+    }
+
+    prvMappingInsert( xSize, pulFL, pulSL );
+}
+
+static void prvInsertFreeBlock( BlockHeader_t *pxBlock )
+{
+    uint32_t ulFL, ulSL;
+
+    prvMappingInsert( pxBlock->xSize & ~heapBLOCK_FREE_BIT, &ulFL, &ulSL );
+    configASSERT( ulFL < heapFL_INDEX_COUNT );
+
+    pxBlock->pxPrevFree = NULL;
+    pxBlock->pxNextFree = pxFreeBlocks[ ulFL ][ ulSL ];
+    if( pxBlock->pxNextFree != NULL )
+    {
+        pxBlock->pxNextFree->pxPrevFree = pxBlock;
+    }
+    pxFreeBlocks[ ulFL ][ ulSL ] = pxBlock;
+
+    ulFLBitmap |= ( 1UL << ulFL );
+    ulSLBitmap[ ulFL ] |= ( 1UL << ulSL );
+}
+
+static void prvRemoveFreeBlock( BlockHeader_t *pxBlock )
+{
+    uint32_t ulFL, ulSL;
+
+    prvMappingInsert( pxBlock->xSize & ~heapBLOCK_FREE_BIT, &ulFL, &ulSL );
+
+    if( pxBlock->pxNextFree != NULL )
+    {
+        pxBlock->pxNextFree->pxPrevFree = pxBlock->pxPrevFree;
+    }
+    if( pxBlock->pxPrevFree != NULL )
+    {
+        pxBlock->pxPrevFree->pxNextFree = pxBlock->pxNextFree;
+    }
+    else
+    {
+        pxFreeBlocks[ ulFL ][ ulSL ] = pxBlock->pxNextFree;
+        if( pxBlock->pxNextFree == NULL )
+        {
+            ulSLBitmap[ ulFL ] &= ~( 1UL << ulSL );
+            if( ulSLBitmap[ ulFL ] == 0U )
+            {
+                ulFLBitmap &= ~( 1UL << ulFL );
+            }
+        }
+    }
+}
+
+static BlockHeader_t *prvNextPhys( BlockHeader_t *pxBlock )
+{
+    return ( BlockHeader_t * ) ( ( ( uint8_t * ) pxBlock ) + ( pxBlock->xSize & ~heapBLOCK_FREE_BIT ) );
+}
+
+/*-----------------------------------------------------------*/
+
+void *pvPortMalloc( size_t xWantedSize )
+{
+BlockHeader_t *pxBlock = NULL, *pxRemainder;
+uint32_t ulFL, ulSL, ulMap;
+size_t xBlockSize;
+void *pvReturn = NULL;
+
+    vTaskSuspendAll();
+    {
+        /* If this is the first call to malloc then the heap will require
+        initialisation to setup the lists of free blocks. */
+        if( pxEnd == NULL )
+        {
+            prvHeapInit();
+        }
+
+        /* Add the header and round up to the alignment, without wrapping. */
+        if( ( xWantedSize > 0U ) && ( xWantedSize <= ( configTOTAL_HEAP_SIZE - xHeapHeaderSize ) ) )
+        {
+            xBlockSize = ( xWantedSize + xHeapHeaderSize + portBYTE_ALIGNMENT_MASK ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+            if( xBlockSize < xHeapMinimumBlockSize )
+            {
+                xBlockSize = xHeapMinimumBlockSize;
+            }
+
+            prvMappingSearch( xBlockSize, &ulFL, &ulSL );
+
+            if( ulFL < heapFL_INDEX_COUNT )
+            {
+                /* A list in the same first level with large enough blocks,
+                otherwise the smallest non-empty first level above it. */
+                ulMap = ulSLBitmap[ ulFL ] & ( ~0UL << ulSL );
+                if( ulMap == 0U )
+                {
+                    ulMap = ( ulFL + 1U < 32U ) ? ( ulFLBitmap & ( ~0UL << ( ulFL + 1U ) ) ) : 0U;
+                    if( ulMap != 0U )
+                    {
+                        ulFL = prvFfs( ulMap );
+                        ulMap = ulSLBitmap[ ulFL ];
+                    }
+                }
+
+                if( ulMap != 0U )
+                {
+                    ulSL = prvFfs( ulMap );
+                    pxBlock = pxFreeBlocks[ ulFL ][ ulSL ];
+                }
+            }
+
+            /* The rounded up search skips the list the size itself maps to,
+            whose blocks may still be large enough. Trying its head keeps the
+            last free block of the heap usable, still in constant time. */
+            if( pxBlock == NULL )
+            {
+                prvMappingInsert( xBlockSize, &ulFL, &ulSL );
+                if( ( ulFL < heapFL_INDEX_COUNT ) && ( pxFreeBlocks[ ulFL ][ ulSL ] != NULL ) &&
+                    ( ( pxFreeBlocks[ ulFL ][ ulSL ]->xSize & ~heapBLOCK_FREE_BIT ) >= xBlockSize ) )
+                {
+                    pxBlock = pxFreeBlocks[ ulFL ][ ulSL ];
+                }
+            }
+        }
+
+        if( pxBlock != NULL )
+        {
+            prvRemoveFreeBlock( pxBlock );
+
+            /* Split off what is left if it is large enough to be a block. */
+            if( ( ( pxBlock->xSize & ~heapBLOCK_FREE_BIT ) - xBlockSize ) >= xHeapMinimumBlockSize )
+            {
+                pxRemainder = ( BlockHeader_t * ) ( ( ( uint8_t * ) pxBlock ) + xBlockSize );
+                pxRemainder->xSize = ( ( pxBlock->xSize & ~heapBLOCK_FREE_BIT ) - xBlockSize ) | heapBLOCK_FREE_BIT;
+                pxRemainder->pxPrevPhys = pxBlock;
+                prvNextPhys( pxRemainder )->pxPrevPhys = pxRemainder;
+                prvInsertFreeBlock( pxRemainder );
+                pxBlock->xSize = xBlockSize;
+            }
+
+            /* The block is being returned - it is allocated. */
+            pxBlock->xSize &= ~heapBLOCK_FREE_BIT;
+
+            xFreeBytesRemaining -= pxBlock->xSize;
+            if( xFreeBytesRemaining < xMinimumEverFreeBytesRemaining )
+            {
+                xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+            }
+
+            pvReturn = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xHeapHeaderSize );
+        }
+
+        traceMALLOC( pvReturn, xWantedSize );
+    }
+    ( void ) xTaskResumeAll();
+
+    #if( configUSE_MALLOC_FAILED_HOOK == 1 )
+    {
+        if( pvReturn == NULL )
+        {
+            extern void vApplicationMallocFailedHook( void );
+            vApplicationMallocFailedHook();
+        }
+    }
+    #endif
+
+    configASSERT( ( ( ( size_t ) pvReturn ) & ( size_t ) portBYTE_ALIGNMENT_MASK ) == 0 );
+    return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree( void *pv )
+{
+BlockHeader_t *pxBlock, *pxNeighbour;
+
+    if( pv != NULL )
+    {
+        pxBlock = ( BlockHeader_t * ) ( ( ( uint8_t * ) pv ) - xHeapHeaderSize );
+
+        /* Check the block is actually allocated. */
+        configASSERT( ( pxBlock->xSize & heapBLOCK_FREE_BIT ) == 0 );
+
+        vTaskSuspendAll();
+        {
+            xFreeBytesRemaining += pxBlock->xSize;
+            traceFREE( pv, pxBlock->xSize );
+
+            /* Coalesce with the previous block in memory. */
+            pxNeighbour = pxBlock->pxPrevPhys;
+            if( ( pxNeighbour != NULL ) && ( ( pxNeighbour->xSize & heapBLOCK_FREE_BIT ) != 0 ) )
+            {
+                prvRemoveFreeBlock( pxNeighbour );
+                pxNeighbour->xSize += pxBlock->xSize;
+                pxBlock = pxNeighbour;
+            }
+            else
+            {
+                pxBlock->xSize |= heapBLOCK_FREE_BIT;
+            }
+
+            /* Coalesce with the next block in memory, never the end marker. */
+            pxNeighbour = prvNextPhys( pxBlock );
+            if( ( pxNeighbour->xSize & heapBLOCK_FREE_BIT ) != 0 )
+            {
+                prvRemoveFreeBlock( pxNeighbour );
+                pxBlock->xSize += pxNeighbour->xSize & ~heapBLOCK_FREE_BIT;
+                pxNeighbour = prvNextPhys( pxBlock );
+            }
+            pxNeighbour->pxPrevPhys = pxBlock;
+
+            prvInsertFreeBlock( pxBlock );
+        }
+        ( void ) xTaskResumeAll();
+    }
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize( void )
+{
+    return xFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetMinimumEverFreeHeapSize( void )
+{
+    return xMinimumEverFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+void vPortInitialiseBlocks( void )
+{
+    /* This just exists to keep the linker quiet. */
+}
+/*-----------------------------------------------------------*/
+
+static void prvHeapInit( void )
+{
+BlockHeader_t *pxFirstBlock;
+size_t uxAddress;
+size_t xTotalHeapSize = configTOTAL_HEAP_SIZE;
+
+    /* Ensure the heap starts on a correctly aligned boundary. */
+    uxAddress = ( size_t ) ucHeap;
+
+    if( ( uxAddress & portBYTE_ALIGNMENT_MASK ) != 0 )
+    {
+        uxAddress += ( portBYTE_ALIGNMENT - 1 );
+        uxAddress &= ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+        xTotalHeapSize -= uxAddress - ( size_t ) ucHeap;
+    }
+    xTotalHeapSize &= ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+    configASSERT( xTotalHeapSize < ( ( size_t ) 1 << configTLSF_FL_INDEX_MAX ) );
+
+    /* The end marker only needs the header, it is never handed out. */
+    pxEnd = ( BlockHeader_t * ) ( uxAddress + xTotalHeapSize - xHeapHeaderSize );
+    pxEnd->xSize = 0U;
+
+    /* To start with there is a single free block that covers the rest of the
+    heap. */
+    pxFirstBlock = ( BlockHeader_t * ) uxAddress;
+    pxFirstBlock->pxPrevPhys = NULL;
+    pxFirstBlock->xSize = ( ( size_t ) pxEnd - uxAddress ) | heapBLOCK_FREE_BIT;
+    pxEnd->pxPrevPhys = pxFirstBlock;
+    prvInsertFreeBlock( pxFirstBlock );
+
+    /* Only one block exists - and it covers the entire usable heap space. */
+    xMinimumEverFreeBytesRemaining = ( size_t ) pxEnd - uxAddress;
+    xFreeBytesRemaining = xMinimumEverFreeBytesRemaining;
+}
+
+#endif /* USE_HEAP_TLSF */
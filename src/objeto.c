@@ -10,6 +10,7 @@
 
 /*==================[inclusiones]============================================*/
 #include "objeto.h"
+#include "qf_atomic.h"
 
 /*==================[definiciones y macros]==================================*/
 
@@ -33,33 +34,63 @@ tObjeto* objeto_crear()
 
     configASSERT(rv != NULL);
 
-    rv->cola = xQueueCreate(N_QUEUE, sizeof(tMensaje));
+    rv->cola = xQueueCreate(N_QUEUE, sizeof(tMensaje*));
 
     configASSERT(rv->cola != NULL);
 
     return rv;
 }
 
-void objeto_post(tObjeto* objeto, tMensaje mensaje)
+tObjeto* objeto_crear_estatico( tObjetoEstatico* memoria )
+{
+    tObjeto* rv = &memoria->objeto;
+
+    rv->cola = xQueueCreateStatic(N_QUEUE, sizeof(tMensaje*), memoria->almacenamiento, &memoria->cola);
+
+    configASSERT(rv->cola != NULL);
+
+    return rv;
+}
+
+void objeto_post(tObjeto* objeto, tMensaje* mensaje)
 {
 	xQueueSend(objeto->cola, &mensaje, portMAX_DELAY);
 }
 
-void objeto_post_fromISR( tObjeto* objeto,tMensaje mensaje, BaseType_t *pxHigherPriorityTaskWoken )
+bool objeto_post_fromISR( tObjeto* objeto,tMensaje* mensaje, BaseType_t *pxHigherPriorityTaskWoken )
 {
-	xQueueSendFromISR(objeto->cola, &mensaje, pxHigherPriorityTaskWoken);
+	return xQueueSendFromISR(objeto->cola, &mensaje, pxHigherPriorityTaskWoken);
 }
 
-void objeto_get(tObjeto* objeto, tMensaje* mensaje)
+void objeto_get(tObjeto* objeto, tMensaje** mensaje)
 {
     xQueueReceive(objeto->cola, mensaje, portMAX_DELAY);
 }
 
-bool objeto_get_fromISR( tObjeto* objeto,tMensaje* mensaje, BaseType_t *pxHigherPriorityTaskWoken )
+bool objeto_get_fromISR( tObjeto* objeto,tMensaje** mensaje, BaseType_t *pxHigherPriorityTaskWoken )
 {
 	return xQueueReceiveFromISR(objeto->cola, mensaje, pxHigherPriorityTaskWoken );
 }
 
+/* Suma un consumidor al evento, antes de pasarle el puntero */
+void objeto_evento_retener(tMensaje* evento)
+{
+	(void)qf_atomic_add16(&evento->referencias, 1);
+}
+
+/* Quita un consumidor del evento. Devuelve true si era el último y el que llama tiene que reciclarlo */
+bool objeto_evento_soltar(tMensaje* evento)
+{
+	return (qf_atomic_add16(&evento->referencias, -1) == 0U);
+}
+
+/* Suelta el evento y, si era la última referencia, lo recicla con su destructor. Sólo en contexto de tarea */
+void objeto_evento_liberar(tMensaje* evento)
+{
+	if (objeto_evento_soltar(evento))
+		evento->destructor(evento);
+}
+
 void objeto_borrar(tObjeto* objeto)
 {
     /* Primero se destruyen los objetos "hijos"*/
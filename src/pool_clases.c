@@ -0,0 +1,148 @@
+/*=============================================================================
+ * Copyright (c) 2021, Fernando Prokopiuk <fernandoprokopiuk@gmail.com>
+ * 					   Jonathan Cagua <jonathan.cagua@gmail.com>
+ * 					   Leandro Arrieta <leandroarrieta@gmail.com>
+ * All rights reserved.
+ * License: Free
+ * Date: 18/10/2026
+ * Version: v1.0
+ *===========================================================================*/
+
+#include "pool_clases.h"
+#include "FreeRTOS.h"
+
+/**
+ * @brief Arma un pool por cada clase, uno a continuación del otro en el segmento de memoria.
+ *
+ * @param[in] me            Puntero al conjunto de pools.
+ * @param[in] memoria       Segmento de memoria, alineado a puntero.
+ * @param[in] tam_memoria   Tamaño del segmento en bytes.
+ * @param[in] tam_bloque    Tamaño de bloque de cada clase, de menor a mayor.
+ * @param[in] cant_bloques  Cantidad de bloques de cada clase.
+ * @param[in] cant_clases   Cantidad de clases.
+ *
+ * @return true  Si todas las clases entran en el segmento.
+ * @return false Si los parámetros son inválidos.
+ */
+bool pool_clases_init(pool_clases_t* me, void* memoria, uint32_t tam_memoria,
+                      const uint16_t* tam_bloque, const uint16_t* cant_bloques, uint8_t cant_clases)
+{
+	uint8_t* inicio = (uint8_t*)memoria;
+	uint32_t tam_clase;
+	uint8_t i;
+
+	if ((me == NULL) || (memoria == NULL) || (cant_clases == 0) || (cant_clases > POOL_CLASES_MAX))
+		return false;
+
+	for (i = 0; i < cant_clases; i++)
+	{
+		if ((i > 0) && (tam_bloque[i] <= tam_bloque[i - 1]))
+			return false;
+		// QMPool redondea el bloque a un múltiplo del tamaño de un puntero
+		tam_clase = ((tam_bloque[i] + sizeof(void*) - 1) & ~(sizeof(void*) - 1)) * cant_bloques[i];
+		if (tam_clase > tam_memoria)
+			return false;
+		QMPool_init(&me->pool[i], inicio, tam_clase, tam_bloque[i]);
+		inicio += tam_clase;
+		tam_memoria -= tam_clase;
+	}
+	me->cant_clases = cant_clases;
+	return true;
+}
+
+/**
+ * @brief Pide un bloque de la clase más chica posible a partir de clase_min.
+ *
+ * @details Si la clase pedida no tiene bloques libres se prueba con las siguientes.
+ *
+ * @param[in] me        Puntero al conjunto de pools.
+ * @param[in] clase_min Clase más chica aceptable.
+ * @param[in] mags      Magazines del contexto que llama, uno por clase, o NULL para ir directo al pool.
+ * @param[out] clase    Clase del bloque obtenido.
+ *
+ * @return void* Bloque obtenido o NULL si no hay bloques libres.
+ */
+void* pool_clases_get(pool_clases_t* me, uint8_t clase_min, QMPoolMag* mags, uint8_t* clase)
+{
+	void* bloque;
+	uint8_t i;
+
+	for (i = clase_min; i < me->cant_clases; i++)
+	{
+		if (mags != NULL)
+			bloque = QMPool_magGet(&me->pool[i], &mags[i], 0);
+		else
+			bloque = QMPool_get(&me->pool[i], 0);
+		if (bloque != NULL)
+		{
+			*clase = i;
+			return bloque;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Devuelve un bloque al pool de su clase.
+ *
+ * @param[in] me        Puntero al conjunto de pools.
+ * @param[in] bloque    Inicio del bloque.
+ * @param[in] mags      Magazines del contexto que llama, uno por clase, o NULL para ir directo al pool.
+ */
+void pool_clases_put(pool_clases_t* me, void* bloque, QMPoolMag* mags)
+{
+	uint8_t i = pool_clases_clase(me, bloque);
+
+	if (mags != NULL)
+		QMPool_magPut(&me->pool[i], &mags[i], bloque);
+	else
+		QMPool_put(&me->pool[i], bloque);
+}
+
+/**
+ * @brief Obtiene la clase de un bloque a partir de su dirección.
+ *
+ * @param[in] me        Puntero al conjunto de pools.
+ * @param[in] bloque    Puntero dentro del bloque.
+ *
+ * @return uint8_t Clase del bloque.
+ */
+uint8_t pool_clases_clase(pool_clases_t* me, void* bloque)
+{
+	uint8_t i;
+
+	for (i = 0; i < me->cant_clases - 1; i++)
+	{
+		if ((uint8_t*)bloque < (uint8_t*)me->pool[i].end + me->pool[i].blockSize)
+			break;
+	}
+	configASSERT((uint8_t*)bloque >= (uint8_t*)me->pool[i].start);
+	return i;
+}
+
+/**
+ * @brief Devuelve el tamaño de los bloques de una clase.
+ *
+ * @param[in] me    Puntero al conjunto de pools.
+ * @param[in] clase Clase.
+ *
+ * @return uint16_t Tamaño de bloque en bytes.
+ */
+uint16_t pool_clases_tam(pool_clases_t* me, uint8_t clase)
+{
+	return me->pool[clase].blockSize;
+}
+
+#if (QF_MPOOL_TELEMETRY != 0)
+/**
+ * @brief Registra la etapa que tiene el bloque, para la telemetría del pool de su clase.
+ *
+ * @param[in] me        Puntero al conjunto de pools.
+ * @param[in] bloque    Inicio del bloque.
+ * @param[in] dueno     Etapa que tiene el bloque.
+ */
+void pool_clases_dueno(pool_clases_t* me, const void* bloque, uint8_t dueno)
+{
+	QMPool_setOwner(&me->pool[pool_clases_clase(me, (void*)bloque)], bloque, dueno);
+}
+#endif
@@ -41,6 +41,170 @@
 #include "qmpool.h"      /* QMPOOL */
 #include "FreeRTOS.h"   /* FreeRTOS */
 #include "task.h"
+#include "qf_atomic.h"
+#if (QF_MPOOL_TELEMETRY != 0)
+#include <string.h>
+#endif
+#if (QF_MPOOL_LOCKFREE != 0)
+
+/*! free list link stored in the first bytes of the free block @p i_ */
+#define QF_MPOOL_LINK_(me_, i_) \
+    (*( uint16_t volatile * )( ( uint8_t * )( me_ )->start + \
+                               ( uint32_t )( i_ ) * ( me_ )->blockSize ))
+
+/*! new value of the free list head pointing to block @p i_, with the tag
+* of the old value @p head_ incremented
+*/
+#define QF_MPOOL_HEAD_(head_, i_) \
+    ( ( ( ( head_ ) + 0x10000U ) & 0xFFFF0000U ) | ( uint32_t )( i_ ) )
+
+/*! pops a block from the free list, it must have been reserved in nFree.
+* With #QF_MPOOL_LAZY an empty list means the block is carved instead.
+*/
+static void *QMPool_pop_( QMPool * const me )
+{
+    uint32_t head;
+    uint16_t idx;
+#if (QF_MPOOL_LAZY != 0)
+    QMPoolCtr carved;
+#endif
+
+    for ( ;; )
+    {
+        head = me->free_head;
+        idx = ( uint16_t )head;
+#if (QF_MPOOL_LAZY != 0)
+        if ( idx == QF_MPOOL_NULL_IDX )
+        {
+            /* carve the next never used block. If there is none left, the
+            * reserved block is being pushed and shows up in the list
+            */
+            carved = me->nCarved;
+            if ( ( carved < me->nTot ) &&
+                 qf_atomic_cas16( &me->nCarved, carved, ( QMPoolCtr )( carved + 1U ) ) )
+            {
+                idx = ( uint16_t )carved;
+                break;
+            }
+            continue;
+        }
+#endif
+        /* the link may be stale if the block was taken meanwhile, but then
+        * the tag changed and the compare-and-swap fails
+        */
+        if ( qf_atomic_cas32( &me->free_head, head,
+                              QF_MPOOL_HEAD_( head, QF_MPOOL_LINK_( me, idx ) ) ) )
+        {
+            break;
+        }
+    }
+
+    return ( uint8_t * )me->start + ( uint32_t )idx * me->blockSize;
+}
+
+/*! pushes a block into the free list, nFree must be updated afterwards */
+static void QMPool_push_( QMPool * const me, void *b )
+{
+    uint16_t idx = ( uint16_t )( ( uint32_t )( ( uint8_t * )b - ( uint8_t * )me->start )
+                                 / me->blockSize );
+    uint32_t head;
+
+    do
+    {
+        head = me->free_head;
+        *( uint16_t volatile * )b = ( uint16_t )head; /* link into list */
+    } while ( !qf_atomic_cas32( &me->free_head, head, QF_MPOOL_HEAD_( head, idx ) ) );
+}
+#else
+
+/*! takes a block from the free list, it must have been counted in nFree.
+* With #QF_MPOOL_LAZY an empty list means the block is carved instead.
+* Must be called inside the critical section.
+*/
+static QFreeBlock *QMPool_take_( QMPool * const me )
+{
+    QFreeBlock *fb = ( QFreeBlock * )me->free_head;
+
+#if (QF_MPOOL_LAZY != 0)
+    if ( fb == ( QFreeBlock * )0 )
+    {
+        /* carve the next never used block */
+        fb = ( QFreeBlock * )( ( uint8_t * )me->start
+                               + ( uint32_t )me->nCarved * me->blockSize );
+        ++me->nCarved;
+        return fb;
+    }
+#endif
+    me->free_head = fb->next; /* set the head to the next free block */
+    return fb;
+}
+#endif
+
+#if (QF_MPOOL_TELEMETRY != 0)
+/*! telemetry of the block @p b */
+static QMPoolBlockInfo *QMPool_info_( QMPool * const me, void const * const b )
+{
+    return &me->telemetry.info[ ( uint32_t )( ( uint8_t const * )b - ( uint8_t * )me->start )
+                                / me->blockSize ];
+}
+
+/*! counts one more block held by @p owner */
+static void QMPool_own_( QMPool * const me, uint8_t const owner )
+{
+    qf_atomic_max16( &me->telemetry.nOwnedMax[owner],
+                     qf_atomic_add16( &me->telemetry.nOwned[owner], 1 ) );
+}
+
+/*! counts the block @p b taken from the pool and starts its hold time */
+static void QMPool_onGet_( QMPool * const me, void * const b )
+{
+    QMPoolBlockInfo *info;
+
+    qf_atomic_add32( &me->telemetry.nGet, 1U );
+    if ( me->telemetry.info != ( QMPoolBlockInfo * )0 )
+    {
+        info = QMPool_info_( me, b );
+        info->stamp = QF_MPOOL_TIMESTAMP();
+        info->owner = 0U;
+        QMPool_own_( me, 0U );
+    }
+}
+
+/*! counts the block @p b recycled and adds its hold time to the histogram */
+static void QMPool_onPut_( QMPool * const me, void * const b )
+{
+    QMPoolBlockInfo *info;
+    uint32_t held;
+    uint32_t bin;
+
+    qf_atomic_add32( &me->telemetry.nPut, 1U );
+    if ( me->telemetry.info != ( QMPoolBlockInfo * )0 )
+    {
+        info = QMPool_info_( me, b );
+        /* a free owner means a double put or a block taken before
+        * QMPool_attachInfo()
+        */
+        configASSERT( info->owner < QF_MPOOL_OWNERS );
+        held = QF_MPOOL_TIMESTAMP() - info->stamp;
+        bin = ( held == 0U ) ? 0U : 32U - ( uint32_t )__builtin_clz( held );
+        if ( bin >= QF_MPOOL_HIST_BINS )
+        {
+            bin = QF_MPOOL_HIST_BINS - 1U;
+        }
+        qf_atomic_add32( &me->telemetry.holdHist[bin], 1U );
+        ( void )qf_atomic_add16( &me->telemetry.nOwned[info->owner], -1 );
+        info->owner = QF_MPOOL_OWNER_FREE;
+    }
+}
+
+#define QF_MPOOL_ON_GET_(me_, b_)   QMPool_onGet_( ( me_ ), ( b_ ) )
+#define QF_MPOOL_ON_PUT_(me_, b_)   QMPool_onPut_( ( me_ ), ( b_ ) )
+#define QF_MPOOL_ON_FAIL_(me_)      qf_atomic_add32( &( me_ )->telemetry.nFail, 1U )
+#else
+#define QF_MPOOL_ON_GET_(me_, b_)   ( ( void )0 )
+#define QF_MPOOL_ON_PUT_(me_, b_)   ( ( void )0 )
+#define QF_MPOOL_ON_FAIL_(me_)      ( ( void )0 )
+#endif
 
 /****************************************************************************/
 /**
@@ -72,6 +236,11 @@
 * when interrupts are not allowed yet.
 *
 * @note
+* With #QF_MPOOL_LAZY the blocks are not linked here. The number of blocks
+* is computed with one division and QMPool_get() carves the blocks that
+* were never used, so the initialization does not depend on the pool size.
+*
+* @note
 * Many QF ports use memory pools to implement the event pools.
 *
 * @usage
@@ -81,11 +250,11 @@
 void QMPool_init( QMPool * const me, void * const poolSto,
                   unsigned int poolSize, unsigned short blockSize )
 {
+#if (QF_MPOOL_LOCKFREE == 0) && (QF_MPOOL_LAZY == 0)
     QFreeBlock *fb;
+#endif
     unsigned short nblocks;
 
-    me->free_head = poolSto;
-
     /* round up the blockSize to fit an integer # free blocks, no division */
     me->blockSize = ( QMPoolSize )sizeof( QFreeBlock ); /* start with just one */
     nblocks = ( unsigned short )1; /* #free blocks that fit in one memory block */
@@ -96,6 +265,44 @@ void QMPool_init( QMPool * const me, void * const poolSto,
     }
     blockSize = ( unsigned short )me->blockSize; /* round-up to nearest block */
 
+#if (QF_MPOOL_LAZY != 0)
+    ( void )nblocks;
+    me->start = poolSto;         /* the original start this pool buffer */
+    configASSERT( poolSize / blockSize < ( unsigned int )0xFFFFU );
+    me->nTot    = ( QMPoolCtr )( poolSize / blockSize );
+    me->nCarved = ( QMPoolCtr )0; /* no block carved yet */
+#if (QF_MPOOL_LOCKFREE != 0)
+    me->free_head = QF_MPOOL_NULL_IDX; /* empty free list, tag 0 */
+#else
+    me->free_head = ( void * )0; /* empty free list */
+#endif
+    me->nFree = me->nTot;        /* all blocks are free */
+    me->nMag  = ( QMPoolCtr )0;  /* no blocks in magazines */
+    me->nMin  = me->nTot;        /* the minimum number of free blocks */
+    me->end   = ( uint8_t * )me->start + ( uint32_t )( me->nTot - 1U ) * blockSize; /* last block */
+#elif (QF_MPOOL_LOCKFREE != 0)
+    ( void )nblocks;
+    me->start = poolSto;         /* the original start this pool buffer */
+
+    /* chain all blocks together in a free-list of block indices... */
+    me->nTot = ( QMPoolCtr )0;
+    while ( poolSize >= ( unsigned int )blockSize )
+    {
+        configASSERT( me->nTot < ( QMPoolCtr )QF_MPOOL_NULL_IDX );
+        QF_MPOOL_LINK_( me, me->nTot ) = ( uint16_t )( me->nTot + 1U );
+        poolSize -= ( unsigned int )blockSize; /* reduce available pool size */
+        ++me->nTot;              /* increment the number of blocks so far */
+    }
+
+    QF_MPOOL_LINK_( me, me->nTot - 1U ) = QF_MPOOL_NULL_IDX; /* last link */
+    me->free_head = 0U;          /* first block, tag 0 */
+    me->nFree = me->nTot;        /* all blocks are free */
+    me->nMag  = ( QMPoolCtr )0;  /* no blocks in magazines */
+    me->nMin  = me->nTot;        /* the minimum number of free blocks */
+    me->end   = ( uint8_t * )me->start + ( uint32_t )( me->nTot - 1U ) * blockSize; /* last block */
+#else
+    me->free_head = poolSto;
+
     /* chain all blocks together in a free-list... */
     poolSize -= ( unsigned int )blockSize; /* don't count the last block */
     me->nTot  = ( QMPoolCtr )1;  /* the last block already in the pool */
@@ -112,9 +319,14 @@ void QMPool_init( QMPool * const me, void * const poolSto,
 
     fb->next  = ( QFreeBlock * )0; /* the last link points to NULL */
     me->nFree = me->nTot;        /* all blocks are free */
+    me->nMag  = ( QMPoolCtr )0;  /* no blocks in magazines */
     me->nMin  = me->nTot;        /* the minimum number of free blocks */
     me->start = poolSto;         /* the original start this pool buffer */
     me->end   = fb;              /* the last block in this pool */
+#endif
+#if (QF_MPOOL_TELEMETRY != 0)
+    memset( &me->telemetry, 0, sizeof( me->telemetry ) );
+#endif
 }
 
 /****************************************************************************/
@@ -132,6 +344,11 @@ void QMPool_init( QMPool * const me, void * const poolSto,
 * @note
 * This function can be called from any task level or ISR level.
 *
+* @note
+* With #QF_MPOOL_LOCKFREE the block is pushed with a compare-and-swap on
+* the tagged head and only then counted in nFree, so a free block is never
+* counted before it can be taken from the list.
+*
 * @sa
 * QMPool_get()
 *
@@ -141,6 +358,12 @@ void QMPool_init( QMPool * const me, void * const poolSto,
 */
 void QMPool_put( QMPool * const me, void *b )
 {
+    QF_MPOOL_ON_PUT_( me, b );
+#if (QF_MPOOL_LOCKFREE != 0)
+    QMPool_push_( me, b );
+    ( void )qf_atomic_add16( &me->nFree, 1 ); /* one more free block */
+}
+#else
 
     UBaseType_t uxSavedInterruptStatus;
     /** @pre # free blocks cannot exceed the total # blocks and
@@ -157,6 +380,7 @@ void QMPool_put( QMPool * const me, void *b )
 
     //portEXIT_CRITICAL(); //Exit from critical section
 }
+#endif
 
 /****************************************************************************/
 /**
@@ -177,6 +401,12 @@ void QMPool_put( QMPool * const me, void *b )
 * QF critical section, so you should be careful not to call it from within
 * a critical section when nesting of critical section is not supported.
 *
+* @note
+* With #QF_MPOOL_LOCKFREE a block is first reserved by decrementing nFree
+* with a compare-and-swap, which keeps the margin check exact. Once the
+* reservation succeeds the free list is guaranteed to hold a block for
+* this caller, and it is popped with a compare-and-swap on the tagged head.
+*
 * @attention
 * An allocated block must be later returned back to the same pool
 * from which it has been allocated.
@@ -189,6 +419,29 @@ void QMPool_put( QMPool * const me, void *b )
 */
 void *QMPool_get( QMPool * const me, unsigned short const margin )
 {
+#if (QF_MPOOL_LOCKFREE != 0)
+    QMPoolCtr nFree;
+    void *b;
+
+    /* have more free blocks than the requested margin? reserve one */
+    do
+    {
+        nFree = me->nFree;
+        if ( nFree <= ( QMPoolCtr )margin )
+        {
+            QF_MPOOL_ON_FAIL_( me );
+            return ( void * )0;
+        }
+    } while ( !qf_atomic_cas16( &me->nFree, nFree, ( QMPoolCtr )( nFree - 1U ) ) );
+
+    /* new minimum, counting the free blocks held in magazines? */
+    qf_atomic_min16( &me->nMin, ( QMPoolCtr )( nFree - 1U + me->nMag ) );
+
+    b = QMPool_pop_( me );
+    QF_MPOOL_ON_GET_( me, b );
+    return b;
+}
+#else
     QFreeBlock *fb;
     UBaseType_t uxSavedInterruptStatus;
 
@@ -198,18 +451,17 @@ void *QMPool_get( QMPool * const me, unsigned short const margin )
     /* have more free blocks than the requested margin? */
     if ( me->nFree > ( QMPoolCtr )margin )
     {
-        void *fb_next;
-        fb = ( QFreeBlock * )me->free_head; /* get a free block */
-
-        fb_next = fb->next; /* put volatile to a temporary to avoid UB */
+        fb = QMPool_take_( me ); /* get a free block */
 
         /* is the pool becoming empty? */
         --me->nFree; /* one less free block */
         if ( me->nFree == ( QMPoolCtr )0 )
         {
-
-            me->nMin = ( QMPoolCtr )0; /* remember that the pool got empty */
-
+            /* remember that the pool got empty, only magazines have blocks */
+            if ( me->nMin > me->nMag )
+            {
+                me->nMin = me->nMag;
+            }
         }
         else
         {
@@ -220,15 +472,14 @@ void *QMPool_get( QMPool * const me, unsigned short const margin )
             * corrupting the next block.
             */
 
-            /* is the number of free blocks the new minimum so far? */
-            if ( me->nMin > me->nFree )
+            /* is the number of free blocks, counting the ones held in
+            * magazines, the new minimum so far?
+            */
+            if ( me->nMin > ( QMPoolCtr )( me->nFree + me->nMag ) )
             {
-                me->nMin = me->nFree; /* remember the new minimum */
+                me->nMin = ( QMPoolCtr )( me->nFree + me->nMag ); /* new minimum */
             }
         }
-
-        me->free_head = fb_next; /* set the head to the next free block */
-
     }
     /* don't have enough free blocks at this point */
     else
@@ -240,8 +491,260 @@ void *QMPool_get( QMPool * const me, unsigned short const margin )
 
     //portEXIT_CRITICAL(); //Exit from critical section
     taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+
+    if ( fb != ( QFreeBlock * )0 )
+    {
+        QF_MPOOL_ON_GET_( me, fb );
+    }
+    else
+    {
+        QF_MPOOL_ON_FAIL_( me );
+    }
     return fb;  /* return the block or NULL pointer to the caller */
 }
+#endif
+
+/****************************************************************************/
+/*! moves up to @p n blocks from the free list to @p blocks. With @p toMag
+* the blocks go to a magazine and are still counted as free in nMag.
+*/
+static unsigned short QMPool_getN_( QMPool * const me, void **blocks,
+                                    unsigned short n, unsigned short const margin,
+                                    bool const toMag )
+{
+#if (QF_MPOOL_LOCKFREE != 0)
+    QMPoolCtr nFree;
+    unsigned short k;
+    unsigned short i;
+
+    if ( toMag )
+    {
+        /* count them in the magazine first, so the total never dips */
+        ( void )qf_atomic_add16( &me->nMag, ( int16_t )n );
+    }
+    do
+    {
+        nFree = me->nFree;
+        k = ( nFree > ( QMPoolCtr )margin ) ? ( unsigned short )( nFree - margin ) : 0U;
+        if ( k > n )
+        {
+            k = n;
+        }
+    } while ( ( k != 0U ) &&
+              !qf_atomic_cas16( &me->nFree, nFree, ( QMPoolCtr )( nFree - k ) ) );
+
+    if ( toMag )
+    {
+        ( void )qf_atomic_add16( &me->nMag, ( int16_t )( k - n ) );
+    }
+    else if ( k != 0U )
+    {
+        qf_atomic_min16( &me->nMin, ( QMPoolCtr )( nFree - k + me->nMag ) );
+    }
+
+    for ( i = 0U; i < k; ++i )
+    {
+        blocks[i] = QMPool_pop_( me );
+    }
+    return k;
+#else
+    unsigned short k = 0U;
+    UBaseType_t uxSavedInterruptStatus;
+
+    uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+
+    while ( ( k < n ) && ( me->nFree > ( QMPoolCtr )margin ) )
+    {
+        blocks[k++] = QMPool_take_( me );
+        --me->nFree;
+    }
+
+    if ( toMag )
+    {
+        ( void )qf_atomic_add16( &me->nMag, ( int16_t )k );
+    }
+    else if ( me->nMin > ( QMPoolCtr )( me->nFree + me->nMag ) )
+    {
+        me->nMin = ( QMPoolCtr )( me->nFree + me->nMag ); /* new minimum */
+    }
+
+    taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+    return k;
+#endif
+}
+
+/*! moves @p n blocks from @p blocks to the free list. With @p fromMag the
+* blocks come from a magazine and are taken out of nMag.
+*/
+static void QMPool_putN_( QMPool * const me, void * const *blocks,
+                          unsigned short n, bool const fromMag )
+{
+    unsigned short i;
+#if (QF_MPOOL_LOCKFREE != 0)
+    for ( i = 0U; i < n; ++i )
+    {
+        QMPool_push_( me, blocks[i] );
+    }
+    ( void )qf_atomic_add16( &me->nFree, ( int16_t )n );
+#else
+    UBaseType_t uxSavedInterruptStatus;
+
+    uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+
+    for ( i = 0U; i < n; ++i )
+    {
+        ( ( QFreeBlock * )blocks[i] )->next = ( QFreeBlock * )me->free_head;
+        me->free_head = blocks[i];
+    }
+    me->nFree += ( QMPoolCtr )n;
+#endif
+    if ( fromMag )
+    {
+        /* taken out of the magazine last, so the total never dips */
+        ( void )qf_atomic_add16( &me->nMag, -( int16_t )n );
+    }
+#if (QF_MPOOL_LOCKFREE == 0)
+    taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+#endif
+}
+
+/****************************************************************************/
+/**
+* @description
+* Obtains up to @p n memory blocks with a single critical section (or a
+* single reservation in the lock-free version).
+*
+* @param[in,out] me      pointer (see @ref oop)
+* @param[out]    blocks  array receiving the blocks
+* @param[in]     n       number of blocks requested
+* @param[in]     margin  the minimum number of unused blocks still available
+*                        in the pool after the allocation.
+*
+* @returns
+* the number of blocks obtained, less than @p n if the pool ran down to
+* the margin.
+*
+* @note
+* This function can be called from any task level or ISR level.
+*/
+unsigned short QMPool_getN( QMPool * const me, void **blocks,
+                            unsigned short n, unsigned short const margin )
+{
+    unsigned short k = QMPool_getN_( me, blocks, n, margin, false );
+#if (QF_MPOOL_TELEMETRY != 0)
+    unsigned short i;
+
+    for ( i = 0U; i < k; ++i )
+    {
+        QF_MPOOL_ON_GET_( me, blocks[i] );
+    }
+    if ( k < n )
+    {
+        QF_MPOOL_ON_FAIL_( me );
+    }
+#endif
+    return k;
+}
+
+/****************************************************************************/
+/**
+* @description
+* Recycles @p n memory blocks with a single critical section.
+*
+* @param[in,out] me      pointer (see @ref oop)
+* @param[in]     blocks  array with the blocks being recycled
+* @param[in]     n       number of blocks
+*
+* @note
+* This function can be called from any task level or ISR level.
+*/
+void QMPool_putN( QMPool * const me, void * const *blocks, unsigned short n )
+{
+#if (QF_MPOOL_TELEMETRY != 0)
+    unsigned short i;
+
+    for ( i = 0U; i < n; ++i )
+    {
+        QF_MPOOL_ON_PUT_( me, blocks[i] );
+    }
+#endif
+    QMPool_putN_( me, blocks, n, false );
+}
+
+/****************************************************************************/
+/**
+* @description
+* Obtains a memory block through a magazine, a small cache of free blocks
+* owned by one execution context. Only when the magazine is empty it is
+* refilled from the pool with half of its capacity in one bulk operation.
+*
+* @param[in,out] me      pointer (see @ref oop)
+* @param[in,out] mag     magazine of the calling context
+* @param[in]     margin  margin passed to the pool when refilling
+*
+* @returns
+* a memory block or NULL if both the magazine and the pool are exhausted.
+*
+* @attention
+* A magazine must only be used from a single context (or from contexts
+* that cannot preempt each other).
+*
+* @note
+* Blocks held in magazines are counted as free in nMin.
+*/
+void *QMPool_magGet( QMPool * const me, QMPoolMag * const mag,
+                     unsigned short const margin )
+{
+    if ( mag->n == 0U )
+    {
+        mag->n = QMPool_getN_( me, mag->blocks, QF_MPOOL_MAG_SIZE / 2U, margin, true );
+        if ( mag->n == 0U )
+        {
+            QF_MPOOL_ON_FAIL_( me );
+            return ( void * )0;
+        }
+    }
+    ( void )qf_atomic_add16( &me->nMag, -1 );
+    qf_atomic_min16( &me->nMin, ( QMPoolCtr )( me->nFree + me->nMag ) );
+    QF_MPOOL_ON_GET_( me, mag->blocks[mag->n - 1U] );
+    return mag->blocks[--mag->n];
+}
+
+/****************************************************************************/
+/**
+* @description
+* Recycles a memory block into a magazine. Only when the magazine is full
+* half of it is flushed to the pool in one bulk operation.
+*
+* @param[in,out] me   pointer (see @ref oop)
+* @param[in,out] mag  magazine of the calling context
+* @param[in]     b    pointer to the memory block that is being recycled
+*/
+void QMPool_magPut( QMPool * const me, QMPoolMag * const mag, void *b )
+{
+    QF_MPOOL_ON_PUT_( me, b );
+    if ( mag->n == QF_MPOOL_MAG_SIZE )
+    {
+        mag->n = QF_MPOOL_MAG_SIZE / 2U;
+        QMPool_putN_( me, &mag->blocks[mag->n], QF_MPOOL_MAG_SIZE - mag->n, true );
+    }
+    mag->blocks[mag->n++] = b;
+    ( void )qf_atomic_add16( &me->nMag, 1 );
+}
+
+/****************************************************************************/
+/**
+* @description
+* Returns all the blocks held in a magazine to the pool.
+*
+* @param[in,out] me   pointer (see @ref oop)
+* @param[in,out] mag  magazine of the calling context
+*/
+void QMPool_magFlush( QMPool * const me, QMPoolMag * const mag )
+{
+    QMPool_putN_( me, mag->blocks, mag->n, true );
+    mag->n = 0U;
+}
 
 /****************************************************************************/
 /**
@@ -267,3 +770,59 @@ unsigned short QMPool_getMin( QMPool * const me )
     return min;
 }
 
+#if (QF_MPOOL_TELEMETRY != 0)
+/****************************************************************************/
+/**
+* @description
+* Provides the storage for the per block telemetry: the owner stage of each
+* block and the time it was taken from the pool, used for the hold time
+* histogram. Without it the pool keeps only the get/put/failure counters.
+*
+* @param[in,out] me    pointer (see @ref oop)
+* @param[in]     info  array with one element per block (nTot)
+*
+* @attention
+* Must be called right after QMPool_init(), before any block is taken.
+*/
+void QMPool_attachInfo( QMPool * const me, QMPoolBlockInfo * const info )
+{
+    QMPoolCtr i;
+
+    for ( i = ( QMPoolCtr )0; i < me->nTot; ++i )
+    {
+        info[i].owner = QF_MPOOL_OWNER_FREE;
+    }
+    me->telemetry.info = info;
+}
+
+/****************************************************************************/
+/**
+* @description
+* Records the stage that holds a block, so telemetry.nOwned shows where the
+* blocks are and telemetry.nOwnedMax which stage pinned the most of them.
+* A block gets owner 0 when it is taken from the pool.
+*
+* @param[in,out] me     pointer (see @ref oop)
+* @param[in]     b      pointer to a block taken from this pool
+* @param[in]     owner  owner stage, less than #QF_MPOOL_OWNERS
+*
+* @note
+* Only the context holding the block may call it. When #QF_MPOOL_TELEMETRY
+* is 0 it is a macro that expands to nothing.
+*/
+void QMPool_setOwner( QMPool * const me, void const * const b, uint8_t const owner )
+{
+    QMPoolBlockInfo *info;
+
+    if ( me->telemetry.info == ( QMPoolBlockInfo * )0 )
+    {
+        return;
+    }
+    configASSERT( owner < QF_MPOOL_OWNERS );
+    info = QMPool_info_( me, b );
+    configASSERT( info->owner < QF_MPOOL_OWNERS ); /* block not taken */
+    ( void )qf_atomic_add16( &me->telemetry.nOwned[info->owner], -1 );
+    QMPool_own_( me, owner );
+    info->owner = owner;
+}
+#endif
@@ -9,35 +9,115 @@
  *===========================================================================*/
 
 #include "separacion_frames.h"
+#include "sf_perfil.h"
+#include "qf_atomic.h"
 #include "FreeRTOS.h"
 #include "FreeRTOSConfig.h"
 #include "task.h"
 #include <string.h>
 
 static bool sf_recibir_byte(sf_t* handler, uint8_t byte_recibido);
+#if !SF_VALIDACION_DIFERIDA
+static void sf_acumular_byte(sf_t* handler, uint8_t byte_recibido);
 static bool sf_paquete_validar(sf_t* handler);
-static bool sf_validar_id(sf_t* handler);
 static bool sf_validar_crc8(sf_t* handler);
-static bool sf_byte_valido(uint8_t byte);
+#endif
+#if SF_RX_ARENA
+static bool sf_arena_frame_iniciar(sf_t* handler);
+static void sf_arena_frame_cerrar(sf_t* handler);
+#else
 static bool sf_bloque_de_memoria_nuevo(sf_t* handler);
+#endif
+static bool sf_bloque_de_memoria_agrandar(sf_t* handler);
+static void sf_limite_rx_actualizar(sf_t* handler);
 static uint8_t sf_decodificar_ascii(uint8_t byte);
-static void sf_bloque_de_memoria_liberar(sf_t* handler);
+static uint8_t sf_codificar_ascii(uint8_t nibble);
+static void sf_mensaje_sellar(tMensaje* mensaje);
+static bool sf_evento_postear(sf_t* handler, tObjeto* objeto, uint8_t dueno, BaseType_t* pxHigherPriorityTaskWoken);
+static void sf_evento_reciclar(sf_t* handler, tMensaje* evento, bool isr_uart);
+static void sf_evento_destruir(tMensaje* evento);
+static void sf_corto_destruir(tMensaje* evento);
 static void sf_reiniciar_mensaje(sf_t* handler);
+static void sf_frame_entregar(sf_t* handler, BaseType_t* pxHigherPriorityTaskWoken);
+static void sf_frame_siguiente(sf_t* handler);
 static void sf_rx_isr(void* parametro);
 static void sf_tx_isr(void* parametro);
+#if (SF_TIMEOUT_MODO == SF_TIMEOUT_TIMER)
 static void timer_callback(TimerHandle_t xTimer);
+#else
+static bool sf_timeout_vencido(sf_t* handler);
+#endif
 static void sf_setOn_tx_isr(sf_t* handler);
 
+/* Clase de cada byte que puede llegar por la UART, los que no figuran son SF_CLASE_OTRO */
+static const uint8_t sf_clase_byte[256] =
+{
+	[ASCII_0 ... ASCII_9] = SF_CLASE_HEX,
+	[ASCII_A ... ASCII_F] = SF_CLASE_HEX,
+	[SOM_BYTE] = SF_CLASE_SOM,
+	[EOM_BYTE] = SF_CLASE_EOM,
+};
+
+/* Estado siguiente para cada estado y clase de byte. Pasar a SF_ESTADO_ESPERA descarta el paquete en curso */
+static const uint8_t sf_transicion[SF_CANT_ESTADOS][SF_CANT_CLASES] =
+{
+	/*                      SF_CLASE_OTRO     SF_CLASE_HEX      SF_CLASE_SOM    SF_CLASE_EOM */
+	[SF_ESTADO_ESPERA] = { SF_ESTADO_ESPERA, SF_ESTADO_ESPERA, SF_ESTADO_ID_0, SF_ESTADO_ESPERA },
+	[SF_ESTADO_ID_0]   = { SF_ESTADO_ESPERA, SF_ESTADO_ID_1,   SF_ESTADO_ID_0, SF_ESTADO_ESPERA },
+	[SF_ESTADO_ID_1]   = { SF_ESTADO_ESPERA, SF_ESTADO_ID_2,   SF_ESTADO_ID_0, SF_ESTADO_ESPERA },
+	[SF_ESTADO_ID_2]   = { SF_ESTADO_ESPERA, SF_ESTADO_ID_3,   SF_ESTADO_ID_0, SF_ESTADO_ESPERA },
+	[SF_ESTADO_ID_3]   = { SF_ESTADO_ESPERA, SF_ESTADO_ID_4,   SF_ESTADO_ID_0, SF_ESTADO_ESPERA },
+	[SF_ESTADO_ID_4]   = { SF_ESTADO_DATOS,  SF_ESTADO_CRC_H,  SF_ESTADO_ID_0, SF_ESTADO_ESPERA },
+	[SF_ESTADO_DATOS]  = { SF_ESTADO_DATOS,  SF_ESTADO_CRC_H,  SF_ESTADO_ID_0, SF_ESTADO_ESPERA },
+	[SF_ESTADO_CRC_H]  = { SF_ESTADO_DATOS,  SF_ESTADO_CRC_L,  SF_ESTADO_ID_0, SF_ESTADO_ESPERA },
+	[SF_ESTADO_CRC_L]  = { SF_ESTADO_DATOS,  SF_ESTADO_CRC_L,  SF_ESTADO_ID_0, SF_ESTADO_EOM    },
+	[SF_ESTADO_EOM]    = { SF_ESTADO_ESPERA, SF_ESTADO_ESPERA, SF_ESTADO_ID_0, SF_ESTADO_ESPERA },
+};
+
+#if !SF_RX_ARENA
+/* Tamaño y cantidad de bloques de cada clase del pool de memoria */
+static const sf_geometria_t sf_geometria_defecto = { SF_POOL_CANT_CLASES, SF_POOL_TAMANIOS, SF_POOL_CANTIDADES };
+
+/* Magazines de las ISR de la UART, o NULL para que vayan directo al pool */
+#if SF_MAG_UART
+#define SF_MAGS_UART(handler)   ((handler)->mag_uart)
+#else
+#define SF_MAGS_UART(handler)   ((QMPoolMag*)NULL)
+#endif
+
+static void sf_bloque_de_memoria_reponer(sf_t* handler);
+#if SF_PERFIL
+static bool sf_geometria_valida(const sf_geometria_t* geometria);
+#endif
+#endif
+#ifdef SF_RX_FIFO_NIVEL
+static LPC_USART_T* sf_uart_lpc(uartMap_t uart);
+#endif
+#if SF_VALIDACION_DIFERIDA
+static bool sf_frame_validar(const uint8_t* frame, uint32_t cantidad);
+static void sf_validador_tarea(void* parametro);
+#endif
+
 /**
  * @brief Asigna memoria para una estructura de separcion de frames y devuelve puntero a ella.
  * 
+ * @details Con SF_ESTATICO la estructura sale de un arreglo estático de SF_INSTANCIAS.
+ * 
  * @return sf_t* Puntero a una estructura de separcion de frames.
  */
 sf_t* sf_crear(void)
 {
+#if SF_ESTATICO
+	static sf_t instancias[SF_INSTANCIAS];
+	static uint8_t cant_instancias = 0;
+
+	configASSERT(cant_instancias < SF_INSTANCIAS);
+	return &instancias[cant_instancias++];
+#else
 	sf_t* me = pvPortMalloc(sizeof(sf_t));
 	configASSERT(me != NULL);
 	return me;
+#endif
 }
 
 /**
@@ -57,26 +137,116 @@ bool sf_init(sf_t* handler, uartMap_t uart, uint32_t baudRate)
 
 	handler->uart = uart;
 	handler->baudRate = baudRate;
+#if SF_ESTATICO
+	handler->ptr_objeto1 = objeto_crear_estatico(&(handler->memoria.objeto1));
+	handler->ptr_objeto2 = objeto_crear_estatico(&(handler->memoria.objeto2));
+#else
 	handler->ptr_objeto1 = objeto_crear();
 	handler->ptr_objeto2 = objeto_crear();
-	handler->EOM = false;
-	handler->SOM = false;
+#endif
+	handler->estado = SF_ESTADO_ESPERA;
 	handler->out_of_memory = false;
 	handler->cantidad = 0;
+	handler->tx_indice = 0;
+	handler->mensaje = NULL;
+	QMPool_init(&(handler->pool_eventos), handler->eventos, sizeof(handler->eventos), sizeof(tMensaje));
+	QMPool_init(&(handler->pool_cortos), handler->cortos, sizeof(handler->cortos), sizeof(sf_corto_t));
+#if SF_RX_ESTADISTICAS
+	memset(handler->rx_bytes_por_irq, 0, sizeof(handler->rx_bytes_por_irq));
+	memset(handler->largo_frames, 0, sizeof(handler->largo_frames));
+#if !SF_RX_ARENA
+	handler->bloques_en_uso = 0;
+	handler->bloques_en_uso_max = 0;
+#endif
+#endif
 
 	//	Reservo memoria para el memory pool
+#if SF_ESTATICO
+	handler->prt_pool = handler->memoria.pool.bytes;
+#else
 	handler->prt_pool = pvPortMalloc(POOL_SIZE * sizeof( uint8_t ));
 	configASSERT(handler->prt_pool != NULL);
-	//	Creo el pool de memoria
-	QMPool_init(&(handler->pool_memoria), handler->prt_pool, POOL_SIZE * sizeof( uint8_t ), MSG_MAX_SIZE);  //Tamaño del segmento de memoria reservado
+#endif
+#if SF_RX_ARENA
+	//	Los frames se reciben uno detrás del otro en la arena, el buffer se ubica al llegar cada SOM
+	configASSERT(arena_init(&(handler->arena), handler->prt_pool, POOL_SIZE * sizeof( uint8_t )));
+	handler->buffer = handler->prt_pool;
+#else
+	//	Creo un pool de memoria por clase de tamaño, la última con bloques de MSG_MAX_SIZE
+	const sf_geometria_t* geometria = &sf_geometria_defecto;
+#if SF_PERFIL
+	sf_geometria_t perfil;
+	if (sf_perfil_cargar(&perfil) && sf_geometria_valida(&perfil))
+		geometria = &perfil;
+#endif
+	// SF_POOL_BLOQUES dimensiona la telemetría estática, tiene que ser la suma de SF_POOL_CANTIDADES
+	uint32_t bloques_defecto = 0;
+	for (uint8_t i = 0; i < SF_POOL_CANT_CLASES; i++)
+		bloques_defecto += sf_geometria_defecto.cantidades[i];
+	configASSERT(bloques_defecto == SF_POOL_BLOQUES);
+	configASSERT(geometria->tamanios[geometria->cant_clases - 1] == MSG_MAX_SIZE);
+	configASSERT(pool_clases_init(&(handler->pool_memoria), handler->prt_pool, POOL_SIZE * sizeof( uint8_t ),
+	                              geometria->tamanios, geometria->cantidades, geometria->cant_clases));
+#if SF_TELEMETRIA && SF_ESTATICO
+	QMPoolBlockInfo* info = handler->memoria.info_bloques;
+#endif
+	for (uint8_t i = 0; i < geometria->cant_clases; i++)
+	{
+		handler->mag_uart[i].n = 0;
+#if SF_TELEMETRIA
+		QMPool* pool = &(handler->pool_memoria.pool[i]);
+#if SF_ESTATICO
+		configASSERT(info + pool->nTot <= handler->memoria.info_bloques + SF_POOL_BLOQUES);
+#else
+		QMPoolBlockInfo* info = pvPortMalloc(pool->nTot * sizeof(QMPoolBlockInfo));
+		configASSERT(info != NULL);
+#endif
+		QMPool_attachInfo(pool, info);
+#if SF_ESTATICO
+		info += pool->nTot;
+#endif
+#endif
+	}
+#if SF_TELEMETRIA
+	handler->rx_sin_memoria = 0;
+#endif
 	//Pido un bloque de memoria
 	configASSERT(sf_bloque_de_memoria_nuevo(handler) == true);
+#endif
+
+#if SF_VALIDACION_DIFERIDA
+#if SF_ESTATICO
+	handler->ptr_objeto_validar = objeto_crear_estatico(&(handler->memoria.objeto_validar));
+	TaskHandle_t tarea = xTaskCreateStatic(sf_validador_tarea, (const char *)"Validador", SF_VALIDADOR_STACK, handler, SF_VALIDADOR_PRIORIDAD,
+	                                       handler->memoria.validador_stack, &(handler->memoria.validador_tcb));
+	configASSERT(tarea != NULL);
+#else
+	handler->ptr_objeto_validar = objeto_crear();
+	BaseType_t res = xTaskCreate(sf_validador_tarea, (const char *)"Validador", SF_VALIDADOR_STACK, handler, SF_VALIDADOR_PRIORIDAD, NULL);
+	configASSERT(res == pdPASS);
+#endif
+#endif
 
 	uartConfig(handler->uart, handler->baudRate);
+#ifdef SF_RX_FIFO_NIVEL
+	// La FIFO interrumpe al llegar al nivel y el timeout de caracter (CTI) atiende los bytes que quedan al final del frame
+	Chip_UART_SetupFIFOS(sf_uart_lpc(handler->uart), UART_FCR_FIFO_EN | UART_FCR_RX_RS | UART_FCR_TX_RS | SF_RX_FIFO_NIVEL);
+#endif
 	uartCallbackSet(handler->uart, UART_RECEIVE, sf_rx_isr, handler);
 
+#if (SF_TIMEOUT_MODO == SF_TIMEOUT_TIMER)
     handler->periodo_timerRx = TIMEOUT;
 
+#if SF_ESTATICO
+    handler->timerRx = xTimerCreateStatic(
+                    "TimerRx",
+                    handler->periodo_timerRx, //Timeout
+                    pdFALSE,                //One-shot
+                    handler,                //Estructura de datos que llega al callback
+                    timer_callback,
+                    &(handler->memoria.timerRx)
+    );
+#else
     handler->timerRx = xTimerCreate(
                     "TimerRx",
                     handler->periodo_timerRx, //Timeout
@@ -84,8 +254,14 @@ bool sf_init(sf_t* handler, uartMap_t uart, uint32_t baudRate)
                     handler,                //Estructura de datos que llega al callback
                     timer_callback
     );
+#endif
 
     configASSERT(handler->timerRx != NULL);
+#else
+    // El timeout se mide con el contador de ciclos del core (DWT), que tiene resolución por debajo del tick.
+    cyclesCounterInit(SystemCoreClock);
+    handler->timeout_ciclos = TIMEOUT_US * (SystemCoreClock / 1000000UL);
+#endif
     // Habilito interrupciónes de UART
     uartInterrupt(handler->uart, UART_IE);
 
@@ -95,10 +271,17 @@ bool sf_init(sf_t* handler, uartMap_t uart, uint32_t baudRate)
 /**
  * @brief Recibe un byte y lo coloca en el buffer.
  * 
- * @details Si todavía no se recibió el SOM se descarta el byte.
+ * @details El byte se clasifica con sf_clase_byte y el nuevo estado sale de la tabla sf_transicion.
+ *          Si todavía no se recibió el SOM se descarta el byte.
  *          Si ya se recibió el SOM se guarda el paquete en el buffer.
  *          Si se vuelve a recibir el SOM se reinicia el paquete.
- *          Si el tamaño del paquete llega a MSG_MAX_SIZE se reinicia el paquete.
+ *          Si el ID no es ASCII hexa o el EOM no llega detrás de dos bytes ASCII hexa, se descarta el
+ *          paquete sin esperar al EOM.
+ *          Si el paquete no entra en el bloque actual se copia a un bloque más grande. Si ya está en un
+ *          bloque de MSG_MAX_SIZE, o no hay uno más grande libre, se reinicia el paquete.
+ *          A medida que llegan los bytes se acumula el CRC, así al llegar el EOM la validación del
+ *          paquete no depende de su largo. Con SF_VALIDACION_DIFERIDA esa validación la hace la tarea
+ *          validadora y acá sólo se separa el frame.
  * 
  * @param[in] handler       Puntero a la estructura de separación de frames.
  * @param[in] byte_recibido Byte que se recibió por la UART. 
@@ -108,56 +291,93 @@ bool sf_init(sf_t* handler, uartMap_t uart, uint32_t baudRate)
  */
 static bool sf_recibir_byte(sf_t* handler, uint8_t byte_recibido)
 {
-	bool resp = false;
+	uint8_t estado;
+#if (SF_TIMEOUT_MODO == SF_TIMEOUT_TIMER)
 	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-	if(handler != NULL)
+#endif
+	if(handler == NULL)
+		return false;
+#if (SF_TIMEOUT_MODO == SF_TIMEOUT_TIMESTAMP)
+	if ((handler->estado != SF_ESTADO_ESPERA) && sf_timeout_vencido(handler))	// R_C2_17
+		sf_reiniciar_mensaje(handler);
+#endif
+	estado = sf_transicion[handler->estado][sf_clase_byte[byte_recibido]];		// R_C2_3
+#if SF_RX_ARENA
+	if ((estado == SF_ESTADO_ID_0) && !sf_arena_frame_iniciar(handler))
+		estado = SF_ESTADO_ESPERA;			// Sin lugar en la arena se descarta el frame entero
+#endif
+	if (estado == SF_ESTADO_ESPERA)
 	{
-		if (byte_recibido == SOM_BYTE)	// R_C2_3
-		{
-			handler->SOM = true;		// R_C2_4
-			handler->cantidad = 0;
-		}
-		if (handler->SOM  )
-		{
-			xTimerStartFromISR(handler->timerRx, &xHigherPriorityTaskWoken);         // R_C2_18
-			handler->buffer[handler->cantidad] = byte_recibido;	// R_C2_6
-			handler->cantidad++;
-			if (byte_recibido == EOM_BYTE)	// R_C2_3
-			{
-				xTimerStopFromISR(handler->timerRx, &xHigherPriorityTaskWoken);    // Si se recibe EOM detiene el timer
-				handler->EOM = true;
-				resp = true;
-			}
-			if((handler->cantidad == MSG_MAX_SIZE) && (handler->EOM == false)) // R_C2_7 Si llegue al maximo tamaño de paquete y no recibí el EOM reinicio
-			{
-				xTimerStopFromISR(handler->timerRx, &xHigherPriorityTaskWoken);
-				handler->cantidad = 0;
-				handler->SOM = false;
-			}
-		}
+#if (SF_TIMEOUT_MODO == SF_TIMEOUT_TIMER)
+		if (handler->estado != SF_ESTADO_ESPERA)
+			xTimerStopFromISR(handler->timerRx, &xHigherPriorityTaskWoken);
+#endif
+		sf_reiniciar_mensaje(handler);		// R_C2_12 Byte fuera de un paquete o paquete mal formado
+		return false;
+	}
+	if (estado == SF_ESTADO_ID_0)			// R_C2_4
+	{
+		handler->cantidad = 0;
+		handler->crc_rx = 0;
 	}
-return resp;
+	handler->estado = estado;
+#if (SF_TIMEOUT_MODO == SF_TIMEOUT_TIMER)
+	xTimerStartFromISR(handler->timerRx, &xHigherPriorityTaskWoken);         // R_C2_18
+#else
+	handler->ultimo_byte_ciclos = cyclesCounterRead();                         // R_C2_18
+	handler->ultimo_byte_tick = xTaskGetTickCountFromISR();
+#endif
+	handler->buffer[handler->cantidad] = byte_recibido;	// R_C2_6
+	if (estado == SF_ESTADO_EOM)
+	{
+#if (SF_TIMEOUT_MODO == SF_TIMEOUT_TIMER)
+		xTimerStopFromISR(handler->timerRx, &xHigherPriorityTaskWoken);    // Si se recibe EOM detiene el timer
+#endif
+		handler->cantidad++;
+		return true;
+	}
+#if !SF_VALIDACION_DIFERIDA
+	sf_acumular_byte(handler, byte_recibido);
+#endif
+	handler->cantidad++;
+	if ((handler->cantidad == handler->limite_rx) &&
+	    ((handler->limite_rx == MSG_MAX_SIZE) || !sf_bloque_de_memoria_agrandar(handler))) // R_C2_7 Si llegue al maximo tamaño de paquete y no recibí el EOM reinicio
+	{
+#if (SF_TIMEOUT_MODO == SF_TIMEOUT_TIMER)
+		xTimerStopFromISR(handler->timerRx, &xHigherPriorityTaskWoken);
+#endif
+		sf_reiniciar_mensaje(handler);
+	}
+	return false;
 }
 
+#if !SF_VALIDACION_DIFERIDA
 /**
- * @brief Valida si el ID recibido es correcto.
+ * @brief Procesa un byte entre el SOM y el EOM: actualiza el CRC.
+ * 
+ * @details Los últimos LEN_CRC bytes antes del EOM son el CRC y no entran en el cálculo. Como no se sabe
+ *          cuáles son hasta que llega el EOM, cada byte pasa primero por una línea de retardo de LEN_CRC
+ *          bytes y entra al CRC recién cuando sale de ella. Al llegar el EOM la línea contiene el CRC recibido.
+ *          El SOM también pasa por la línea pero sale antes de que se empiece a acumular.
  * 
- * @return true  Si el ID es correcto.
- * @return false Si el ID es incorrecto.
+ * @param[in] handler       Puntero a la estructura de separación de frames.
+ * @param[in] byte_recibido Byte recibido, guardado en handler->buffer[handler->cantidad].
  */
-static bool sf_validar_id(sf_t* handler)
+static void sf_acumular_byte(sf_t* handler, uint8_t byte_recibido)
 {
-	for(uint8_t i = INDICE_INICIO_ID ; i < (INDICE_INICIO_ID + LEN_ID) ; i++)
-	{
-		if(!sf_byte_valido(handler->buffer[i]))
-			return false;
-	}
-	return true;
+	if (handler->cantidad >= INDICE_INICIO_ID + LEN_CRC)
+		handler->crc_rx = crc8_update(handler->crc_rx, handler->crc_linea[0]);	// R_C2_20
+	handler->crc_linea[0] = handler->crc_linea[1];
+	handler->crc_linea[1] = byte_recibido;
 }
 
 /**
  * @brief Valida si el CRC recibido es correcto.
  * 
+ * @details Compara el CRC acumulado durante la recepción con el que quedó en la línea de retardo.
+ *          La tabla de transiciones sólo acepta el EOM detrás de dos bytes ASCII hexa, así que no hace
+ *          falta volver a verificarlos.
+ * 
  * @param[in] handler Puntero a la estructura de separación de frames.
  * 
  * @return true  Si el CRC es correcto.
@@ -165,39 +385,14 @@ static bool sf_validar_id(sf_t* handler)
  */
 static bool sf_validar_crc8(sf_t* handler)
 {
-	uint8_t CRC_paquete,crc;
 	/* convierto el CRC de ASCII a entero */
-	if (sf_byte_valido(handler->buffer[handler->cantidad - POS_CRC_H]))
-		CRC_paquete = sf_decodificar_ascii(handler->buffer[handler->cantidad - POS_CRC_H]);
-	else
-		return false;	// Si el caracter de CRC no es válido retorno false
-	if (sf_byte_valido(handler->buffer[handler->cantidad - POS_CRC_L]))
-		CRC_paquete += (sf_decodificar_ascii(handler->buffer[handler->cantidad - POS_CRC_L])) << SHIFT_4b;
-	else
-		return false;	// Si el caracter de CRC no es válido retorno false
+	uint8_t CRC_paquete = (sf_decodificar_ascii(handler->crc_linea[0]) << SHIFT_4b) | sf_decodificar_ascii(handler->crc_linea[1]);
 
-	/* calculo el CRC del paquete*/
-	crc = crc8_calc(0, handler->buffer + INDICE_INICIO_ID, handler->cantidad - CANT_BYTE_FUERA_CRC); // R_C2_20
-
-	if (crc == CRC_paquete)
+	if (handler->crc_rx == CRC_paquete)
 		return true;	// Si el CRC es correcto devuelvo true
 	return false;		// Si el CRC es incorrecto devuelvo false
 }
-
-/**
- * @brief Verifica que el byte sea un ASCII entre 0 y 9 o A y F. 
- * 
- * @param[in] byte Byte a verificar.
- * 
- * @return true  Si el byte es correcto.
- * @return false Si el byte es incorrecto.
- */
-static bool sf_byte_valido(uint8_t byte)
-{
-	if (( (byte >= ASCII_0)&&(byte <= ASCII_9) )||( (byte >= ASCII_A )&&(byte<= ASCII_F) ))
-		return true;
-	return false;
-}
+#endif
 
 /**
  * @brief Decodifica un byte en ASCII.
@@ -206,7 +401,7 @@ static bool sf_byte_valido(uint8_t byte)
  * 
  * @return uint8_t Byte decodificado.
  * 
- * @attention Requiere que el byte se encuentre previamente validado con la función sf_byte_valido.
+ * @attention Requiere que el byte sea de la clase SF_CLASE_HEX.
  */
 static uint8_t sf_decodificar_ascii(uint8_t byte)
 {
@@ -215,9 +410,102 @@ static uint8_t sf_decodificar_ascii(uint8_t byte)
 	return (byte - ASCII_TO_NUM);			// Si no está entre 0 y 9, está entre A y F
 }
 
+/**
+ * @brief Codifica un nibble en ASCII.
+ * 
+ * @param[in] nibble Valor entre 0 y 15.
+ * 
+ * @return uint8_t ASCII entre 0 y 9 o A y F.
+ */
+static uint8_t sf_codificar_ascii(uint8_t nibble)
+{
+	if (nibble <= 9)
+		return (nibble + ASCII_0);
+	return (nibble + ASCII_TO_NUM);
+}
+
+#if SF_RX_ARENA
+/**
+ * @brief Ubica el frame que empieza en la cabeza de la arena.
+ *
+ * @details Se llama al recibir el SOM. El frame tiene que tener lugar al menos para el paquete más chico
+ *          y su respuesta.
+ *
+ * @param[in] handler Puntero a la estructura de separación de frames.
+ *
+ * @return true  Si hay lugar en la arena.
+ * @return false Si no hay lugar, el frame se descarta.
+ */
+static bool sf_arena_frame_iniciar(sf_t* handler)
+{
+	uint8_t* frame = arena_frame_iniciar(&(handler->arena), LEN_HEADER + SF_MARGEN_RESPUESTA);
+
+	if (frame == NULL)
+		return false;
+	handler->buffer = frame;
+	sf_limite_rx_actualizar(handler);
+	return true;
+}
+
+/**
+ * @brief Consigue más lugar contiguo para el paquete en recepción.
+ *
+ * @details Si el paquete llegó al final de la arena y el principio está libre, lo mueve al principio.
+ *          Sólo se llama desde la ISR de RX.
+ *
+ * @param[in] handler Puntero a la estructura de separación de frames.
+ *
+ * @return true  Si se consiguió lugar.
+ * @return false Si no hay lugar, el paquete sigue donde estaba.
+ */
+static bool sf_bloque_de_memoria_agrandar(sf_t* handler)
+{
+	uint8_t* frame = arena_frame_asegurar(&(handler->arena), handler->cantidad, handler->cantidad + SF_MARGEN_RESPUESTA + 1);
+
+	if (frame == NULL)
+		return false;
+	handler->buffer = frame;
+	sf_limite_rx_actualizar(handler);
+	return true;
+}
+
+/**
+ * @brief Calcula cuántos bytes del paquete entran en el lugar contiguo libre de la arena.
+ *
+ * @details Igual que con el pool, se deja SF_MARGEN_RESPUESTA bytes para la respuesta. Si hay lugar para
+ *          MSG_MAX_SIZE bytes el límite es MSG_MAX_SIZE (R_C2_7).
+ *
+ * @param[in] handler Puntero a la estructura de separación de frames.
+ */
+static void sf_limite_rx_actualizar(sf_t* handler)
+{
+	uint32_t disponible = arena_disponible(&(handler->arena));
+
+	if (disponible >= MSG_MAX_SIZE)
+		handler->limite_rx = MSG_MAX_SIZE;
+	else
+		handler->limite_rx = disponible - SF_MARGEN_RESPUESTA;
+}
+
+/**
+ * @brief Reserva en la arena el frame recibido, con lugar para la respuesta.
+ *
+ * @param[in] handler Puntero a la estructura de separación de frames.
+ */
+static void sf_arena_frame_cerrar(sf_t* handler)
+{
+	uint32_t tam = handler->cantidad + SF_MARGEN_RESPUESTA;
+
+	arena_frame_cerrar(&(handler->arena), (tam < MSG_MAX_SIZE) ? tam : MSG_MAX_SIZE);
+}
+#else
 /**
  * @brief Asigna un nuevo bloque de memoria del pool para recibir un mensaje.
  * 
+ * @details El bloque sale del magazine de la UART, que en general tiene el último bloque liberado por la
+ *          ISR de TX, así que la mayoría de los frames no entran a una sección crítica del pool.
+ *          Fuera de las ISR de la UART sólo se puede llamar con sus interrupciones enmascaradas.
+ * 
  * @param[in] handler Puntero a la estructura de separación de frames.
  *  
  * @return true  Si había memoria disponible. 
@@ -225,12 +513,63 @@ static uint8_t sf_decodificar_ascii(uint8_t byte)
  */
 static bool sf_bloque_de_memoria_nuevo(sf_t* handler)
 {
-	handler->buffer = (uint8_t*) QMPool_get(&(handler->pool_memoria), 0); // Pido un bloque del pool
+	handler->buffer = (uint8_t*) pool_clases_get(&(handler->pool_memoria), 0, SF_MAGS_UART(handler), &(handler->clase_rx)); // Pido el bloque más chico libre
 	if(handler->buffer == NULL)
 		return false;
+	sf_limite_rx_actualizar(handler);
+#if SF_RX_ESTADISTICAS
+	if (++handler->bloques_en_uso > handler->bloques_en_uso_max)
+		handler->bloques_en_uso_max = handler->bloques_en_uso;
+#endif
+	return true;
+}
+
+/**
+ * @brief Pasa el paquete en recepción a un bloque de una clase más grande.
+ *
+ * @details Copia los bytes recibidos al bloque nuevo y devuelve el anterior a su pool, así la aplicación
+ *          y la transmisión siguen viendo el paquete contiguo.
+ *          Sólo se llama desde la ISR de RX.
+ *
+ * @param[in] handler Puntero a la estructura de separación de frames.
+ *
+ * @return true  Si había un bloque más grande disponible.
+ * @return false Si no hay un bloque más grande disponible, el paquete sigue en el bloque actual.
+ */
+static bool sf_bloque_de_memoria_agrandar(sf_t* handler)
+{
+	uint8_t clase;
+	uint8_t* bloque = (uint8_t*) pool_clases_get(&(handler->pool_memoria), handler->clase_rx + 1, SF_MAGS_UART(handler), &clase);
+
+	if (bloque == NULL)
+		return false;
+	memcpy(bloque, handler->buffer, handler->cantidad);
+	pool_clases_put(&(handler->pool_memoria), handler->buffer, SF_MAGS_UART(handler));
+	handler->buffer = bloque;
+	handler->clase_rx = clase;
+	sf_limite_rx_actualizar(handler);
 	return true;
 }
 
+/**
+ * @brief Calcula cuántos bytes del paquete entran en el bloque en recepción.
+ *
+ * @details Se deja SF_MARGEN_RESPUESTA bytes libres para que la respuesta, que se arma sobre el mismo
+ *          bloque, entre aunque sea más larga que el pedido. En la última clase el límite es MSG_MAX_SIZE
+ *          (R_C2_7) y es la aplicación la que limita el largo de la respuesta.
+ *
+ * @param[in] handler Puntero a la estructura de separación de frames.
+ */
+static void sf_limite_rx_actualizar(sf_t* handler)
+{
+	if (handler->clase_rx == handler->pool_memoria.cant_clases - 1)
+		handler->limite_rx = MSG_MAX_SIZE;
+	else
+		handler->limite_rx = pool_clases_tam(&(handler->pool_memoria), handler->clase_rx) - SF_MARGEN_RESPUESTA;
+}
+#endif
+
+#if !SF_VALIDACION_DIFERIDA
 /**
  * @brief Valida el campo ID y CRC del paquete.
  * 
@@ -243,19 +582,21 @@ static bool sf_paquete_validar(sf_t* handler)
 {
 	bool resp = false;
 	
-	if (sf_validar_crc8(handler) && sf_validar_id(handler)) //R_C2_11
+	if (sf_validar_crc8(handler)) //R_C2_11 El ID ya lo verificó la tabla de transiciones
 		resp = true;
 
 	return resp;
 }
+#endif
 
 /**
  * @brief Le sirve a la aplicación para esperar el mensaje de nuevo paquete.
  * 
- * @param[in] handler Puntero a la estructura de separación de frames.
+ * @param[in] handler       Puntero a la estructura de separación de frames.
+ * @param[out] ptr_mensaje  Evento del paquete recibido. Se devuelve con sf_mensaje_procesado_enviar.
  *
  */
-bool sf_mensaje_recibir(sf_t* handler, tMensaje* ptr_mensaje)
+bool sf_mensaje_recibir(sf_t* handler, tMensaje** ptr_mensaje)
 {
 	objeto_get(handler->ptr_objeto1, ptr_mensaje);
 		return true;
@@ -264,143 +605,529 @@ bool sf_mensaje_recibir(sf_t* handler, tMensaje* ptr_mensaje)
 /**
  * @brief La aplicación le avisa por acá que procesó un dato. 
  * 
- * @details Dispara la interrupción tx_isr, mientras haya espacio en el buffer de transmisión se ejecuta la tx_isr
+ * @details Sella el mensaje con el CRC y el EOM en contexto de tarea y dispara la interrupción tx_isr,
+ *          mientras haya espacio en el buffer de transmisión se ejecuta la tx_isr. El evento no puede
+ *          compartirse con otro suscriptor (ver sf_mensaje_escribible y sf_mensaje_corto).
+ * 
+ * @param[in] handler Puntero a la estructura de separación de frames.
+ * @param[in] mensaje Evento con la respuesta, el que se recibió con el paquete o el que lo reemplazó.
+ */
+void sf_mensaje_procesado_enviar( sf_t* handler, tMensaje* mensaje )
+{
+	sf_mensaje_procesado_encolar(handler, mensaje);
+	sf_setOn_tx_isr(handler);
+}
+
+/**
+ * @brief Como sf_mensaje_procesado_enviar, pero sin disparar la transmisión.
+ * 
+ * @details Sirve para encolar varias respuestas y disparar la tx_isr una sola vez con sf_transmitir. La cola de
+ *          TX tiene lugar para todos los bloques del pool, así que encolar nunca se bloquea esperando a la UART.
  * 
  * @param[in] handler Puntero a la estructura de separación de frames.
+ * @param[in] mensaje Evento con la respuesta, con una sola referencia.
  */
-void sf_mensaje_procesado_enviar( sf_t* handler, tMensaje mensaje )
+void sf_mensaje_procesado_encolar( sf_t* handler, tMensaje* mensaje )
 {
+	configASSERT(mensaje->referencias == 1);
+	sf_mensaje_sellar(mensaje);
+	sf_mensaje_dueno(handler, mensaje, SF_DUENO_TX);
 	objeto_post(handler->ptr_objeto2, mensaje);
+}
+
+/**
+ * @brief Dispara la transmisión de las respuestas encoladas con sf_mensaje_procesado_encolar.
+ * 
+ * @param[in] handler Puntero a la estructura de separación de frames.
+ */
+void sf_transmitir( sf_t* handler )
+{
 	sf_setOn_tx_isr(handler);
 }
 
 /**
- * @brief Libera un bloque de memoria del pool de memoria
+ * @brief Devuelve un evento que la aplicación puede modificar: el mismo si nadie más lo tiene o una copia.
+ *
+ * @details Los suscriptores de un frame publicado comparten el evento y su bloque sólo para lectura. Antes de
+ *          armar la respuesta sobre el bloque, quien lo modifica pide su propia copia en un bloque de la misma
+ *          clase o mayor y suelta la referencia al original. El evento y el bloque salen de los pools sin
+ *          enmascarar interrupciones. Nunca espera: si no hay lugar para la copia devuelve NULL, y en la arena,
+ *          donde los frames sólo se ubican desde la ISR de RX, no hay copia.
+ *          Sólo en contexto de tarea.
+ *
+ * @param[in] handler Puntero a la estructura de separación de frames.
+ * @param[in] mensaje Evento del paquete recibido.
+ *
+ * @return tMensaje* Evento con una sola referencia, que reemplaza a mensaje, o NULL si no hay lugar para la copia.
+ *                   Con NULL el que llama conserva su referencia a mensaje y puede responder con sf_mensaje_corto.
+ */
+tMensaje* sf_mensaje_escribible(sf_t* handler, tMensaje* mensaje)
+{
+#if !SF_RX_ARENA
+	uint8_t* bloque;
+	uint8_t clase;
+	tMensaje* copia;
+#endif
+
+	if (mensaje->referencias == 1)
+		return mensaje;
+#if SF_RX_ARENA
+	(void)handler;
+	return NULL;
+#else
+	copia = (tMensaje*) QMPool_get(&(handler->pool_eventos), 0);
+	if (copia == NULL)
+		return NULL;
+	bloque = (uint8_t*) pool_clases_get(&(handler->pool_memoria),
+	                                    pool_clases_clase(&(handler->pool_memoria), mensaje->ptr_datos), NULL, &clase);
+	if (bloque == NULL)
+	{
+		QMPool_put(&(handler->pool_eventos), copia);
+		return NULL;
+	}
+#if SF_RX_ESTADISTICAS
+	// Las ISR de la UART cuentan sin atómicos, pero no las interrumpe esta tarea
+	qf_atomic_max16(&(handler->bloques_en_uso_max), qf_atomic_add16(&(handler->bloques_en_uso), 1));
+#endif
+	memcpy(bloque, mensaje->ptr_datos - INDICE_INICIO_MENSAJE, mensaje->cantidad + INDICE_INICIO_MENSAJE);
+	*copia = *mensaje;
+	copia->ptr_datos = bloque + INDICE_INICIO_MENSAJE;
+	copia->referencias = 1;
+	objeto_evento_liberar(mensaje);
+	return copia;
+#endif
+}
+
+/**
+ * @brief Devuelve un evento donde la aplicación puede escribir una respuesta de hasta SF_CORTO_DATOS bytes.
+ *
+ * @details Si nadie más tiene el evento es el mismo. Si no, toma una respuesta corta de su pool, que tiene el
+ *          bloque dentro del evento, le copia el SOM y el ID del paquete y suelta la referencia al original. No
+ *          usa el pool de bloques ni la arena, así que sirve para responder un error cuando falla
+ *          sf_mensaje_escribible. Nunca espera.
+ *          Sólo en contexto de tarea.
+ *
+ * @param[in] handler Puntero a la estructura de separación de frames.
+ * @param[in] mensaje Evento del paquete recibido.
+ *
+ * @return tMensaje* Evento con una sola referencia, que reemplaza a mensaje, o NULL si no quedan respuestas cortas.
+ *                   Con NULL el que llama conserva su referencia a mensaje.
+ */
+tMensaje* sf_mensaje_corto(sf_t* handler, tMensaje* mensaje)
+{
+	sf_corto_t* corto;
+
+	if (mensaje->referencias == 1)
+		return mensaje;
+	corto = (sf_corto_t*) QMPool_get(&(handler->pool_cortos), 0);
+	if (corto == NULL)
+		return NULL;
+	memcpy(corto->bloque, mensaje->ptr_datos - INDICE_INICIO_MENSAJE, INDICE_INICIO_MENSAJE);
+	corto->evento = *mensaje;
+	corto->evento.ptr_datos = corto->bloque + INDICE_INICIO_MENSAJE;
+	corto->evento.cantidad = 0;
+	corto->evento.referencias = 1;
+	corto->evento.destructor = sf_corto_destruir;
+	objeto_evento_liberar(mensaje);
+	return &(corto->evento);
+}
+
+#if SF_TELEMETRIA
+/**
+ * @brief Registra qué etapa tiene el bloque de un mensaje, para la telemetría del pool.
+ *
+ * @param[in] handler Puntero a la estructura de separación de frames.
+ * @param[in] mensaje Mensaje cuyo bloque cambia de etapa.
+ * @param[in] dueno   Etapa que tiene el bloque (SF_DUENO_xxx).
+ */
+void sf_mensaje_dueno(sf_t* handler, const tMensaje* mensaje, uint8_t dueno)
+{
+	// Las respuestas cortas no tienen bloque del pool
+	if (mensaje->destructor != sf_evento_destruir)
+		return;
+	pool_clases_dueno(&(handler->pool_memoria), mensaje->ptr_datos - INDICE_INICIO_MENSAJE, dueno);
+}
+#endif
+
+/**
+ * @brief Escribe el CRC en ASCII y el EOM a continuación de los datos del mensaje.
+ * 
+ * @details El CRC se calcula sobre el ID y los datos, que están antes de ptr_datos en el mismo bloque.
+ * 
+ * @param[in] mensaje Mensaje a sellar.
+ */
+static void sf_mensaje_sellar(tMensaje* mensaje)
+{
+	uint8_t crc = crc8_calc(0, mensaje->ptr_datos - LEN_ID, mensaje->cantidad + LEN_ID);
+
+	mensaje->ptr_datos[mensaje->cantidad] = sf_codificar_ascii(crc >> SHIFT_4b);
+	mensaje->ptr_datos[mensaje->cantidad + 1] = sf_codificar_ascii(crc & 0x0F);
+	mensaje->ptr_datos[mensaje->cantidad + LEN_CRC] = EOM_BYTE;	// Inserto el EOM
+}
+
+/**
+ * @brief Reserva un evento para el frame recibido y lo postea en la cola de un objeto.
+ * 
+ * @details Por la cola pasa sólo el puntero al evento. El evento apunta a los datos del frame dentro del
+ *          bloque, igual que lo va a ver la aplicación, y tiene una sola referencia.
+ *          Sólo se llama desde la ISR de RX.
+ * 
+ * @param[in] handler                   Puntero a la estructura de separación de frames.
+ * @param[in] objeto                    Objeto que recibe el frame.
+ * @param[in] dueno                     Etapa que pasa a tener el bloque (SF_DUENO_xxx).
+ * @param[out] pxHigherPriorityTaskWoken En pdTRUE si se despertó una tarea de mayor prioridad.
+ * 
+ * @return true  Si se posteó el evento.
+ * @return false Si no había evento libre o la cola estaba llena, el bloque sigue en recepción.
+ */
+static bool sf_evento_postear(sf_t* handler, tObjeto* objeto, uint8_t dueno, BaseType_t* pxHigherPriorityTaskWoken)
+{
+	tMensaje* evento = (tMensaje*) QMPool_get(&(handler->pool_eventos), 0);
+
+	if (evento == NULL)
+		return false;
+	// Cargo puntero con inicio de mensaje para la aplicación
+	evento->ptr_datos = handler->buffer + INDICE_INICIO_MENSAJE;
+	evento->cantidad = handler->cantidad - LEN_HEADER;
+	evento->evento_tipo = PAQUETE;
+	evento->referencias = 1;
+	evento->destructor = sf_evento_destruir;
+	evento->contexto = handler;
+	sf_mensaje_dueno(handler, evento, dueno);
+	if (objeto_post_fromISR(objeto, evento, pxHigherPriorityTaskWoken))
+		return true;
+	sf_mensaje_dueno(handler, evento, SF_DUENO_RX);
+	QMPool_put(&(handler->pool_eventos), evento);
+	return false;
+}
+
+/**
+ * @brief Devuelve el bloque de un evento a su pool, o a la arena, y el evento al pool de eventos.
+ * 
+ * @details Si la recepción se había quedado sin bloque, pide uno ahora que liberó.
+ *          Fuera de las ISR de la UART sólo se puede llamar con sus interrupciones enmascaradas.
+ * 
+ * @param[in] handler Puntero a la estructura de separación de frames.
+ * @param[in] evento  Evento a reciclar, ya sin referencias.
+ * @param[in] isr_uart true desde las ISR de la UART, que usan sus magazines, false para ir directo al pool.
+ */
+static void sf_evento_reciclar(sf_t* handler, tMensaje* evento, bool isr_uart)
+{
+	uint8_t* bloque = evento->ptr_datos - INDICE_INICIO_MENSAJE;	// El inicio del bloque tiene como offset el INDICE_INICIO_MENSAJE
+
+	// Las respuestas cortas vuelven a su pool con el bloque adentro
+	if (evento->destructor == sf_corto_destruir)
+	{
+		QMPool_put(&(handler->pool_cortos), evento);
+		return;
+	}
+	QMPool_put(&(handler->pool_eventos), evento);
+#if SF_RX_ARENA
+	(void)isr_uart;
+	arena_frame_liberar(&(handler->arena), bloque);
+#else
+	pool_clases_put(&(handler->pool_memoria), bloque, isr_uart ? SF_MAGS_UART(handler) : NULL);
+#if SF_RX_ESTADISTICAS
+	handler->bloques_en_uso--;
+#endif
+	sf_bloque_de_memoria_reponer(handler);
+#endif
+}
+
+/**
+ * @brief Destructor de los eventos de frame, lo llama objeto_evento_liberar al soltarse la última referencia.
+ * 
+ * @param[in] evento Evento a reciclar.
+ */
+static void sf_evento_destruir(tMensaje* evento)
+{
+	sf_t* handler = (sf_t*)evento->contexto;
+
+	// El flag out_of_memory y el buffer de recepción también los usan las ISR de RX y TX
+	taskENTER_CRITICAL();
+	sf_evento_reciclar(handler, evento, false);
+	taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Destructor de las respuestas cortas, ver sf_mensaje_corto.
  * 
- * @param[in] ptr_mensaje Puntero al mensaje. 
+ * @param[in] evento Evento a reciclar, es el comienzo de su sf_corto_t.
  */
-void sf_bloque_de_memoria_liberar(sf_t* handler)
+static void sf_corto_destruir(tMensaje* evento)
 {
-	QMPool_put(&(handler->pool_memoria), handler->mensaje.ptr_datos - INDICE_INICIO_MENSAJE); // El inicio del bloque tiene como offset el INDICE_INICIO_MENSAJE
+	sf_t* handler = (sf_t*)evento->contexto;
 
+	QMPool_put(&(handler->pool_cortos), evento);
 }
 
 /**
- * @brief Reinicia mensaje al borrar EOM, SOM y cantidad.
+ * @brief Reinicia mensaje al volver al estado de espera del SOM y borrar la cantidad.
  * 
  * @param[in] handler Puntero a la estructura de separación de frames.
  */
 static void sf_reiniciar_mensaje(sf_t* handler)
 {
-	handler->EOM = false;
-	handler->SOM = false;
+	handler->estado = SF_ESTADO_ESPERA;
 	handler->cantidad = 0;
 }
 
+/**
+ * @brief Procesa una ráfaga de bytes recibidos.
+ * 
+ * @details Pasa cada byte por el separador de frames y entrega cada frame completo. Si al entregar un
+ *          frame no hay bloque de memoria para el siguiente, deja de recibir y los bytes que quedan en
+ *          la ráfaga se descartan (R_C2_9).
+ *          La llama la ISR de RX, pero también se puede usar para inyectar bytes desde otra fuente.
+ * 
+ * @param[in] handler                   Puntero a la estructura de separación de frames.
+ * @param[in] ptr_datos                 Bytes recibidos.
+ * @param[in] cantidad                  Cantidad de bytes recibidos.
+ * @param[out] pxHigherPriorityTaskWoken En pdTRUE si al entregar un frame se despertó una tarea de mayor prioridad.
+ * 
+ * @return uint32_t Cantidad de bytes procesados.
+ */
+uint32_t sf_recibir_bytes(sf_t* handler, const uint8_t* ptr_datos, uint32_t cantidad, BaseType_t* pxHigherPriorityTaskWoken)
+{
+	uint32_t i;
+
+	for (i = 0; (i < cantidad) && (handler->buffer != NULL); i++)
+	{
+		if (sf_recibir_byte(handler, ptr_datos[i]))	// R_C2_5 Si llego EOM devuelve true, sino devuelve false
+			sf_frame_entregar(handler, pxHigherPriorityTaskWoken);
+	}
+	return i;
+}
+
+/**
+ * @brief Entrega el frame que terminó de recibirse y prepara la recepción del siguiente.
+ * 
+ * @param[in] handler                   Puntero a la estructura de separación de frames.
+ * @param[out] pxHigherPriorityTaskWoken En pdTRUE si se despertó una tarea de mayor prioridad.
+ */
+static void sf_frame_entregar(sf_t* handler, BaseType_t* pxHigherPriorityTaskWoken)
+{
+#if SF_RX_ESTADISTICAS
+	handler->largo_frames[handler->cantidad / SF_HIST_LARGO_PASO]++;
+#endif
+
+#if SF_VALIDACION_DIFERIDA
+	// Le paso el frame completo a la tarea validadora, el tiempo en la ISR no depende del largo del frame
+	if (sf_evento_postear(handler, handler->ptr_objeto_validar, SF_DUENO_VALIDADOR, pxHigherPriorityTaskWoken))
+		sf_frame_siguiente(handler);
+	else
+		sf_reiniciar_mensaje(handler);			// R_C2_12, el bloque se reutiliza para el próximo frame
+#else
+	// Envío a la cola el mensaje para la capa de aplicación.
+	if (sf_paquete_validar(handler) &&			// R_C2_10
+	    sf_evento_postear(handler, handler->ptr_objeto1, SF_DUENO_APP, pxHigherPriorityTaskWoken)) // R_C2_22
+		sf_frame_siguiente(handler);
+	else
+		sf_reiniciar_mensaje(handler);			// R_C2_12 y R_C2_21
+#endif
+}
+
+/**
+ * @brief Deja el frame entregado en manos de su evento y prepara el lugar para el siguiente.
+ * 
+ * @param[in] handler Puntero a la estructura de separación de frames.
+ */
+static void sf_frame_siguiente(sf_t* handler)
+{
+#if SF_RX_ARENA
+	sf_arena_frame_cerrar(handler);		// El próximo frame empieza a continuación
+	sf_reiniciar_mensaje(handler);
+#else
+	sf_reiniciar_mensaje(handler);
+	//  Pido un bloque de memoria nuevo, en caso de que no haya para la recepción por UART
+	if (!sf_bloque_de_memoria_nuevo(handler))					// R_C2_8
+	{
+		// Prendo este flag para indicar que cuando se libere un bloque de memoria se pida uno nuevo y se vuelva a habilitar la recepcion
+		handler->out_of_memory = true;
+#if SF_TELEMETRIA
+		handler->rx_sin_memoria++;
+#endif
+		uartCallbackClr(handler->uart, UART_RECEIVE); 			// R_C2_9
+	}
+#endif
+}
+
 /**
  * @brief ISR de recepción por UART.
  * 
+ * @details Lee todos los bytes disponibles en la FIFO y los procesa juntos, así el costo de entrar y
+ *          salir de la interrupción se reparte entre todos ellos.
+ * 
  * @param[in] parametro Puntero a la estructura de separación de frames. 
  * 
  */
 static void sf_rx_isr( void *parametro )
 {
 	sf_t* handler = (sf_t*)parametro;
-	tMensaje mensaje;
 	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+	uint8_t rafaga[SF_RX_RAFAGA_MAX];
+	uint32_t cantidad = 0;
 
+	while ((cantidad < SF_RX_RAFAGA_MAX) && uartRxReady(handler->uart))
+		rafaga[cantidad++] = uartRxRead( handler->uart ); // Leo byte de la UART con sAPI
+#if SF_RX_ESTADISTICAS
+	handler->rx_bytes_por_irq[cantidad]++;
+#endif
+	sf_recibir_bytes(handler, rafaga, cantidad, &xHigherPriorityTaskWoken);
+	portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
 
-	if(handler->buffer == NULL)
-		return;
-	
-	uint8_t byte_recibido = uartRxRead( handler->uart ); // Leo byte de la UART con sAPI
-
-	if (sf_recibir_byte(handler, byte_recibido))	// R_C2_5 Proceso el byte en contexto de interrupcion, si llego EOM devuelve true, sino devuelve false
+#if !SF_RX_ARENA
+/**
+ * @brief Si la recepción quedó detenida por falta de memoria, pide un bloque y la vuelve a habilitar.
+ * 
+ * @details Se llama después de devolver un bloque al pool.
+ * 
+ * @param[in] handler Puntero a la estructura de separación de frames.
+ */
+static void sf_bloque_de_memoria_reponer(sf_t* handler)
+{
+	if(handler->out_of_memory)
 	{
-		if (sf_paquete_validar(handler))			// R_C2_10
+		if (sf_bloque_de_memoria_nuevo(handler))
 		{
-			// Cargo puntero con inicio de mensaje para la aplicación
-			mensaje.ptr_datos = handler->buffer + INDICE_INICIO_MENSAJE;
-			mensaje.cantidad = handler->cantidad - LEN_HEADER;
-			// Envío a la cola el mensaje para la capa de aplicación.
-			mensaje.evento_tipo = PAQUETE; 
-			objeto_post_fromISR(handler->ptr_objeto1, mensaje, &xHigherPriorityTaskWoken); // R_C2_22
-			sf_reiniciar_mensaje(handler);
-			//  Pido un bloque de memoria nuevo, en caso de que no haya para la recepción por UART
-			if (!sf_bloque_de_memoria_nuevo(handler))					// R_C2_8
-			{
-				// Prendo este flag para indicar que cuando se libere un bloque de memoria se pida uno nuevo y se vuelva a habilitar la recepcion
-				handler->out_of_memory = true;
-				uartCallbackClr(handler->uart, UART_RECEIVE); 			// R_C2_9
-			}
+			// Si consigo el bloque apago el flag y habilito la recepción. De lo contrario no hago nada
+			handler->out_of_memory = false;
+			uartCallbackSet(handler->uart, UART_RECEIVE, sf_rx_isr, handler);
 		}
-		else
-			sf_reiniciar_mensaje(handler);			// R_C2_12 y R_C2_21
 	}
-	portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
 }
 
+#if SF_PERFIL
+/**
+ * @brief Verifica que una geometría cargada del perfil se pueda usar en lugar de la de sepa_frame_def.h.
+ *
+ * @param[in] geometria Geometría a verificar.
+ *
+ * @return true  Si las clases están ordenadas, la última es de MSG_MAX_SIZE, todo entra en POOL_SIZE y hay un
+ *               evento (SF_EVENTOS) para cada bloque.
+ * @return false Si no se puede usar.
+ */
+static bool sf_geometria_valida(const sf_geometria_t* geometria)
+{
+	uint32_t tam_total = 0;
+	uint32_t cant_total = 0;
+	uint8_t i;
+
+	if ((geometria->cant_clases == 0) || (geometria->cant_clases > POOL_CLASES_MAX) ||
+	    (geometria->tamanios[0] < LEN_HEADER + SF_MARGEN_RESPUESTA) ||
+	    (geometria->tamanios[geometria->cant_clases - 1] != MSG_MAX_SIZE))
+		return false;
+	for (i = 0; i < geometria->cant_clases; i++)
+	{
+		if ((geometria->cantidades[i] == 0) || ((i > 0) && (geometria->tamanios[i] <= geometria->tamanios[i - 1])))
+			return false;
+		// Igual que pool_clases_init, QMPool redondea el bloque a un múltiplo del tamaño de un puntero
+		tam_total += ((geometria->tamanios[i] + sizeof(void*) - 1) & ~(sizeof(void*) - 1)) * geometria->cantidades[i];
+		cant_total += geometria->cantidades[i];
+	}
+#if SF_TELEMETRIA && SF_ESTATICO
+	if (cant_total > SF_POOL_BLOQUES)
+		return false;
+#endif
+	// Cada bloque recibido viaja en un evento, y los eventos entran en las colas hacia la aplicación y la UART
+	return (tam_total <= POOL_SIZE) && (cant_total <= SF_EVENTOS);
+}
+#endif
+#endif
+
 /**
  * @brief ISR de transmisión por UART.
  * 
+ * @details La interrupción llega con la FIFO de TX vacía, así que se cargan hasta SF_TX_FIFO_MAX bytes.
+ *          Al terminar un mensaje se sigue con el próximo de la cola en la misma interrupción.
+ *          Los mensajes llegan sellados por sf_mensaje_procesado_enviar, acá sólo se copian bytes.
+ * 
  * @param[in] parametro Puntero a la estructura de separación de frames. 
  */
 static void sf_tx_isr( void *parametro )
 {
 	sf_t* handler = (sf_t*) parametro;
-	static uint32_t indice_byte_enviado = 0;
 	BaseType_t xTaskWokenByReceive = pdFALSE;
+	uint32_t enviados;
 
-	if (indice_byte_enviado == 0)
+	for (enviados = 0; enviados < SF_TX_FIFO_MAX; enviados++)
+	{
+		if (handler->tx_indice == 0)
 		{
 			if (objeto_get_fromISR(handler->ptr_objeto2, &handler->mensaje, &xTaskWokenByReceive) == pdFALSE)
 			{
 				uartCallbackClr(handler->uart, UART_TRANSMITER_FREE); //Elimino el callback para parar la tx_isr
-				return;
+				break;
 			}
-			/* calculo el CRC del nuevo mensaje*/
-			uint8_t crc = crc8_calc(0, handler->mensaje.ptr_datos - LEN_ID, handler->mensaje.cantidad + LEN_ID);
-			// Paso a ascii el primer dígito del CRC
-			uint8_t crc_aux = crc >> 4;
-			if ( crc_aux >= 0 && crc_aux <= 9)
-				handler->mensaje.ptr_datos[handler->mensaje.cantidad] = crc_aux + ASCII_0;
-			else
-				handler->mensaje.ptr_datos[handler->mensaje.cantidad] = crc_aux + ASCII_TO_NUM;
-			// Paso a ascii el segundo dígito del CRC
-			crc &= 0x0F;
-			if ( crc >= 0 && crc <= 9)
-				handler->mensaje.ptr_datos[handler->mensaje.cantidad + 1 ] = crc + ASCII_0;
-			else
-				handler->mensaje.ptr_datos[handler->mensaje.cantidad + 1 ] = crc + ASCII_TO_NUM;
-			// Inserto el EOM
-			handler->mensaje.ptr_datos[handler->mensaje.cantidad + LEN_CRC] = EOM_BYTE;
 		}
-	
-	if(handler->mensaje.cantidad != 0)
-	{
-		uartTxWrite(handler->uart, *(handler->mensaje.ptr_datos - INDICE_INICIO_MENSAJE + indice_byte_enviado) ); // R_C2_13 - R_C2_16
-		indice_byte_enviado++;
-		if ( indice_byte_enviado == (handler->mensaje.cantidad + LEN_HEADER))
+
+		uartTxWrite(handler->uart, *(handler->mensaje->ptr_datos - INDICE_INICIO_MENSAJE + handler->tx_indice) ); // R_C2_13 - R_C2_16
+		handler->tx_indice++;
+		if ( handler->tx_indice == (handler->mensaje->cantidad + LEN_HEADER))
 		{
-			indice_byte_enviado = 0;
-			sf_bloque_de_memoria_liberar(handler); 			// R_C2_15
-			//Verifico el flag, si se había quedado sin bloque de memoria pido uno ahora que liberé.
-			if(handler->out_of_memory)
-			{
-				if (sf_bloque_de_memoria_nuevo(handler))
-				{
-					// Si consigo el bloque apago el flag y habilito la recepción. De lo contrario no hago nada
-					handler->out_of_memory = false;
-					uartCallbackSet(handler->uart, UART_RECEIVE, sf_rx_isr, handler);
-				}
-			}
-			handler->mensaje.cantidad = 0;
-			handler->mensaje.ptr_datos = NULL;
+			handler->tx_indice = 0;
+			// Si nadie más tiene el evento se recicla acá, con los magazines de la UART
+			if (objeto_evento_soltar(handler->mensaje))
+				sf_evento_reciclar(handler, handler->mensaje, true); 	// R_C2_15
+			handler->mensaje = NULL;
 		}
 	}
 	portYIELD_FROM_ISR( xTaskWokenByReceive );
 }
 
+#if SF_VALIDACION_DIFERIDA
+/**
+ * @brief Valida el CRC de un frame completo.
+ * 
+ * @details La tabla de transiciones de la ISR ya verificó el largo mínimo y que el ID y los
+ *          dígitos del CRC sean ASCII hexa.
+ * 
+ * @param[in] frame     Frame desde el SOM hasta el EOM.
+ * @param[in] cantidad  Cantidad de bytes del frame.
+ * 
+ * @return true  CRC del frame válido.
+ * @return false CRC del frame inválido.
+ */
+static bool sf_frame_validar(const uint8_t* frame, uint32_t cantidad)
+{
+	uint8_t crc_h = frame[cantidad - LEN_EOM - LEN_CRC];
+	uint8_t crc_l = frame[cantidad - LEN_EOM - LEN_CRC + 1];
+
+	return crc8_calc(0, (void*)&frame[INDICE_INICIO_ID], cantidad - CANT_BYTE_FUERA_CRC) ==
+		   ((sf_decodificar_ascii(crc_h) << SHIFT_4b) | sf_decodificar_ascii(crc_l));		// R_C2_11
+}
+
+/**
+ * @brief Tarea validadora de frames.
+ * 
+ * @details Recibe los frames que separó la ISR de RX, pasa a la aplicación el evento de los válidos y
+ *          libera el de los inválidos, que devuelve el bloque al pool. Tiene la prioridad más alta para que la validación no quede
+ *          demorada detrás de la aplicación.
+ * 
+ * @param[in] parametro Puntero a la estructura de separación de frames.
+ */
+static void sf_validador_tarea(void* parametro)
+{
+	sf_t* handler = (sf_t*)parametro;
+	tMensaje* frame;
+
+	for (;;)
+	{
+		objeto_get(handler->ptr_objeto_validar, &frame);
+		if (sf_frame_validar(frame->ptr_datos - INDICE_INICIO_MENSAJE, frame->cantidad + LEN_HEADER))	// R_C2_10
+		{
+			// El mismo evento pasa a la aplicación
+			sf_mensaje_dueno(handler, frame, SF_DUENO_APP);
+			objeto_post(handler->ptr_objeto1, frame);				// R_C2_22
+		}
+		else
+			objeto_evento_liberar(frame);							// R_C2_12
+	}
+}
+#endif
+
+#if (SF_TIMEOUT_MODO == SF_TIMEOUT_TIMER)
 /**
  * @brief Timer callback.
  * 
@@ -414,6 +1141,49 @@ static void timer_callback(TimerHandle_t xTimer)
         sf_reiniciar_mensaje(handler);
     }
 }
+#else
+/**
+ * @brief Verifica si pasó más de TIMEOUT_US desde el último byte del paquete en curso.
+ * 
+ * @details Un paquete incompleto sólo afecta a los bytes que llegan después, así que alcanza con
+ *          verificar el timeout al recibir el byte siguiente, sin timers ni comandos al daemon.
+ *          El contador de ciclos da la resolución fina pero da la vuelta cada 2^32 ciclos, por eso
+ *          los silencios de más de un tick por encima del timeout se detectan con el tick del sistema.
+ * 
+ * @param handler Puntero a la estructura de separación de frames.
+ * 
+ * @return true  Si el paquete en curso quedó vencido.
+ * @return false Si todavía está dentro del timeout.
+ */
+static bool sf_timeout_vencido(sf_t* handler)
+{
+	if ((xTaskGetTickCountFromISR() - handler->ultimo_byte_tick) > (pdMS_TO_TICKS(TIMEOUT_US / 1000UL) + 1))
+		return true;
+	return ((cyclesCounterRead() - handler->ultimo_byte_ciclos) > handler->timeout_ciclos);
+}
+#endif
+
+#ifdef SF_RX_FIFO_NIVEL
+/**
+ * @brief Devuelve los registros de la USART del LPC4337 que usa la sAPI para cada UART.
+ * 
+ * @param uart UART de la sAPI.
+ * 
+ * @return LPC_USART_T* Registros de la USART.
+ */
+static LPC_USART_T* sf_uart_lpc(uartMap_t uart)
+{
+	switch (uart)
+	{
+		case UART_USB:
+			return LPC_USART2;
+		case UART_232:
+			return LPC_USART3;
+		default:
+			return LPC_USART0;	// UART_GPIO, UART_485 y UART_ENET
+	}
+}
+#endif
 
 /**
  * @brief Setea y dispara la interrupción de TX de la UART
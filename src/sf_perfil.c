@@ -0,0 +1,93 @@
+/*=============================================================================
+ * Copyright (c) 2021, Fernando Prokopiuk <fernandoprokopiuk@gmail.com>
+ * 					   Jonathan Cagua <jonathan.cagua@gmail.com>
+ * 					   Leandro Arrieta <leandroarrieta@gmail.com>
+ * All rights reserved.
+ * License: Free
+ * Date: 18/10/2026
+ * Version: v1.0
+ *===========================================================================*/
+
+#include "sf_perfil.h"
+#if defined(SF_PERFIL_ARCHIVO) || defined(SF_PERFIL_HISTOGRAMA_ARCHIVO)
+#include <stdio.h>
+#endif
+
+/**
+ * @brief Lee la geometría del pool guardada.
+ *
+ * @details En el host lee el archivo SF_PERFIL_ARCHIVO que genera tools/sf_pool_autotune.py, con una línea
+ *          "clase <tamaño> <cantidad>" por clase, de menor a mayor.
+ *
+ * @param[out] geometria Geometría leída.
+ *
+ * @return true  Si había una geometría guardada.
+ * @return false Si no hay geometría guardada, se usa la de sepa_frame_def.h.
+ */
+__attribute__((weak)) bool sf_perfil_cargar(sf_geometria_t* geometria)
+{
+#ifdef SF_PERFIL_ARCHIVO
+	FILE* archivo = fopen(SF_PERFIL_ARCHIVO, "r");
+	char linea[64];
+	unsigned tam, cant;
+
+	if (archivo == NULL)
+		return false;
+	geometria->cant_clases = 0;
+	while (fgets(linea, sizeof(linea), archivo) != NULL)
+	{
+		if (sscanf(linea, "clase %u %u", &tam, &cant) != 2)
+			continue;		// Comentarios y líneas en blanco
+		if (geometria->cant_clases == POOL_CLASES_MAX)
+		{
+			geometria->cant_clases = 0;
+			break;
+		}
+		geometria->tamanios[geometria->cant_clases] = (uint16_t)tam;
+		geometria->cantidades[geometria->cant_clases] = (uint16_t)cant;
+		geometria->cant_clases++;
+	}
+	fclose(archivo);
+	return geometria->cant_clases > 0;
+#else
+	(void)geometria;
+	return false;
+#endif
+}
+
+/**
+ * @brief Guarda el perfil de los frames recibidos: histograma de largos y máximo de bloques en uso.
+ *
+ * @details En el host escribe el archivo SF_PERFIL_HISTOGRAMA_ARCHIVO, que es la entrada de
+ *          tools/sf_pool_autotune.py.
+ *
+ * @param[in] handler Puntero a la estructura de separación de frames.
+ *
+ * @return true  Si se guardó el perfil.
+ * @return false Si no hay dónde guardarlo o no se registra el perfil (SF_RX_ESTADISTICAS, modo pool).
+ */
+__attribute__((weak)) bool sf_perfil_guardar(const sf_t* handler)
+{
+#if defined(SF_PERFIL_HISTOGRAMA_ARCHIVO) && SF_RX_ESTADISTICAS && !SF_RX_ARENA
+	FILE* archivo = fopen(SF_PERFIL_HISTOGRAMA_ARCHIVO, "w");
+	uint8_t i;
+
+	if (archivo == NULL)
+		return false;
+	fprintf(archivo, "# perfil de frames recibidos\n");
+	fprintf(archivo, "paso %u\n", SF_HIST_LARGO_PASO);
+	fprintf(archivo, "margen %u\n", SF_MARGEN_RESPUESTA);
+	fprintf(archivo, "msg_max %u\n", MSG_MAX_SIZE);
+	fprintf(archivo, "en_uso_max %u\n", handler->bloques_en_uso_max);
+	for (i = 0; i < SF_HIST_LARGO_BINS; i++)
+	{
+		if (handler->largo_frames[i] != 0)
+			fprintf(archivo, "largo %u %lu\n", i * SF_HIST_LARGO_PASO, (unsigned long)handler->largo_frames[i]);
+	}
+	fclose(archivo);
+	return true;
+#else
+	(void)handler;
+	return false;
+#endif
+}
@@ -0,0 +1,60 @@
+/* FreeRTOS para las pruebas en Linux: tipos y macros mínimos, las funciones están en rtos_host.c */
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include "FreeRTOSConfig.h"
+
+#ifndef configSUPPORT_DYNAMIC_ALLOCATION
+#define configSUPPORT_DYNAMIC_ALLOCATION    1
+#endif
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+typedef void (*TaskFunction_t)(void*);
+typedef void* TaskHandle_t;
+typedef void* QueueHandle_t;
+typedef void* TimerHandle_t;
+typedef struct { void* d[20]; } StaticTask_t;
+typedef struct { void* d[20]; } StaticQueue_t;
+typedef struct { void* d[12]; } StaticTimer_t;
+
+#define pdFALSE                 0
+#define pdTRUE                  1
+#define pdPASS                  1
+#define pdFAIL                  0
+#define portMAX_DELAY           0xffffffffUL
+#define pdMS_TO_TICKS(x)        ((TickType_t)(x))
+#define portTICK_PERIOD_MS      1
+#define portBYTE_ALIGNMENT      8
+#define portBYTE_ALIGNMENT_MASK 7
+#define portYIELD_FROM_ISR(x)   (void)(x)
+
+/* Las secciones críticas toman un mutex global, así las versiones con interrupciones enmascaradas también son
+   correctas con hilos */
+void host_critica_entrar(void);
+void host_critica_salir(void);
+extern unsigned long host_criticas_isr;    // Secciones críticas de ISR, en el LPC4337 interrupciones enmascaradas
+#define taskENTER_CRITICAL()            host_critica_entrar()
+#define taskEXIT_CRITICAL()             host_critica_salir()
+#define portENTER_CRITICAL()            host_critica_entrar()
+#define portEXIT_CRITICAL()             host_critica_salir()
+#define taskENTER_CRITICAL_FROM_ISR()   (host_critica_entrar(), host_criticas_isr++, 0)
+#define taskEXIT_CRITICAL_FROM_ISR(x)   ((void)(x), host_critica_salir())
+/* configASSERT llama a taskDISABLE_INTERRUPTS antes de colgarse: en el host la prueba termina con error */
+#define taskDISABLE_INTERRUPTS()        abort()
+#define taskYIELD()                     do{}while(0)
+#define traceMALLOC(a,b)
+#define traceFREE(a,b)
+#define mtCOVERAGE_TEST_MARKER()
+
+void* pvPortMalloc(size_t n);
+void vPortFree(void* p);
+size_t xPortGetFreeHeapSize(void);
+size_t xPortGetMinimumEverFreeHeapSize(void);
+
+#endif
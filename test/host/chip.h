@@ -0,0 +1,42 @@
+/* LPCOpen para las pruebas en Linux: sólo lo que usa la UART de separacion_frames.c y las instrucciones SIMD de
+   app_clasificar.h */
+#ifndef HOST_CHIP_H
+#define HOST_CHIP_H
+#include <stdint.h>
+extern uint32_t SystemCoreClock;
+typedef struct { uint32_t fcr; } LPC_USART_T;
+extern LPC_USART_T host_usart[4];
+#define LPC_USART0          (&host_usart[0])
+#define LPC_USART2          (&host_usart[2])
+#define LPC_USART3          (&host_usart[3])
+#define UART_FCR_FIFO_EN    (1 << 0)
+#define UART_FCR_RX_RS      (1 << 1)
+#define UART_FCR_TX_RS      (1 << 2)
+#define UART_FCR_TRG_LEV0   (0)
+#define UART_FCR_TRG_LEV1   (1 << 6)
+#define UART_FCR_TRG_LEV2   (2 << 6)
+#define UART_FCR_TRG_LEV3   (3 << 6)
+static inline void Chip_UART_SetupFIFOS(LPC_USART_T* u, uint32_t f) { u->fcr = f; }
+
+/* __USUB8 y __SEL del Cortex-M4 con los flags GE del APSR en una variable, para probar el camino SIMD */
+extern __thread uint32_t host_apsr_ge;
+static inline uint32_t __USUB8(uint32_t a, uint32_t b)
+{
+    uint32_t r = 0;
+    host_apsr_ge = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        uint32_t x = (a >> (8 * i)) & 0xFF, y = (b >> (8 * i)) & 0xFF;
+        r |= ((x - y) & 0xFF) << (8 * i);
+        host_apsr_ge |= (uint32_t)(x >= y) << i;
+    }
+    return r;
+}
+static inline uint32_t __SEL(uint32_t a, uint32_t b)
+{
+    uint32_t r = 0;
+    for (int i = 0; i < 4; i++)
+        r |= (((host_apsr_ge >> i) & 1) ? a : b) & (0xFFU << (8 * i));
+    return r;
+}
+#endif
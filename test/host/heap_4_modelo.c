@@ -0,0 +1,146 @@
+/*
+ * Modelo de heap_4.c de FreeRTOS para comparar con src/heap_tlsf.c: lista de bloques libres ordenada por dirección,
+ * primer bloque que alcanza, división del sobrante y unión con los vecinos al liberar. Mismo encabezado, alineación y
+ * bloque mínimo que heap_4, y las mismas llamadas a vTaskSuspendAll. Cuenta además los nodos de la lista que recorre cada operación.
+ */
+#ifndef HOST_HEAP_4_MODELO_C
+#define HOST_HEAP_4_MODELO_C
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+typedef struct heap4_bloque
+{
+    struct heap4_bloque* siguiente;
+    size_t tam;
+} heap4_bloque_t;
+
+#define HEAP4_ENCABEZADO    ((sizeof(heap4_bloque_t) + portBYTE_ALIGNMENT_MASK) & ~(size_t)portBYTE_ALIGNMENT_MASK)
+#define HEAP4_BLOQUE_MIN    (HEAP4_ENCABEZADO * 2)
+#define HEAP4_OCUPADO       ((size_t)1 << (sizeof(size_t) * 8 - 1))
+
+static uint8_t heap4_memoria[configTOTAL_HEAP_SIZE] __attribute__((aligned(portBYTE_ALIGNMENT)));
+static heap4_bloque_t heap4_inicio;
+static heap4_bloque_t* heap4_fin;
+static size_t heap4_libres;
+uint32_t heap4_nodos;               // Nodos recorridos por la última operación
+uint32_t heap4_nodos_max;
+
+static void heap4_iniciar(void)
+{
+    heap4_bloque_t* primero = (heap4_bloque_t*)heap4_memoria;
+
+    heap4_fin = (heap4_bloque_t*)(heap4_memoria + ((configTOTAL_HEAP_SIZE - HEAP4_ENCABEZADO) &
+                                                  ~(size_t)portBYTE_ALIGNMENT_MASK));
+    heap4_fin->tam = 0;
+    heap4_fin->siguiente = NULL;
+    primero->tam = (size_t)((uint8_t*)heap4_fin - (uint8_t*)primero);
+    primero->siguiente = heap4_fin;
+    heap4_inicio.siguiente = primero;
+    heap4_inicio.tam = 0;
+    heap4_libres = primero->tam;
+}
+
+/* prvInsertBlockIntoFreeList */
+static void heap4_insertar(heap4_bloque_t* b)
+{
+    heap4_bloque_t* it;
+
+    for (it = &heap4_inicio; it->siguiente < b; it = it->siguiente)
+        heap4_nodos++;
+    if ((uint8_t*)it + it->tam == (uint8_t*)b)
+    {
+        it->tam += b->tam;
+        b = it;
+    }
+    if (((uint8_t*)b + b->tam == (uint8_t*)it->siguiente) && (it->siguiente != heap4_fin))
+    {
+        b->tam += it->siguiente->tam;
+        b->siguiente = it->siguiente->siguiente;
+    }
+    else
+        b->siguiente = it->siguiente;
+    if (it != b)
+        it->siguiente = b;
+}
+
+static void heap4_contar(void)
+{
+    if (heap4_nodos > heap4_nodos_max)
+        heap4_nodos_max = heap4_nodos;
+}
+
+static void* heap4_pedir(size_t pedido)
+{
+    heap4_bloque_t* anterior = &heap4_inicio;
+    heap4_bloque_t* b;
+    heap4_bloque_t* resto;
+
+    if (heap4_fin == NULL)
+        heap4_iniciar();
+    heap4_nodos = 0;
+    if ((pedido == 0) || (pedido > configTOTAL_HEAP_SIZE))
+        return NULL;
+    pedido = (pedido + HEAP4_ENCABEZADO + portBYTE_ALIGNMENT_MASK) & ~(size_t)portBYTE_ALIGNMENT_MASK;
+    if (pedido > heap4_libres)
+        return NULL;
+    for (b = heap4_inicio.siguiente; (b->tam < pedido) && (b->siguiente != NULL); b = b->siguiente)
+    {
+        anterior = b;
+        heap4_nodos++;
+    }
+    if (b == heap4_fin)
+    {
+        heap4_contar();
+        return NULL;
+    }
+    anterior->siguiente = b->siguiente;
+    if (b->tam - pedido > HEAP4_BLOQUE_MIN)
+    {
+        resto = (heap4_bloque_t*)((uint8_t*)b + pedido);
+        resto->tam = b->tam - pedido;
+        b->tam = pedido;
+        heap4_insertar(resto);
+    }
+    heap4_libres -= b->tam;
+    b->tam |= HEAP4_OCUPADO;
+    b->siguiente = NULL;
+    heap4_contar();
+    return (uint8_t*)b + HEAP4_ENCABEZADO;
+}
+
+void* heap4_pvPortMalloc(size_t pedido)
+{
+    void* p;
+
+    vTaskSuspendAll();
+    p = heap4_pedir(pedido);
+    (void)xTaskResumeAll();
+    return p;
+}
+
+void heap4_vPortFree(void* p)
+{
+    heap4_bloque_t* b;
+
+    if (p == NULL)
+        return;
+    b = (heap4_bloque_t*)((uint8_t*)p - HEAP4_ENCABEZADO);
+    configASSERT((b->tam & HEAP4_OCUPADO) != 0);
+    vTaskSuspendAll();
+    b->tam &= ~HEAP4_OCUPADO;
+    heap4_libres += b->tam;
+    heap4_nodos = 0;
+    heap4_insertar(b);
+    heap4_contar();
+    (void)xTaskResumeAll();
+}
+
+size_t heap4_xPortGetFreeHeapSize(void)
+{
+    if (heap4_fin == NULL)
+        heap4_iniciar();
+    return heap4_libres;
+}
+
+#endif
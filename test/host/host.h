@@ -0,0 +1,32 @@
+/* Utilidades comunes de las pruebas en Linux, ver rtos_host.c */
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+extern int host_ruido;              // Ceder el procesador al azar en las colas y los compare-and-swap
+extern int host_crear_falla_pct;    // Porcentaje de creaciones de tarea que fallan
+extern long host_tareas_creadas;
+extern uint8_t host_tx[4096];       // Bytes escritos en la UART
+extern uint32_t host_tx_n;
+
+uint32_t host_rand(void);
+void host_semilla(uint32_t valor);
+void host_ruido_meter(void);
+uint64_t host_ns(void);
+void host_timers_correr(void);       // Corre el callback de los timers vencidos, como el daemon
+
+/* Falla la prueba con un mensaje si la condición es falsa */
+#define VERIFICAR(cond, ...)                                                        \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            fprintf(stderr, "%s:%d: falla: %s: ", __FILE__, __LINE__, #cond);       \
+            fprintf(stderr, __VA_ARGS__);                                           \
+            fprintf(stderr, "\n");                                                  \
+            exit(1);                                                                \
+        }                                                                           \
+    } while (0)
+
+#endif
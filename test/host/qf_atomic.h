@@ -0,0 +1,26 @@
+/* qf_atomic.h de inc/ con host_ruido antes de cada compare-and-swap: en el LPC4337 una interrupción puede llegar
+   entre la lectura y el STREX, en Linux se abre esa ventana cediendo el procesador */
+#ifndef HOST_QF_ATOMIC_H
+#define HOST_QF_ATOMIC_H
+
+#include "host.h"
+
+#define qf_atomic_cas32 qf_atomic_cas32_sin_ruido
+#define qf_atomic_cas16 qf_atomic_cas16_sin_ruido
+#include "../../inc/qf_atomic.h"
+#undef qf_atomic_cas32
+#undef qf_atomic_cas16
+
+static inline bool qf_atomic_cas32(uint32_t volatile* p, uint32_t esperado, uint32_t nuevo)
+{
+    host_ruido_meter();
+    return qf_atomic_cas32_sin_ruido(p, esperado, nuevo);
+}
+
+static inline bool qf_atomic_cas16(uint16_t volatile* p, uint16_t esperado, uint16_t nuevo)
+{
+    host_ruido_meter();
+    return qf_atomic_cas16_sin_ruido(p, esperado, nuevo);
+}
+
+#endif
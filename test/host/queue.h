@@ -0,0 +1,14 @@
+#ifndef HOST_QUEUE_H
+#define HOST_QUEUE_H
+#include "FreeRTOS.h"
+QueueHandle_t xQueueCreate(UBaseType_t n, UBaseType_t tam);
+QueueHandle_t xQueueCreateStatic(UBaseType_t n, UBaseType_t tam, uint8_t* b, StaticQueue_t* s);
+BaseType_t xQueueSend(QueueHandle_t q, const void* v, TickType_t t);
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void* v, BaseType_t* w);
+BaseType_t xQueueReceive(QueueHandle_t q, void* v, TickType_t t);
+BaseType_t xQueueReceiveFromISR(QueueHandle_t q, void* v, BaseType_t* w);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q);
+UBaseType_t uxQueueMessagesWaitingFromISR(QueueHandle_t q);
+void vQueueDelete(QueueHandle_t q);
+BaseType_t xQueueReset(QueueHandle_t q);
+#endif
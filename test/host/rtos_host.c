@@ -0,0 +1,445 @@
+/*
+ * FreeRTOS y sAPI para las pruebas en Linux. Cada tarea es un hilo, las colas son buffers circulares con mutex y
+ * el tick es un milisegundo del reloj monotónico. Las secciones críticas toman un mutex global recursivo.
+ */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "timers.h"
+#include "sapi.h"
+#include "host.h"
+
+uint32_t SystemCoreClock = 204000000;
+LPC_USART_T host_usart[4];
+__thread uint32_t host_apsr_ge;
+
+/*==================[secciones críticas]=====================================*/
+
+static pthread_mutex_t critica = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+unsigned long host_criticas_isr;
+
+void host_critica_entrar(void) { pthread_mutex_lock(&critica); }
+void host_critica_salir(void) { pthread_mutex_unlock(&critica); }
+
+/*==================[ruido de planificación]=================================*/
+
+static __thread uint32_t semilla;
+int host_ruido;
+
+void host_semilla(uint32_t valor)
+{
+    semilla = valor | 1U;
+}
+
+uint32_t host_rand(void)
+{
+    if (semilla == 0)
+        semilla = (uint32_t)(uintptr_t)pthread_self() | 1U;
+    semilla ^= semilla << 13;
+    semilla ^= semilla >> 17;
+    semilla ^= semilla << 5;
+    return semilla;
+}
+
+/* Con host_ruido, las llamadas a colas y los compare-and-swap (host/qf_atomic.h) ceden el procesador o duermen al
+   azar para abrir ventanas de carrera */
+void host_ruido_meter(void)
+{
+    uint32_t r;
+
+    if (!host_ruido)
+        return;
+    r = host_rand() % 16U;
+    if (r == 0)
+        usleep(host_rand() % 50U);
+    else if (r < 5)
+        sched_yield();
+}
+
+/*==================[colas]==================================================*/
+
+typedef struct
+{
+    pthread_mutex_t m;
+    pthread_cond_t c;
+    uint32_t tam, n, cabeza, cola;
+    uint8_t* datos;
+} host_cola_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t n, UBaseType_t tam)
+{
+    host_cola_t* q = calloc(1, sizeof(*q));
+
+    pthread_mutex_init(&q->m, NULL);
+    pthread_cond_init(&q->c, NULL);
+    q->tam = tam;
+    q->n = n;
+    q->datos = malloc(n * tam);
+    return q;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t n, UBaseType_t tam, uint8_t* b, StaticQueue_t* s)
+{
+    (void)b;
+    (void)s;
+    return xQueueCreate(n, tam);
+}
+
+void vQueueDelete(QueueHandle_t h)
+{
+    (void)h;    // Las pruebas no reutilizan la memoria de una cola borrada
+}
+
+BaseType_t xQueueReset(QueueHandle_t h)
+{
+    host_cola_t* q = h;
+
+    pthread_mutex_lock(&q->m);
+    q->cabeza = q->cola = 0;
+    pthread_mutex_unlock(&q->m);
+    return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t h, const void* v, TickType_t t)
+{
+    host_cola_t* q = h;
+    BaseType_t ok = pdFAIL;
+
+    (void)t;
+    host_ruido_meter();
+    pthread_mutex_lock(&q->m);
+    if (q->cola - q->cabeza < q->n)
+    {
+        memcpy(q->datos + (q->cola % q->n) * q->tam, v, q->tam);
+        q->cola++;
+        pthread_cond_broadcast(&q->c);
+        ok = pdPASS;
+    }
+    pthread_mutex_unlock(&q->m);
+    host_ruido_meter();
+    return ok;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t h, const void* v, BaseType_t* w)
+{
+    (void)w;
+    return xQueueSend(h, v, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t h, void* v, TickType_t t)
+{
+    host_cola_t* q = h;
+    BaseType_t ok = pdFAIL;
+    struct timespec plazo;
+
+    host_ruido_meter();
+    pthread_mutex_lock(&q->m);
+    if ((q->cola == q->cabeza) && (t > 0))
+    {
+        clock_gettime(CLOCK_REALTIME, &plazo);
+        if (t > 100000)
+            t = 100000;
+        plazo.tv_nsec += (long)t * 1000000L;
+        plazo.tv_sec += plazo.tv_nsec / 1000000000L;
+        plazo.tv_nsec %= 1000000000L;
+        while ((q->cola == q->cabeza) && (pthread_cond_timedwait(&q->c, &q->m, &plazo) == 0))
+            ;
+    }
+    if (q->cola != q->cabeza)
+    {
+        memcpy(v, q->datos + (q->cabeza % q->n) * q->tam, q->tam);
+        q->cabeza++;
+        ok = pdPASS;
+    }
+    pthread_mutex_unlock(&q->m);
+    host_ruido_meter();
+    return ok;
+}
+
+BaseType_t xQueueReceiveFromISR(QueueHandle_t h, void* v, BaseType_t* w)
+{
+    (void)w;
+    return xQueueReceive(h, v, 0);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t h)
+{
+    host_cola_t* q = h;
+    UBaseType_t n;
+
+    host_ruido_meter();
+    pthread_mutex_lock(&q->m);
+    n = q->cola - q->cabeza;
+    pthread_mutex_unlock(&q->m);
+    host_ruido_meter();
+    return n;
+}
+
+UBaseType_t uxQueueMessagesWaitingFromISR(QueueHandle_t h)
+{
+    return uxQueueMessagesWaiting(h);
+}
+
+/*==================[tareas]=================================================*/
+
+int host_crear_falla_pct;       // Porcentaje de creaciones de tarea que fallan
+long host_tareas_creadas;
+
+typedef struct
+{
+    pthread_t hilo;
+    TaskFunction_t f;
+    void* p;
+} host_tarea_t;
+
+static void* host_tarea_correr(void* a)
+{
+    host_tarea_t* t = a;
+
+    t->f(t->p);
+    return NULL;
+}
+
+static host_tarea_t* host_tarea_crear(TaskFunction_t f, void* p)
+{
+    host_tarea_t* t;
+    pthread_attr_t atr;
+
+    if ((host_rand() % 100U) < (uint32_t)host_crear_falla_pct)
+        return NULL;
+    t = calloc(1, sizeof(*t));
+    t->f = f;
+    t->p = p;
+    pthread_attr_init(&atr);
+    pthread_attr_setdetachstate(&atr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&t->hilo, &atr, host_tarea_correr, t) != 0)
+    {
+        perror("pthread_create");
+        exit(2);
+    }
+    __atomic_add_fetch(&host_tareas_creadas, 1, __ATOMIC_SEQ_CST);
+    return t;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t f, const char* n, uint16_t s, void* p, UBaseType_t pr, TaskHandle_t* h)
+{
+    host_tarea_t* t = host_tarea_crear(f, p);
+
+    (void)n;
+    (void)s;
+    (void)pr;
+    if (h != NULL)
+        *h = t;
+    return (t != NULL) ? pdPASS : pdFAIL;
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t f, const char* n, uint32_t s, void* p, UBaseType_t pr, StackType_t* st,
+                               StaticTask_t* tb)
+{
+    (void)n;
+    (void)s;
+    (void)pr;
+    (void)st;
+    (void)tb;
+    return host_tarea_crear(f, p);
+}
+
+void vTaskDelete(TaskHandle_t h)
+{
+    // Una tarea bloqueada para siempre en ulTaskNotifyTake ya terminó su hilo, ver abajo
+    if (h == NULL)
+        pthread_exit(NULL);
+}
+
+/* Las tareas que se bloquean para siempre esperando que otra las borre terminan su hilo */
+uint32_t ulTaskNotifyTake(BaseType_t c, TickType_t t)
+{
+    (void)c;
+    (void)t;
+    pthread_exit(NULL);
+    return 0;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t h)
+{
+    (void)h;
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t h, BaseType_t* w)
+{
+    (void)h;
+    (void)w;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return NULL;
+}
+
+void vTaskStartScheduler(void)
+{
+}
+
+void vTaskDelay(TickType_t t)
+{
+    usleep((useconds_t)t * 1000U);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+TickType_t xTaskGetTickCountFromISR(void)
+{
+    return xTaskGetTickCount();
+}
+
+void vTaskSuspendAll(void)
+{
+    host_critica_entrar();
+}
+
+BaseType_t xTaskResumeAll(void)
+{
+    host_critica_salir();
+    return pdFALSE;
+}
+
+/*==================[timers]=================================================*/
+
+/* Los timers no tienen daemon: vencen cuando la prueba llama a host_timers_correr */
+typedef struct
+{
+    TimerCallbackFunction_t cb;
+    void* id;
+    TickType_t periodo;
+    TickType_t vence;
+    bool activo;
+} host_timer_t;
+
+static host_timer_t* host_timers[16];
+static uint32_t host_cant_timers;
+
+TimerHandle_t xTimerCreate(const char* n, TickType_t p, UBaseType_t r, void* id, TimerCallbackFunction_t cb)
+{
+    host_timer_t* t;
+
+    (void)n;
+    (void)r;
+    if (host_cant_timers == sizeof(host_timers) / sizeof(host_timers[0]))
+        return NULL;
+    t = calloc(1, sizeof(*t));
+    t->cb = cb;
+    t->id = id;
+    t->periodo = p;
+    host_timers[host_cant_timers++] = t;
+    return t;
+}
+
+TimerHandle_t xTimerCreateStatic(const char* n, TickType_t p, UBaseType_t r, void* id, TimerCallbackFunction_t cb,
+                                 StaticTimer_t* s)
+{
+    (void)s;
+    return xTimerCreate(n, p, r, id, cb);
+}
+
+BaseType_t xTimerStart(TimerHandle_t h, TickType_t x)
+{
+    host_timer_t* t = h;
+
+    (void)x;
+    t->vence = xTaskGetTickCount() + t->periodo;
+    t->activo = true;
+    return pdPASS;
+}
+
+BaseType_t xTimerStartFromISR(TimerHandle_t t, BaseType_t* w) { (void)w; return xTimerStart(t, 0); }
+BaseType_t xTimerStopFromISR(TimerHandle_t t, BaseType_t* w) { (void)w; ((host_timer_t*)t)->activo = false; return pdPASS; }
+void* pvTimerGetTimerID(TimerHandle_t t) { return ((host_timer_t*)t)->id; }
+
+void host_timers_correr(void)
+{
+    for (uint32_t i = 0; i < host_cant_timers; i++)
+    {
+        host_timer_t* t = host_timers[i];
+
+        if (t->activo && ((int32_t)(xTaskGetTickCount() - t->vence) >= 0))
+        {
+            t->activo = false;
+            t->cb(t);
+        }
+    }
+}
+
+BaseType_t xTimerPendFunctionCallFromISR(PendedFunction_t f, void* p, uint32_t v, BaseType_t* w)
+{
+    (void)w;
+    f(p, v);
+    return pdPASS;
+}
+
+/*==================[sAPI]===================================================*/
+
+void boardConfig(void) {}
+void uartConfig(uartMap_t u, uint32_t b) { (void)u; (void)b; }
+uint8_t uartRxRead(uartMap_t u) { (void)u; return 0; }
+uint8_t host_tx[4096];
+uint32_t host_tx_n;
+
+void uartTxWrite(uartMap_t u, uint8_t b)
+{
+    (void)u;
+    if (host_tx_n < sizeof(host_tx))
+        host_tx[host_tx_n++] = b;
+}
+bool_t uartRxReady(uartMap_t u) { (void)u; return FALSE; }
+bool_t uartTxReady(uartMap_t u) { (void)u; return TRUE; }
+void uartCallbackSet(uartMap_t u, uartEvents_t e, callBackFuncPtr_t f, void* p) { (void)u; (void)e; (void)f; (void)p; }
+void uartCallbackClr(uartMap_t u, uartEvents_t e) { (void)u; (void)e; }
+void uartInterrupt(uartMap_t u, bool_t e) { (void)u; (void)e; }
+void uartSetPendingInterrupt(uartMap_t u) { (void)u; }
+bool_t cyclesCounterInit(uint32_t f) { (void)f; return TRUE; }
+
+uint32_t cyclesCounterRead(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 204000000ULL + (uint64_t)ts.tv_nsec * 204ULL / 1000ULL);
+}
+
+/*==================[utilidades de las pruebas]==============================*/
+
+uint64_t host_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*==================[heap]===================================================*/
+
+/* Débiles, así las pruebas del heap los reemplazan por heap_4.c o heap_tlsf.c */
+__attribute__((weak)) void* pvPortMalloc(size_t n)
+{
+    return malloc(n);
+}
+
+__attribute__((weak)) void vPortFree(void* p)
+{
+    free(p);
+}
@@ -0,0 +1,25 @@
+/* sAPI para las pruebas en Linux */
+#ifndef HOST_SAPI_H
+#define HOST_SAPI_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "chip.h"
+typedef bool bool_t;
+#define TRUE    1
+#define FALSE   0
+typedef enum { UART_GPIO, UART_485, UART_USB, UART_ENET, UART_232 } uartMap_t;
+typedef enum { UART_RECEIVE, UART_TRANSMITER_FREE } uartEvents_t;
+typedef void (*callBackFuncPtr_t)(void*);
+void uartConfig(uartMap_t u, uint32_t b);
+uint8_t uartRxRead(uartMap_t u);
+void uartTxWrite(uartMap_t u, uint8_t b);
+bool_t uartRxReady(uartMap_t u);
+bool_t uartTxReady(uartMap_t u);
+void uartCallbackSet(uartMap_t u, uartEvents_t e, callBackFuncPtr_t f, void* p);
+void uartCallbackClr(uartMap_t u, uartEvents_t e);
+void uartInterrupt(uartMap_t u, bool_t e);
+void uartSetPendingInterrupt(uartMap_t u);
+void boardConfig(void);
+bool_t cyclesCounterInit(uint32_t f);
+uint32_t cyclesCounterRead(void);
+#endif
@@ -0,0 +1,18 @@
+#ifndef HOST_TASK_H
+#define HOST_TASK_H
+#include "FreeRTOS.h"
+#define tskIDLE_PRIORITY 0
+BaseType_t xTaskCreate(TaskFunction_t f, const char* n, uint16_t s, void* p, UBaseType_t pr, TaskHandle_t* h);
+TaskHandle_t xTaskCreateStatic(TaskFunction_t f, const char* n, uint32_t s, void* p, UBaseType_t pr, StackType_t* st, StaticTask_t* tb);
+void vTaskDelete(TaskHandle_t h);
+void vTaskStartScheduler(void);
+void vTaskDelay(TickType_t t);
+TickType_t xTaskGetTickCount(void);
+TickType_t xTaskGetTickCountFromISR(void);
+void vTaskSuspendAll(void);
+BaseType_t xTaskResumeAll(void);
+uint32_t ulTaskNotifyTake(BaseType_t c, TickType_t t);
+BaseType_t xTaskNotifyGive(TaskHandle_t h);
+void vTaskNotifyGiveFromISR(TaskHandle_t h, BaseType_t* w);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+#endif
@@ -0,0 +1,13 @@
+#ifndef HOST_TIMERS_H
+#define HOST_TIMERS_H
+#include "FreeRTOS.h"
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t);
+typedef void (*PendedFunction_t)(void*, uint32_t);
+TimerHandle_t xTimerCreate(const char* n, TickType_t p, UBaseType_t r, void* id, TimerCallbackFunction_t cb);
+TimerHandle_t xTimerCreateStatic(const char* n, TickType_t p, UBaseType_t r, void* id, TimerCallbackFunction_t cb, StaticTimer_t* s);
+BaseType_t xTimerStartFromISR(TimerHandle_t t, BaseType_t* w);
+BaseType_t xTimerStopFromISR(TimerHandle_t t, BaseType_t* w);
+BaseType_t xTimerStart(TimerHandle_t t, TickType_t x);
+void* pvTimerGetTimerID(TimerHandle_t t);
+BaseType_t xTimerPendFunctionCallFromISR(PendedFunction_t f, void* p, uint32_t v, BaseType_t* w);
+#endif
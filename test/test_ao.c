@@ -0,0 +1,131 @@
+/*
+ * Ciclo de vida de los objetos activos transitorios: un productor por objeto encola eventos numerados mientras la
+ * tarea termina con la cola vacía y se vuelve a crear, con host_ruido abriendo ventanas en cada operación de cola y
+ * compare-and-swap y con creaciones de tarea que fallan. Cada evento aceptado se procesa una vez y en orden, y
+ * nunca hay dos tareas del mismo objeto a la vez. "make mutaciones" la corre sin las reverificaciones de estado.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../src/AO.c"
+#include "host.h"
+
+#define OBJETOS         3
+#define RANURAS         64              // Eventos de cada productor en vuelo
+#define EVENTOS         4000            // Eventos por productor
+#define ESPERA_MAX_MS   2000            // Tiempo para que se procese un evento aceptado
+
+static activeObject_t objetos[OBJETOS];
+static tMensaje eventos[OBJETOS][RANURAS];
+static uint32_t volatile ocupada[OBJETOS][RANURAS];
+static uint32_t volatile en_callback[OBJETOS];
+static uint32_t siguiente[OBJETOS];
+static uint32_t aceptados[OBJETOS];
+static uint32_t volatile procesados[OBJETOS];
+static uint32_t rechazados[OBJETOS];
+static uint32_t volatile desordenados;
+static uint32_t volatile solapados;
+
+/* Lo que usa AO.c de objeto.c, los eventos de esta prueba no se comparten */
+void objeto_evento_retener(tMensaje* e) { (void)e; }
+bool objeto_evento_soltar(tMensaje* e) { (void)e; return false; }
+
+static void callback(void* caller_ao, void* dato)
+{
+    uint32_t k = (uint32_t)((activeObject_t*)caller_ao - objetos);
+    tMensaje* m = dato;
+    uint32_t numero = m->cantidad | ((uint32_t)m->referencias << 16);
+
+    if (__atomic_exchange_n(&en_callback[k], 1, __ATOMIC_SEQ_CST))
+        __atomic_add_fetch(&solapados, 1, __ATOMIC_SEQ_CST);
+    if (numero != siguiente[k])
+        __atomic_add_fetch(&desordenados, 1, __ATOMIC_SEQ_CST);
+    siguiente[k] = numero + 1;
+    host_ruido_meter();
+    __atomic_add_fetch(&procesados[k], 1, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&ocupada[k][m - eventos[k]], 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&en_callback[k], 0, __ATOMIC_SEQ_CST);
+}
+
+/* Con pausas al azar, a veces más largas que la vida de la tarea, para que los objetos terminen y se recreen */
+static void* productor(void* arg)
+{
+    uint32_t k = (uint32_t)(uintptr_t)arg;
+    uint32_t ranura = 0;
+    uint32_t numero = 0;
+
+    host_semilla(k + 1);
+    for (uint32_t i = 0; i < EVENTOS; i++)
+    {
+        tMensaje* m = &eventos[k][ranura];
+        uint32_t pausa = host_rand() % 64;
+
+        // La ranura se libera al procesar su evento anterior
+        uint64_t limite = host_ns() + ESPERA_MAX_MS * 1000000ULL;
+        while (__atomic_load_n(&ocupada[k][ranura], __ATOMIC_SEQ_CST))
+        {
+            VERIFICAR(host_ns() < limite, "objeto %u: el evento %u no se procesó", k, numero - RANURAS);
+            usleep(10);
+        }
+        m->cantidad = (uint16_t)numero;
+        m->referencias = (uint16_t)(numero >> 16);
+        ocupada[k][ranura] = 1;
+        if (activeObjectPost(&objetos[k], callback, activeObjectTask, NULL, m))
+        {
+            numero++;
+            aceptados[k]++;
+            ranura = (ranura + 1) % RANURAS;
+        }
+        else
+        {
+            ocupada[k][ranura] = 0;
+            rechazados[k]++;
+        }
+        if (pausa == 0)
+            usleep(2000);
+        else if (pausa < 8)
+            usleep(host_rand() % 400);
+        else if (pausa < 20)
+            sched_yield();
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    pthread_t hilos[OBJETOS];
+    uint64_t limite;
+    bool listo = false;
+
+    host_ruido = 1;
+    host_crear_falla_pct = 5;
+    for (uint32_t k = 0; k < OBJETOS; k++)
+        activeObjectInit(&objetos[k], false);
+    for (uint32_t k = 0; k < OBJETOS; k++)
+        pthread_create(&hilos[k], NULL, productor, (void*)(uintptr_t)k);
+    for (uint32_t k = 0; k < OBJETOS; k++)
+        pthread_join(hilos[k], NULL);
+
+    // Un evento que quedó en la cola de una tarea que ya terminó no se procesa nunca
+    limite = host_ns() + ESPERA_MAX_MS * 1000000ULL;
+    while (!listo && (host_ns() < limite))
+    {
+        listo = true;
+        for (uint32_t k = 0; k < OBJETOS; k++)
+            listo = listo && (procesados[k] == aceptados[k]);
+        usleep(1000);
+    }
+    for (uint32_t k = 0; k < OBJETOS; k++)
+    {
+        printf("objeto %u: %u aceptados, %u procesados, %u rechazados, %u creaciones\n", k, aceptados[k],
+               procesados[k], rechazados[k], (unsigned)objetos[k].creations);
+        VERIFICAR(procesados[k] == aceptados[k], "objeto %u: %u eventos aceptados sin procesar", k,
+                  aceptados[k] - procesados[k]);
+        VERIFICAR(objetos[k].creations > 1, "objeto %u: la tarea nunca terminó", k);
+    }
+    VERIFICAR(desordenados == 0, "%u eventos fuera de orden", desordenados);
+    VERIFICAR(solapados == 0, "%u callbacks de un mismo objeto al mismo tiempo", solapados);
+    return 0;
+}
@@ -0,0 +1,267 @@
+/*
+ * app_procesar contra el algoritmo original de cuatro pasadas (validar, inicializar la matriz de palabras, extraer
+ * las palabras y escribir el formato), sobre frames al azar de los tres formatos. Con "bench" mide además los dos.
+ * Además, que un OA de formato suelta la respuesta si la cola del OA_app está llena.
+ */
+#include "../src/app_callbacks.c"
+#include "host.h"
+
+/* Lo que usa app_callbacks.c de las otras capas, los OA_x no se ejecutan en esta prueba */
+tMensaje* sf_mensaje_escribible(sf_t* h, tMensaje* m) { (void)h; return m; }
+tMensaje* sf_mensaje_corto(sf_t* h, tMensaje* m) { (void)h; return m; }
+static uint32_t liberados;
+void objeto_evento_liberar(tMensaje* e) { (void)e; liberados++; }
+void sf_mensaje_procesado_encolar(sf_t* h, tMensaje* m) { (void)h; (void)m; }
+void sf_transmitir(sf_t* h) { (void)h; }
+bool sf_perfil_guardar(const sf_t* h) { (void)h; return false; }
+bool activeObjectPost(activeObject_t* ao, callBackActObj_t cb, TaskFunction_t t, QueueHandle_t q, tMensaje* e)
+{
+    (void)ao; (void)cb; (void)t; (void)q; (void)e;
+    return true;
+}
+uint8_t activeObjectPublish(aoPubSub_t* t, uint8_t o, tMensaje* e) { (void)t; (void)o; (void)e; return 0; }
+void activeObjectTask(void* p) { (void)p; }
+
+/*==================[algoritmo original]=====================================*/
+
+static bool ref_validar(const uint8_t* d, uint32_t cantidad)
+{
+    uint32_t palabra = PALABRA_INICIAL;
+    uint32_t caracter = CARACTER_INICIAL;
+
+    if ((d[cantidad - 1] == ' ') || (d[cantidad - 1] == '_'))                  // R_C3_9
+        return false;
+    for (uint32_t i = INDICE_CAMPO_DATOS; i < cantidad; i++)
+    {
+        if (('A' <= d[i]) && (d[i] <= 'Z'))
+        {
+            if (caracter != CARACTER_INICIAL)
+            {
+                if (caracter < CANT_LETRAS_MIN)
+                    return false;
+                palabra++;
+                caracter = CARACTER_INICIAL;
+            }
+            caracter++;
+        }
+        else if (('a' <= d[i]) && (d[i] <= 'z'))
+            caracter++;
+        else if ((d[i] == '_') || (d[i] == ' '))
+        {
+            if ((i + 1 < cantidad) && (d[i] == d[i + 1]))                       // R_C3_8
+                return false;
+            if (caracter != CARACTER_INICIAL)
+            {
+                if (caracter < CANT_LETRAS_MIN)
+                    return false;
+                palabra++;
+                caracter = CARACTER_INICIAL;
+            }
+        }
+        else
+            return false;
+        if ((caracter > CANT_LETRAS_MAX) || (palabra == CANT_PALABRAS_MAX))
+            return false;
+    }
+    return palabra >= CANT_PALABRAS_MIN - 1;
+}
+
+/* Devuelve el largo de la respuesta escrita en d, o 0 si es un error de datos */
+static uint32_t ref_procesar(uint8_t* d, uint32_t cantidad, uint8_t formato)
+{
+    uint8_t palabras[CANT_PALABRAS_MAX][CANT_LETRAS_MAX];
+    uint32_t palabra = PALABRA_INICIAL;
+    uint32_t caracter = CARACTER_INICIAL;
+    uint32_t n = INDICE_CAMPO_DATOS;
+
+    if (!ref_validar(d, cantidad))
+        return 0;
+    memset(palabras, 0, sizeof(palabras));
+    for (uint32_t i = INDICE_CAMPO_DATOS; i < cantidad; i++)
+    {
+        if (('A' <= d[i]) && (d[i] <= 'Z'))
+        {
+            if (caracter != CARACTER_INICIAL)
+            {
+                palabra++;
+                caracter = CARACTER_INICIAL;
+            }
+            palabras[palabra][caracter++] = d[i] + A_MINUSCULA;
+        }
+        else if (('a' <= d[i]) && (d[i] <= 'z'))
+            palabras[palabra][caracter++] = d[i];
+        else if (caracter != CARACTER_INICIAL)
+        {
+            palabra++;
+            caracter = CARACTER_INICIAL;
+        }
+    }
+    for (uint32_t i = 0; (i < CANT_PALABRAS_MAX) && (palabras[i][0] != 0); i++)
+    {
+        for (uint32_t j = 0; (j < CANT_LETRAS_MAX) && (palabras[i][j] != 0); j++)
+        {
+            uint8_t c = palabras[i][j];
+
+            if ((j == 0) && ((formato == 'P') || ((formato == 'C') && (i > 0))))
+                c += A_MAYUSCULA;
+            if ((j == 0) && (i > 0) && (formato == 'S'))
+            {
+                d[n++] = '_';
+                if (n >= MSG_MAX_SIZE - LEN_HEADER_COMPLETO)
+                    return 0;
+            }
+            d[n++] = c;
+            if ((formato == 'S') && (n >= MSG_MAX_SIZE - LEN_HEADER_COMPLETO))
+                return 0;
+        }
+    }
+    return n;
+}
+
+/*==================[frames al azar]=========================================*/
+
+/* Arma un payload que casi siempre es válido, con mezclas de separadores, mayúsculas y palabras largas */
+static uint32_t frame_azar(uint8_t* d, uint8_t formato, uint32_t largo_max)
+{
+    static const char letras[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    uint32_t n = INDICE_CAMPO_DATOS;
+    uint32_t palabras = 1 + host_rand() % ((host_rand() % 8 == 0) ? CANT_PALABRAS_MAX + 1 : CANT_PALABRAS_MAX);
+
+    d[0] = formato;
+    if (host_rand() % 8 == 0)
+        d[n++] = (host_rand() & 1) ? '_' : ' ';
+    for (uint32_t p = 0; (p < palabras) && (n + 12 < largo_max); p++)
+    {
+        uint32_t letras_n = 1 + host_rand() % ((host_rand() % 8 == 0) ? CANT_LETRAS_MAX + 1 : CANT_LETRAS_MAX);
+
+        for (uint32_t k = 0; k < letras_n; k++)
+        {
+            uint32_t r = host_rand() % 512;
+
+            d[n++] = (r < 460) ? letras[r % 26] : (r < 511) ? letras[26 + r % 26] : (uint8_t)(host_rand() % 128);
+        }
+        switch (host_rand() % 8)
+        {
+        case 0: break;                                  // Sigue con mayúscula o se pega a la siguiente
+        case 1: d[n++] = '_'; d[n++] = ' '; break;      // Separadores distintos seguidos son válidos
+        case 2: d[n++] = ' '; d[n++] = ' '; break;      // R_C3_8
+        case 3: case 4: d[n++] = '_'; break;
+        default: d[n++] = ' '; break;
+        }
+    }
+    if ((host_rand() % 4 != 0) && (n > INDICE_CAMPO_DATOS) && ((d[n - 1] == '_') || (d[n - 1] == ' ')))
+        n--;
+    return n;
+}
+
+static void probar(uint32_t vueltas)
+{
+    static const uint8_t formatos[] = { 'C', 'P', 'S' };
+    uint8_t a[MSG_MAX_SIZE], b[MSG_MAX_SIZE];
+    uint32_t validos = 0;
+
+    for (uint32_t v = 0; v < vueltas; v++)
+    {
+        uint8_t formato = formatos[v % 3];
+        uint32_t n = frame_azar(a, formato, MSG_MAX_SIZE - LEN_HEADER);
+        tMensaje m = { .ptr_datos = b, .cantidad = n };
+        uint32_t esperado;
+        bool valido;
+
+        memcpy(b, a, n);
+        VERIFICAR(app_procesar(&m, APP_SOLO_VALIDAR) == ref_validar(a, n), "validar \"%.*s\"", (int)n, a);
+        VERIFICAR(memcmp(a, b, n) == 0, "validar modificó \"%.*s\"", (int)n, a);
+        valido = app_procesar(&m, formato);
+        esperado = ref_procesar(a, n, formato);
+        VERIFICAR(valido == (esperado != 0), "%c \"%.*s\"", formato, (int)n, b);
+        if (valido)
+        {
+            VERIFICAR((m.cantidad == esperado) && (memcmp(a, b, esperado) == 0), "%c: \"%.*s\" en lugar de \"%.*s\"",
+                      formato, (int)m.cantidad, b, (int)esperado, a);
+            validos++;
+        }
+    }
+    printf("app_procesar: %u frames iguales al algoritmo original, %u válidos\n", vueltas, validos);
+}
+
+/* La respuesta de un OA de formato con la cola del OA_app llena se suelta, no se pierde */
+static void probar_cola_llena(void)
+{
+    uint8_t d[] = "Choladel mundo";
+    tMensaje m = { .ptr_datos = d, .cantidad = sizeof(d) - 1 };
+    tMensaje* otro = &m;
+    tMensaje* recibido;
+    activeObject_t oa = { .responseQueue = xQueueCreate(1, sizeof(tMensaje*)) };
+
+    liberados = 0;
+    app_OAC(&oa, &m);
+    VERIFICAR((liberados == 0) && (xQueueReceive(oa.responseQueue, &recibido, 0) == pdPASS) && (recibido == &m) &&
+              (m.evento_tipo == RESPUESTA), "con lugar en la cola la respuesta tiene que llegar al OA_app");
+    xQueueSend(oa.responseQueue, &otro, 0);
+    app_OAC(&oa, &m);
+    VERIFICAR(liberados == 1, "con la cola llena la respuesta no se soltó");
+    VERIFICAR(uxQueueMessagesWaiting(oa.responseQueue) == 1, "la cola llena cambió");
+    printf("cola del OA_app llena: la respuesta se suelta\n");
+}
+
+/* Tiempo por frame de validar y convertir, el mínimo de varias rondas alternadas para sacar el ruido del host */
+static double medir_uno(const char* frase, uint8_t formato, uint32_t alg)
+{
+    uint8_t d[MSG_MAX_SIZE];
+    uint32_t largo = (uint32_t)strlen(frase) + 1;
+    const uint32_t N = 20000;
+    uint64_t t0 = host_ns();
+
+    for (uint32_t i = 0; i < N; i++)
+    {
+        tMensaje m = { .ptr_datos = d, .cantidad = largo };
+
+        d[0] = formato;
+        memcpy(d + 1, frase, largo - 1);
+        __asm__ volatile("" ::: "memory");
+        if (alg == 0)
+            (void)(ref_validar(d, largo) && ref_procesar(d, largo, formato));
+        else
+            (void)(app_procesar(&m, APP_SOLO_VALIDAR) && app_procesar(&m, formato));
+        __asm__ volatile("" ::: "memory");
+    }
+    return (double)(host_ns() - t0) / N;
+}
+
+static void medir(void)
+{
+    static const char* const frases[] = {
+        "helloWorld", "hola mundo lindo", "unaFraseBastanteLargaConMuchas palabras_para medir",
+        "abcdefghij klmnopqrst uvwxyzabcd efghijklmn opqrstuvwx yzabcdefgh ijklmnopqr stuvwxyzab cdefghijkl "
+        "mnopqrstuv wxyzabcdef ghijklmnop" };
+
+    for (uint32_t k = 0; k < sizeof(frases) / sizeof(frases[0]); k++)
+    {
+        for (uint32_t f = 0; f < 3; f++)
+        {
+            double ns[2] = { 1e9, 1e9 };
+
+            for (uint32_t ronda = 0; ronda < 30; ronda++)
+            {
+                for (uint32_t alg = 0; alg < 2; alg++)
+                {
+                    double t = medir_uno(frases[k], "CPS"[f], alg);
+
+                    if (t < ns[alg])
+                        ns[alg] = t;
+                }
+            }
+            printf("largo %3u %c: original %6.1f ns, una pasada %6.1f ns\n", (unsigned)strlen(frases[k]) + 1,
+                   "CPS"[f], ns[0], ns[1]);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    probar(((argc > 1) && (strcmp(argv[1], "bench") == 0)) ? 100000 : 2000000);
+    probar_cola_llena();
+    if ((argc > 1) && (strcmp(argv[1], "bench") == 0))
+        medir();
+    return 0;
+}
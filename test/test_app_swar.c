@@ -0,0 +1,109 @@
+/*
+ * app_swar_rango contra la comparación byte a byte: todos los rangos con todos los valores de cada byte, y para los
+ * rangos de letras todos los pares de bytes vecinos, donde un acarreo podría pasar de un byte al siguiente. La
+ * variante _simd prueba el camino del Cortex-M4 con __USUB8 y __SEL emulados en host/chip.h. Con "bench" mide el
+ * control de 4 minúsculas de app_procesar contra las 4 comparaciones, sólo en el camino portable.
+ */
+#include <string.h>
+#include "app_clasificar.h"
+#include "host.h"
+
+#if APP_SWAR_SIMD
+#define CAMINO  "SIMD"
+#else
+#define CAMINO  "portable"
+#endif
+
+static uint32_t ref_rango(uint32_t w, uint8_t min, uint8_t max)
+{
+    uint32_t r = 0;
+
+    for (int i = 0; i < APP_SWAR_BYTES; i++)
+    {
+        uint8_t c = (uint8_t)(w >> (8 * i));
+        if ((min <= c) && (c <= max))
+            r |= 0x80U << (8 * i);
+    }
+    return r;
+}
+
+static void verificar(uint32_t w, uint8_t min, uint8_t max)
+{
+    uint32_t r = app_swar_rango(w, min, max);
+    VERIFICAR(r == ref_rango(w, min, max), "w %08x rango %02x-%02x: %08x", w, min, max, r);
+}
+
+static void probar(void)
+{
+    static const uint8_t letras[][2] = { { 'a', 'z' }, { 'A', 'Z' }, { '0', '9' } };
+    uint64_t casos = 0;
+
+    // Cada byte con todos sus valores y los otros al azar, para todos los rangos
+    for (uint32_t min = 0; min < 0x80; min++)
+        for (uint32_t max = min; max < 0x80; max++)
+            for (uint32_t b = 0; b < APP_SWAR_BYTES; b++)
+                for (uint32_t v = 0; v < 256; v++, casos++)
+                    verificar((host_rand() & ~(0xFFU << (8 * b))) | (v << (8 * b)), min, max);
+    // Los pares de bytes vecinos con todas las combinaciones
+    for (uint32_t k = 0; k < sizeof(letras) / sizeof(letras[0]); k++)
+        for (uint32_t b = 0; b + 1 < APP_SWAR_BYTES; b++)
+            for (uint32_t v = 0; v < 0x10000; v++, casos++)
+                verificar((host_rand() & ~(0xFFFFU << (8 * b))) | (v << (8 * b)), letras[k][0], letras[k][1]);
+    printf("app_swar_rango %s: %llu casos iguales a la comparación byte a byte\n", CAMINO, (unsigned long long)casos);
+}
+
+/* ns por cada 4 bytes de texto, el mínimo de varias rondas alternadas */
+static void medir(void)
+{
+    uint8_t texto[4096];
+    volatile uint32_t sumidero;
+    const uint32_t N = 200;
+    double ns[2] = { 1e9, 1e9 };
+
+    for (uint32_t i = 0; i < sizeof(texto); i++)
+        texto[i] = (host_rand() % 16 == 0) ? 'A' + host_rand() % 26 : 'a' + host_rand() % 26;
+    for (uint32_t ronda = 0; ronda < 30; ronda++)
+    {
+        for (uint32_t alg = 0; alg < 2; alg++)
+        {
+            uint64_t t0 = host_ns();
+            uint32_t cuenta = 0;
+
+            for (uint32_t n = 0; n < N; n++)
+            {
+                __asm__ volatile("" ::: "memory");
+                for (uint32_t i = 0; i < sizeof(texto); i += APP_SWAR_BYTES)
+                {
+                    if (alg == 0)
+                    {
+                        uint32_t j;
+                        for (j = 0; j < APP_SWAR_BYTES; j++)
+                            if ((texto[i + j] < 'a') || (texto[i + j] > 'z'))
+                                break;
+                        cuenta += (j == APP_SWAR_BYTES);
+                    }
+                    else
+                    {
+                        uint32_t w;
+                        memcpy(&w, &texto[i], APP_SWAR_BYTES);
+                        cuenta += (app_swar_rango(w, 'a', 'z') == APP_SWAR_BIT7);
+                    }
+                }
+            }
+            sumidero = cuenta;
+            double t = (double)(host_ns() - t0) / (N * sizeof(texto) / APP_SWAR_BYTES);
+            if (t < ns[alg])
+                ns[alg] = t;
+        }
+    }
+    (void)sumidero;
+    printf("4 minúsculas: byte a byte %.2f ns, app_swar_rango %s %.2f ns\n", ns[0], CAMINO, ns[1]);
+}
+
+int main(int argc, char** argv)
+{
+    probar();
+    if ((argc > 1) && (strcmp(argv[1], "bench") == 0) && !APP_SWAR_SIMD)
+        medir();
+    return 0;
+}
@@ -0,0 +1,329 @@
+/*
+ * Arena circular de recepción sola, sin el separador de frames. Primero casos armados a mano: la vuelta con los
+ * bytes ya recibidos, la arena llena con la cabeza detrás del frame más viejo, la liberación fuera de orden y el
+ * límite de ARENA_FRAMES_MAX. Después millones de operaciones al azar como las hace el separador, contra un modelo:
+ * los frames vivos y el que se recibe nunca se superponen, no se pisan sus bytes y las estadísticas coinciden.
+ */
+#include "../src/arena_rx.c"
+#include "host.h"
+#include <string.h>
+
+#define TAM_ARENA       2000
+#define OPERACIONES     2000000
+
+static uint8_t memoria[TAM_ARENA];
+static arena_t arena;
+
+/* Frame entregado según el modelo, del más viejo al más nuevo */
+typedef struct
+{
+    uint32_t inicio;
+    uint32_t tam;
+    uint8_t marca;
+    bool liberado;
+} vivo_t;
+
+static vivo_t vivos[ARENA_FRAMES_MAX];
+static uint32_t cant_vivos;
+static uint32_t cabeza;
+static arena_estadisticas_t esperadas;
+
+/* Frame en recepción */
+static bool en_rx;
+static uint32_t rx_inicio;
+static uint32_t rx_cantidad;
+static uint32_t rx_asegurado;
+static uint8_t rx_marca;
+
+static void escribir(uint32_t inicio, uint32_t desde, uint32_t hasta, uint8_t marca)
+{
+    for (uint32_t i = desde; i < hasta; i++)
+        memoria[inicio + i] = (uint8_t)(marca + i);
+}
+
+static void comprobar(uint32_t inicio, uint32_t cantidad, uint8_t marca, const char* que)
+{
+    for (uint32_t i = 0; i < cantidad; i++)
+        VERIFICAR(memoria[inicio + i] == (uint8_t)(marca + i), "%s en %u: byte %u pisado", que, inicio, i);
+}
+
+/* Lugar que tiene que encontrar arena_frame_asegurar: 1 en la cabeza, 0 dando la vuelta, -1 ninguno */
+static int lugar_esperado(uint32_t minimo)
+{
+    bool atras = (cant_vivos > 0) && (cabeza <= vivos[0].inicio);
+    uint32_t disponible = atras ? vivos[0].inicio - cabeza : TAM_ARENA - cabeza;
+
+    if (disponible >= minimo)
+        return 1;
+    if (atras || (((cant_vivos == 0) ? TAM_ARENA : vivos[0].inicio) < minimo))
+        return -1;
+    return 0;
+}
+
+static void verificar_estado(void)
+{
+    arena_estadisticas_t* e = &arena.estadisticas;
+    uint32_t ini[ARENA_FRAMES_MAX + 1];
+    uint32_t fin[ARENA_FRAMES_MAX + 1];
+    uint32_t n = 0;
+
+    VERIFICAR((arena.cant_frames == cant_vivos) && (arena.cabeza == cabeza), "frames %u de %u, cabeza %u de %u",
+              arena.cant_frames, cant_vivos, arena.cabeza, cabeza);
+    VERIFICAR((e->ocupados == esperadas.ocupados) && (e->ocupados_max == esperadas.ocupados_max),
+              "ocupados %u de %u, máximo %u de %u", e->ocupados, esperadas.ocupados, e->ocupados_max,
+              esperadas.ocupados_max);
+    VERIFICAR((e->vueltas == esperadas.vueltas) && (e->bytes_movidos == esperadas.bytes_movidos),
+              "vueltas %u de %u, bytes movidos %u de %u", e->vueltas, esperadas.vueltas, e->bytes_movidos,
+              esperadas.bytes_movidos);
+    VERIFICAR(e->fuera_de_orden == esperadas.fuera_de_orden, "fuera de orden %u de %u", e->fuera_de_orden,
+              esperadas.fuera_de_orden);
+    VERIFICAR(e->sin_lugar == esperadas.sin_lugar, "sin lugar %u de %u", e->sin_lugar, esperadas.sin_lugar);
+
+    // Los frames entregados, también los liberados que todavía reservan su lugar, y el que se recibe no se superponen
+    for (uint32_t i = 0; i < cant_vivos; i++)
+    {
+        ini[n] = vivos[i].inicio;
+        fin[n++] = vivos[i].inicio + vivos[i].tam;
+    }
+    if (en_rx)
+    {
+        ini[n] = rx_inicio;
+        fin[n++] = rx_inicio + rx_asegurado;
+    }
+    for (uint32_t i = 0; i < n; i++)
+    {
+        VERIFICAR(fin[i] <= TAM_ARENA, "frame [%u, %u) fuera de la arena", ini[i], fin[i]);
+        for (uint32_t j = i + 1; j < n; j++)
+            VERIFICAR((fin[i] <= ini[j]) || (fin[j] <= ini[i]), "frames [%u, %u) y [%u, %u) superpuestos",
+                      ini[i], fin[i], ini[j], fin[j]);
+    }
+}
+
+static bool iniciar(uint32_t minimo)
+{
+    uint8_t* p;
+    int lugar;
+
+    if (cant_vivos == 0)
+        cabeza = 0;
+    lugar = (cant_vivos == ARENA_FRAMES_MAX) ? -1 : lugar_esperado(minimo);
+    p = arena_frame_iniciar(&arena, minimo);
+    if (lugar < 0)
+    {
+        VERIFICAR(p == NULL, "iniciar %u: tenía que faltar lugar", minimo);
+        esperadas.sin_lugar++;
+        return false;
+    }
+    if (lugar == 0)
+    {
+        cabeza = 0;
+        esperadas.vueltas++;
+    }
+    VERIFICAR(p == memoria + cabeza, "iniciar %u: en %td en lugar de %u", minimo, p - memoria, cabeza);
+    en_rx = true;
+    rx_inicio = cabeza;
+    rx_cantidad = 0;
+    rx_asegurado = minimo;
+    rx_marca = (uint8_t)host_rand();
+    return true;
+}
+
+/* Recibe bytes en el frame en curso, asegurando más lugar como el separador al llegar al límite */
+static bool recibir(uint32_t bytes, uint32_t extra)
+{
+    if (rx_cantidad + bytes > rx_asegurado)
+    {
+        uint32_t minimo = rx_cantidad + bytes + extra;
+        int lugar = lugar_esperado(minimo);
+        uint8_t* p = arena_frame_asegurar(&arena, rx_cantidad, minimo);
+
+        if (lugar < 0)
+        {
+            VERIFICAR(p == NULL, "asegurar %u: tenía que faltar lugar", minimo);
+            esperadas.sin_lugar++;
+            en_rx = false;          // El separador descarta el frame y el próximo empieza en la misma cabeza
+            return false;
+        }
+        if (lugar == 0)
+        {
+            cabeza = 0;
+            esperadas.vueltas++;
+            esperadas.bytes_movidos += rx_cantidad;
+        }
+        VERIFICAR(p == memoria + cabeza, "asegurar %u: en %td en lugar de %u", minimo, p - memoria, cabeza);
+        rx_inicio = cabeza;
+        rx_asegurado = minimo;
+        comprobar(rx_inicio, rx_cantidad, rx_marca, "frame movido");
+    }
+    escribir(rx_inicio, rx_cantidad, rx_cantidad + bytes, rx_marca);
+    rx_cantidad += bytes;
+    return true;
+}
+
+static void cerrar(uint32_t tam)
+{
+    VERIFICAR(en_rx && (tam >= rx_cantidad) && (tam <= rx_asegurado), "cerrar %u", tam);
+    arena_frame_cerrar(&arena, tam);
+    escribir(rx_inicio, rx_cantidad, tam, rx_marca);
+    vivos[cant_vivos++] = (vivo_t){ rx_inicio, tam, rx_marca, false };
+    cabeza = rx_inicio + tam;
+    esperadas.ocupados += tam;
+    if (esperadas.ocupados > esperadas.ocupados_max)
+        esperadas.ocupados_max = esperadas.ocupados;
+    en_rx = false;
+}
+
+static void liberar(uint32_t i)
+{
+    uint32_t libres = 0;
+
+    VERIFICAR((i < cant_vivos) && !vivos[i].liberado, "liberar %u", i);
+    comprobar(vivos[i].inicio, vivos[i].tam, vivos[i].marca, "frame liberado");
+    arena_frame_liberar(&arena, memoria + vivos[i].inicio);
+    vivos[i].liberado = true;
+    if (i > 0)
+        esperadas.fuera_de_orden++;
+    while ((libres < cant_vivos) && vivos[libres].liberado)
+        esperadas.ocupados -= vivos[libres++].tam;
+    memmove(vivos, vivos + libres, (cant_vivos - libres) * sizeof(vivo_t));
+    cant_vivos -= libres;
+}
+
+/* i-ésimo frame entregado todavía sin liberar */
+static uint32_t sin_liberar(uint32_t n)
+{
+    for (uint32_t i = 0; i < cant_vivos; i++)
+        if (!vivos[i].liberado && (n-- == 0))
+            return i;
+    return cant_vivos;
+}
+
+static uint32_t cant_sin_liberar(void)
+{
+    uint32_t n = 0;
+
+    for (uint32_t i = 0; i < cant_vivos; i++)
+        n += !vivos[i].liberado;
+    return n;
+}
+
+static void reiniciar(void)
+{
+    VERIFICAR(arena_init(&arena, memoria, sizeof(memoria)), "arena_init");
+    memset(&esperadas, 0, sizeof(esperadas));
+    cant_vivos = 0;
+    cabeza = 0;
+    en_rx = false;
+}
+
+static void casos(void)
+{
+    uint32_t ocupados;
+
+    VERIFICAR(!arena_init(&arena, memoria, 0) && !arena_init(&arena, NULL, 100) &&
+              !arena_init(&arena, memoria, UINT16_MAX + 1U), "arena_init con parámetros inválidos");
+
+    /* Vacía: el frame empieza al principio aunque la cabeza haya quedado más adelante */
+    reiniciar();
+    VERIFICAR(iniciar(100) && recibir(50, 0), "primer frame");
+    cerrar(60);
+    liberar(0);
+    VERIFICAR(iniciar(100) && (rx_inicio == 0), "con la arena vacía el frame empieza en %u", rx_inicio);
+    en_rx = false;
+    verificar_estado();
+
+    /* La vuelta: el frame no entra al final, el principio está libre y los bytes recibidos se mueven */
+    reiniciar();
+    for (uint32_t i = 0; i < 9; i++)
+    {
+        VERIFICAR(iniciar(200) && recibir(200, 0), "frame %u", i);
+        cerrar(200);
+    }
+    liberar(0);
+    liberar(0);
+    VERIFICAR(iniciar(100) && recibir(100, 0) && (rx_inicio == 1800), "frame al final en %u", rx_inicio);
+    VERIFICAR(recibir(150, 0) && (rx_inicio == 0), "el frame no dio la vuelta");
+    VERIFICAR((arena.estadisticas.vueltas == 1) && (arena.estadisticas.bytes_movidos == 100), "vueltas %u, bytes %u",
+              arena.estadisticas.vueltas, arena.estadisticas.bytes_movidos);
+    cerrar(250);
+    verificar_estado();
+
+    /* Llena: la cabeza quedó justo en el frame más viejo, detrás de él no hay lugar ni se puede dar la vuelta */
+    VERIFICAR(iniciar(150) && recibir(150, 0), "frame hasta el más viejo");
+    cerrar(150);
+    VERIFICAR((arena.cabeza == vivos[0].inicio) && (arena_disponible(&arena) == 0), "cabeza %u, disponible %u",
+              arena.cabeza, arena_disponible(&arena));
+    VERIFICAR(!iniciar(1), "con la arena llena tenía que faltar lugar");
+    VERIFICAR(arena.estadisticas.sin_lugar == 1, "sin lugar %u", arena.estadisticas.sin_lugar);
+    verificar_estado();
+
+    /* Fuera de orden: liberar los nuevos no devuelve lugar hasta que se libera el más viejo */
+    ocupados = arena.estadisticas.ocupados;
+    while (cant_sin_liberar() > 1)
+        liberar(sin_liberar(1));
+    VERIFICAR(arena.estadisticas.ocupados == ocupados, "se recuperó lugar antes de liberar el más viejo");
+    VERIFICAR(!iniciar(1), "sin liberar el más viejo no hay lugar");
+    VERIFICAR(arena.estadisticas.fuera_de_orden == 8, "fuera de orden %u", arena.estadisticas.fuera_de_orden);
+    liberar(0);
+    VERIFICAR((arena.cant_frames == 0) && (arena.estadisticas.ocupados == 0), "frames %u, ocupados %u",
+              arena.cant_frames, arena.estadisticas.ocupados);
+    verificar_estado();
+
+    /* Con ARENA_FRAMES_MAX frames entregados no entra otro aunque sobre lugar */
+    reiniciar();
+    for (uint32_t i = 0; i < ARENA_FRAMES_MAX; i++)
+    {
+        VERIFICAR(iniciar(10) && recibir(10, 0), "frame %u", i);
+        cerrar(10);
+    }
+    VERIFICAR(!iniciar(10) && (arena.estadisticas.sin_lugar == 1), "frame de más");
+    liberar(0);
+    VERIFICAR(iniciar(10), "al liberar uno vuelve a haber lugar");
+    verificar_estado();
+    printf("casos armados: vuelta, arena llena, fuera de orden y límite de frames\n");
+}
+
+/* Operaciones al azar: frames de largo parecido a los de la UART, abandonados a veces por timeout, y liberados casi
+   siempre en orden pero a veces fuera de él, como los objetos C, P y S. Se alternan tramos en los que la aplicación
+   libera al ritmo en que llegan los frames y tramos en los que se atrasa y la arena se llena. */
+static void azar(void)
+{
+    uint32_t r;
+
+    reiniciar();
+    host_semilla(7);
+    for (uint32_t op = 0; op < OPERACIONES; op++)
+    {
+        r = host_rand() % 100;
+        if (!en_rx && (r < 40))
+            (void)iniciar(24 + host_rand() % 40);
+        else if (en_rx && (r < 60))
+            (void)recibir(1 + host_rand() % 40, host_rand() % 32);
+        else if (en_rx && (rx_cantidad > 0) && (r < 75))
+            cerrar(rx_cantidad + host_rand() % (rx_asegurado - rx_cantidad + 1));
+        else if (en_rx && (r < 76))
+            en_rx = false;
+        else if ((cant_sin_liberar() > 0) && (!((op / 20000) % 2) || (host_rand() % 4 == 0)))
+        {
+            uint32_t n = cant_sin_liberar();
+            liberar(sin_liberar((host_rand() % 4 == 0) ? host_rand() % n : 0));
+        }
+        verificar_estado();
+        if (op % 4096 == 0)
+            for (uint32_t i = 0; i < cant_vivos; i++)
+                if (!vivos[i].liberado)
+                    comprobar(vivos[i].inicio, vivos[i].tam, vivos[i].marca, "frame vivo");
+    }
+    printf("%u operaciones: %u vueltas (%u bytes movidos), %u fuera de orden, %u sin lugar, máximo %u de %u bytes\n",
+           OPERACIONES, arena.estadisticas.vueltas, arena.estadisticas.bytes_movidos,
+           arena.estadisticas.fuera_de_orden, arena.estadisticas.sin_lugar, arena.estadisticas.ocupados_max, TAM_ARENA);
+    VERIFICAR((arena.estadisticas.vueltas > 1000) && (arena.estadisticas.fuera_de_orden > 1000) &&
+              (arena.estadisticas.sin_lugar > 1000), "el azar no pasó por todos los casos");
+}
+
+int main(void)
+{
+    casos();
+    azar();
+    return 0;
+}
@@ -0,0 +1,190 @@
+/*
+ * heap_tlsf.c contra un modelo de heap_4.c (host/heap_4_modelo.c) con el mismo configTOTAL_HEAP_SIZE: integridad de
+ * los bloques con pedidos y liberaciones al azar, y la secuencia de pedidos de los objetos activos que se crean y se
+ * destruyen, con y sin pedidos sueltos que fragmentan el heap. Con "bench" mide además el tiempo por operación.
+ */
+#define USE_HEAP_TLSF
+#include "../src/heap_tlsf.c"
+#include "heap_4_modelo.c"
+#include <string.h>
+#include "host.h"
+
+/* Tamaños del Cortex-M4: Queue_t con N_QUEUE_AO punteros, la pila mínima en palabras y el TCB */
+#define TAM_COLA        (80 + 10 * 4)
+#define TAM_PILA        (configMINIMAL_STACK_SIZE * 4)
+#define TAM_TCB         92
+#define OBJETOS         3       // OA_C, OA_P y OA_S
+#define SUELTOS         64
+#define SUELTOS_MAX     24
+
+typedef struct
+{
+    const char* nombre;
+    void* (*pedir)(size_t);
+    void (*liberar)(void*);
+    size_t (*libres)(void);
+} heap_t;
+
+static const heap_t heaps[] =
+{
+    { "heap_4", heap4_pvPortMalloc, heap4_vPortFree, heap4_xPortGetFreeHeapSize },
+    { "tlsf",   pvPortMalloc,       vPortFree,       xPortGetFreeHeapSize },
+};
+
+
+static void probar_integridad(const heap_t* h)
+{
+    enum { N = 200 };
+    static void* p[N];
+    static size_t tam[N];
+    size_t inicial;
+    uint32_t fallas = 0;
+    void* grande;
+
+    h->liberar(h->pedir(1));        // Como en FreeRTOS, el heap se arma en el primer pedido
+    inicial = h->libres();
+    host_semilla(1);
+    for (uint32_t vuelta = 0; vuelta < 1000000; vuelta++)
+    {
+        uint32_t i = host_rand() % N;
+        if (p[i] != NULL)
+        {
+            for (size_t k = 0; k < tam[i]; k++)
+                VERIFICAR(((uint8_t*)p[i])[k] == (uint8_t)(i + k), "%s: bloque %u pisado", h->nombre, i);
+            h->liberar(p[i]);
+            p[i] = NULL;
+            continue;
+        }
+        tam[i] = 1 + host_rand() % ((host_rand() % 7 == 0) ? 1500 : 100);
+        p[i] = h->pedir(tam[i]);
+        if (p[i] == NULL)
+        {
+            fallas++;
+            continue;
+        }
+        VERIFICAR(((uintptr_t)p[i] & portBYTE_ALIGNMENT_MASK) == 0, "%s: %p sin alinear", h->nombre, p[i]);
+        for (size_t k = 0; k < tam[i]; k++)
+            ((uint8_t*)p[i])[k] = (uint8_t)(i + k);
+    }
+    for (uint32_t i = 0; i < N; i++)
+    {
+        h->liberar(p[i]);
+        p[i] = NULL;
+    }
+    // Todo volvió y quedó unido en un solo bloque
+    VERIFICAR(h->libres() == inicial, "%s: %zu bytes libres de %zu", h->nombre, h->libres(), inicial);
+    grande = h->pedir(inicial - 64);
+    VERIFICAR(grande != NULL, "%s: no se unieron los bloques libres", h->nombre);
+    h->liberar(grande);
+    printf("%s: 1000000 pedidos y liberaciones sin bloques pisados, %u sin lugar\n", h->nombre, fallas);
+}
+
+/* Los objetos activos transitorios se crean (cola, pila y TCB) y se destruyen al azar, con la memoria del arranque
+   tomada antes; con fragmentar, pedidos sueltos de largo variable quedan un rato entre medio */
+static uint32_t reproducir(const heap_t* h, uint32_t pasos, bool fragmentar)
+{
+    struct { void* cola; void* pila; void* tcb; bool vivo; } objetos[OBJETOS] = { 0 };
+    void* sueltos[SUELTOS] = { 0 };
+    void* arranque[4];
+    uint32_t n_sueltos = 0;
+    uint32_t fallas = 0;
+
+    host_semilla(7);
+    arranque[0] = h->pedir(600);                // sf_t
+    arranque[1] = h->pedir(80 + 32 * 12);       // Colas de objeto
+    arranque[2] = h->pedir(80 + 32 * 12);
+    arranque[3] = h->pedir(2000);               // Pool de separacion_frames
+    for (uint32_t i = 0; i < pasos; i++)
+    {
+        uint32_t k = host_rand() % OBJETOS;
+        if (!objetos[k].vivo)
+        {
+            objetos[k].cola = h->pedir(TAM_COLA);
+            objetos[k].pila = h->pedir(TAM_PILA);
+            objetos[k].tcb = h->pedir(TAM_TCB);
+            fallas += (objetos[k].cola == NULL) + (objetos[k].pila == NULL) + (objetos[k].tcb == NULL);
+            objetos[k].vivo = true;
+        }
+        else if (host_rand() % 2)
+        {
+            h->liberar(objetos[k].cola);
+            h->liberar(objetos[k].pila);
+            h->liberar(objetos[k].tcb);
+            objetos[k].vivo = false;
+        }
+        if (fragmentar && (host_rand() % 4 == 0))
+        {
+            uint32_t j = host_rand() % SUELTOS;
+            if (sueltos[j] != NULL)
+            {
+                h->liberar(sueltos[j]);
+                sueltos[j] = NULL;
+                n_sueltos--;
+            }
+            else if (n_sueltos < SUELTOS_MAX)
+            {
+                sueltos[j] = h->pedir(8 + host_rand() % 120);
+                if (sueltos[j] != NULL)
+                    n_sueltos++;
+                else
+                    fallas++;
+            }
+        }
+    }
+    // Se devuelve todo para la próxima pasada
+    for (uint32_t k = 0; k < OBJETOS; k++)
+    {
+        if (objetos[k].vivo)
+        {
+            h->liberar(objetos[k].cola);
+            h->liberar(objetos[k].pila);
+            h->liberar(objetos[k].tcb);
+        }
+    }
+    for (uint32_t j = 0; j < SUELTOS; j++)
+        h->liberar(sueltos[j]);
+    for (uint32_t i = 0; i < 4; i++)
+        h->liberar(arranque[i]);
+    return fallas;
+}
+
+int main(int argc, char** argv)
+{
+    bool bench = (argc > 1) && (strcmp(argv[1], "bench") == 0);
+    const uint32_t pasos = 200000;
+
+    for (uint32_t k = 0; k < 2; k++)
+        probar_integridad(&heaps[k]);
+    for (uint32_t fragmentar = 0; fragmentar < 2; fragmentar++)
+    {
+        uint32_t fallas[2];
+
+        for (uint32_t k = 0; k < 2; k++)
+        {
+            size_t inicial = heaps[k].libres();
+            heap4_nodos_max = 0;
+            fallas[k] = reproducir(&heaps[k], pasos, fragmentar);
+            VERIFICAR(heaps[k].libres() == inicial, "%s: pérdida de memoria", heaps[k].nombre);
+            printf("objetos activos%s, %s: %u pedidos sin lugar", fragmentar ? " con pedidos sueltos" : "",
+                   heaps[k].nombre, fallas[k]);
+            if (k == 0)
+                printf(", hasta %u nodos recorridos por operación", heap4_nodos_max);
+            if (bench)
+            {
+                // La misma secuencia otra vez, el mínimo de varias rondas
+                double ns = 1e18;
+                for (uint32_t ronda = 0; ronda < 10; ronda++)
+                {
+                    uint64_t t0 = host_ns();
+                    (void)reproducir(&heaps[k], pasos, fragmentar);
+                    if ((double)(host_ns() - t0) / pasos < ns)
+                        ns = (double)(host_ns() - t0) / pasos;
+                }
+                printf(", %.1f ns por paso", ns);
+            }
+            printf("\n");
+        }
+        VERIFICAR(fallas[1] <= fallas[0], "TLSF con más pedidos sin lugar que heap_4");
+    }
+    return 0;
+}
@@ -0,0 +1,343 @@
+/*
+ * QMPool con varios hilos tomando y devolviendo bloques a la vez por get/put, getN/putN y magazines propios: ningún
+ * bloque puede estar en manos de dos hilos y al final están todos libres y distintos. Con host_ruido los hilos ceden
+ * el procesador antes de cada compare-and-swap, como una interrupción en el medio. Se compila con y sin
+ * QF_MPOOL_LOCKFREE; con "bench" mide get/put, magGet/magPut y getN/putN de cada versión sin contención, en tiempo
+ * y en secciones críticas (interrupciones enmascaradas en el LPC4337) por bloque, y el arranque de un pool grande.
+ * También se compila con QF_MPOOL_LAZY, y con QF_MPOOL_TELEMETRY, donde además se verifican los contadores, los
+ * dueños y el histograma con un reloj que maneja la prueba.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <stdint.h>
+#if QF_MPOOL_TELEMETRY
+static uint32_t reloj;
+#define QF_MPOOL_TIMESTAMP()    reloj
+#endif
+#include "../src/qf_mem.c"
+#include "host.h"
+
+#if (QF_MPOOL_LOCKFREE != 0) && (QF_MPOOL_LAZY != 0)
+#define VERSION "lock-free perezoso"
+#elif (QF_MPOOL_LOCKFREE != 0)
+#define VERSION "lock-free"
+#elif (QF_MPOOL_LAZY != 0)
+#define VERSION "sección crítica perezoso"
+#else
+#define VERSION "sección crítica"
+#endif
+#if QF_MPOOL_TELEMETRY
+#define TELEMETRIA " con telemetría"
+#else
+#define TELEMETRIA ""
+#endif
+
+#define HILOS           4
+#define BLOQUES         24
+#define TAM_BLOQUE      16
+#define SEGUNDOS        2
+#define BLOQUES_GRANDE  60000   // Pool grande para medir QMPool_init y el primer QMPool_get
+
+static QMPool pool;
+static uint64_t memoria[BLOQUES * TAM_BLOQUE / sizeof(uint64_t)];
+static uint64_t memoria_grande[BLOQUES_GRANDE * TAM_BLOQUE / sizeof(uint64_t)];
+#if QF_MPOOL_TELEMETRY
+static QMPoolBlockInfo info[BLOQUES];
+#endif
+static volatile bool fin;
+static uint64_t operaciones[HILOS];
+
+static void marcar(void* b, uint32_t marca)
+{
+    uint32_t* p = b;
+    for (uint32_t i = 0; i < TAM_BLOQUE / sizeof(uint32_t); i++)
+        p[i] = marca;
+}
+
+static void comprobar(void* b, uint32_t marca)
+{
+    uint32_t* p = b;
+    VERIFICAR(((uint8_t*)b >= (uint8_t*)memoria) && ((uint8_t*)b < (uint8_t*)memoria + sizeof(memoria)),
+              "bloque %p fuera del pool", b);
+    for (uint32_t i = 0; i < TAM_BLOQUE / sizeof(uint32_t); i++)
+        VERIFICAR(p[i] == marca, "bloque %p en manos de otro hilo: %08x en lugar de %08x", b, p[i], marca);
+}
+
+static void* hilo(void* arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+    QMPoolMag mag = { .n = 0 };
+    void* tenidos[QF_MPOOL_MAG_SIZE + 4];
+    uint32_t n;
+    uint32_t marca;
+
+    host_semilla(id + 1);
+    while (!fin)
+    {
+        marca = (id << 24) | (uint32_t)(operaciones[id] & 0xFFFFFF);
+        switch (host_rand() % 3)
+        {
+            case 0:
+            n = 0;
+            for (uint32_t k = host_rand() % 4 + 1; k > 0; k--)
+                if ((tenidos[n] = QMPool_get(&pool, 0)) != NULL)
+                    n++;
+            break;
+            case 1:
+            n = QMPool_getN(&pool, tenidos, (unsigned short)(host_rand() % 4 + 1), 0);
+            break;
+            default:
+            n = 0;
+            for (uint32_t k = host_rand() % 4 + 1; k > 0; k--)
+                if ((tenidos[n] = QMPool_magGet(&pool, &mag, 0)) != NULL)
+                    n++;
+            break;
+        }
+        for (uint32_t k = 0; k < n; k++)
+            marcar(tenidos[k], marca + k);
+        if (host_rand() % 8 == 0)
+            sched_yield();
+        for (uint32_t k = 0; k < n; k++)
+            comprobar(tenidos[k], marca + k);
+        switch (host_rand() % 3)
+        {
+            case 0:
+            for (uint32_t k = 0; k < n; k++)
+                QMPool_put(&pool, tenidos[k]);
+            break;
+            case 1:
+            QMPool_putN(&pool, tenidos, (unsigned short)n);
+            break;
+            default:
+            for (uint32_t k = 0; k < n; k++)
+                QMPool_magPut(&pool, &mag, tenidos[k]);
+            break;
+        }
+        operaciones[id] += n;
+    }
+    QMPool_magFlush(&pool, &mag);
+    return NULL;
+}
+
+static void probar(void)
+{
+    pthread_t hilos[HILOS];
+    void* todos[BLOQUES + 1];
+    uint64_t total = 0;
+
+    QMPool_init(&pool, memoria, sizeof(memoria), TAM_BLOQUE);
+    VERIFICAR(pool.nTot == BLOQUES, "%u bloques", pool.nTot);
+#if QF_MPOOL_TELEMETRY
+    QMPool_attachInfo(&pool, info);
+#endif
+    host_ruido = 1;
+    for (uint32_t i = 0; i < HILOS; i++)
+        pthread_create(&hilos[i], NULL, hilo, (void*)(uintptr_t)i);
+    usleep(SEGUNDOS * 1000000);
+    fin = true;
+    for (uint32_t i = 0; i < HILOS; i++)
+    {
+        pthread_join(hilos[i], NULL);
+        total += operaciones[i];
+    }
+    host_ruido = 0;
+
+    // Todos los bloques volvieron y la lista libre los tiene a todos, una vez cada uno
+    VERIFICAR(pool.nFree == BLOQUES, "%u bloques libres de %u", pool.nFree, BLOQUES);
+    for (uint32_t i = 0; i < BLOQUES; i++)
+    {
+        todos[i] = QMPool_get(&pool, 0);
+        VERIFICAR(todos[i] != NULL, "la lista libre tiene %u bloques", i);
+        marcar(todos[i], 0xB10C0000 | i);
+    }
+    VERIFICAR(QMPool_get(&pool, 0) == NULL, "la lista libre tiene bloques de más");
+    for (uint32_t i = 0; i < BLOQUES; i++)
+        comprobar(todos[i], 0xB10C0000 | i);
+#if QF_MPOOL_TELEMETRY
+    // Los contadores con varios hilos a la vez: los BLOQUES recién tomados son los únicos en manos de alguien
+    VERIFICAR(pool.telemetry.nGet - pool.telemetry.nPut == BLOQUES, "nGet %u, nPut %u", pool.telemetry.nGet,
+              pool.telemetry.nPut);
+    VERIFICAR(pool.telemetry.nOwned[0] == BLOQUES, "dueño 0 con %u bloques", pool.telemetry.nOwned[0]);
+    QMPool_putN(&pool, todos, BLOQUES);
+    VERIFICAR((pool.telemetry.nGet == pool.telemetry.nPut) && (pool.telemetry.nOwned[0] == 0), "nGet %u, nPut %u",
+              pool.telemetry.nGet, pool.telemetry.nPut);
+#endif
+    printf("QMPool %s%s: %u hilos, %llu bloques tomados y devueltos\n", VERSION, TELEMETRIA, HILOS,
+           (unsigned long long)total);
+}
+
+#if QF_MPOOL_TELEMETRY
+static void verificar_duenos(const uint32_t* esperados)
+{
+    for (uint32_t d = 0; d < QF_MPOOL_OWNERS; d++)
+        VERIFICAR(pool.telemetry.nOwned[d] == esperados[d], "dueño %u con %u bloques en lugar de %u", d,
+                  pool.telemetry.nOwned[d], esperados[d]);
+}
+
+/* Contadores, dueños e histograma de tiempos en manos de alguien, sin hilos y con el reloj de la prueba */
+static void probar_telemetria(void)
+{
+    QMPoolMag mag = { .n = 0 };
+    void* b[BLOQUES];
+    uint32_t n = 0;
+    uint32_t duenos[QF_MPOOL_OWNERS] = { 0 };
+    uint32_t hist[QF_MPOOL_HIST_BINS] = { 0 };
+    pid_t hijo;
+    int estado;
+
+    QMPool_init(&pool, memoria, sizeof(memoria), TAM_BLOQUE);
+    QMPool_attachInfo(&pool, info);
+    reloj = 1000;
+
+    // Los bloques tomados de cualquier forma son del dueño 0; los que quedan en el magazine siguen libres
+    for (; n < 10; n++)
+        b[n] = QMPool_get(&pool, 0);
+    n += QMPool_getN(&pool, &b[n], 4, 0);
+    for (uint32_t k = 0; k < 3; k++)
+        b[n++] = QMPool_magGet(&pool, &mag, 0);
+    VERIFICAR(n == 17, "%u bloques", n);
+    VERIFICAR(pool.telemetry.nGet - pool.telemetry.nPut == n, "nGet %u - nPut %u en lugar de %u", pool.telemetry.nGet,
+              pool.telemetry.nPut, n);
+    duenos[0] = n;
+    verificar_duenos(duenos);
+
+    // Sin lugar para el margen pedido falla sin tomar nada
+    VERIFICAR(QMPool_get(&pool, BLOQUES) == NULL, "get con un margen mayor que los libres");
+    VERIFICAR((pool.telemetry.nFail == 1) && (pool.telemetry.nGet - pool.telemetry.nPut == n), "nFail %u",
+              pool.telemetry.nFail);
+
+    // Cada etapa cuenta sus bloques y su máximo
+    for (uint32_t k = 0; k < 5; k++)
+        QMPool_setOwner(&pool, b[k], 3);
+    for (uint32_t k = 5; k < 7; k++)
+        QMPool_setOwner(&pool, b[k], QF_MPOOL_OWNERS - 1);
+    QMPool_setOwner(&pool, b[4], 2);
+    duenos[0] = n - 7;
+    duenos[2] = 1;
+    duenos[3] = 4;
+    duenos[QF_MPOOL_OWNERS - 1] = 2;
+    verificar_duenos(duenos);
+    VERIFICAR(pool.telemetry.nOwnedMax[3] == 5, "máximo del dueño 3: %u", pool.telemetry.nOwnedMax[3]);
+
+    // Intervalo 0 para menos de una unidad de reloj, i para 2^(i-1) a 2^i - 1 y el último para el resto
+    QMPool_put(&pool, b[0]);
+    hist[0]++;
+    reloj += 1;
+    QMPool_put(&pool, b[1]);
+    hist[1]++;
+    reloj += 2;
+    QMPool_putN(&pool, &b[2], 2);
+    hist[2] += 2;
+    reloj += 97;
+    QMPool_magPut(&pool, &mag, b[4]);
+    hist[7]++;
+    reloj += 1U << 20;
+    for (uint32_t k = 5; k < n; k++)
+        QMPool_put(&pool, b[k]);
+    hist[QF_MPOOL_HIST_BINS - 1] += n - 5;
+    for (uint32_t i = 0; i < QF_MPOOL_HIST_BINS; i++)
+        VERIFICAR(pool.telemetry.holdHist[i] == hist[i], "intervalo %u con %u en lugar de %u", i,
+                  pool.telemetry.holdHist[i], hist[i]);
+    memset(duenos, 0, sizeof(duenos));
+    verificar_duenos(duenos);
+    VERIFICAR(pool.telemetry.nGet == pool.telemetry.nPut, "nGet %u, nPut %u", pool.telemetry.nGet, pool.telemetry.nPut);
+    QMPool_magFlush(&pool, &mag);
+    VERIFICAR(pool.nFree == BLOQUES, "%u bloques libres", pool.nFree);
+
+    // Devolver dos veces el mismo bloque no puede descontar de un dueño fuera del arreglo: configASSERT
+    b[0] = QMPool_get(&pool, 0);
+    QMPool_put(&pool, b[0]);
+    hijo = fork();
+    if (hijo == 0)
+    {
+        QMPool_put(&pool, b[0]);
+        _exit(0);
+    }
+    VERIFICAR((waitpid(hijo, &estado, 0) == hijo) && WIFSIGNALED(estado) && (WTERMSIG(estado) == SIGABRT),
+              "devolver dos veces el bloque no disparó configASSERT");
+    printf("QMPool %s%s: contadores, dueños e histograma\n", VERSION, TELEMETRIA);
+}
+#endif
+
+/* ns por bloque de cada forma de tomar y devolver bloques sin contención, el mínimo de varias rondas */
+#define MEDIR(nombre, cuerpo)                                                   \
+    do {                                                                        \
+        double ns = 1e9;                                                        \
+        for (uint32_t ronda = 0; ronda < 30; ronda++)                           \
+        {                                                                       \
+            unsigned long criticas = host_criticas_isr;                         \
+            uint64_t t0 = host_ns();                                            \
+            for (uint32_t i = 0; i < N; i++)                                    \
+            {                                                                   \
+                cuerpo;                                                         \
+                __asm__ volatile("" : : : "memory");                            \
+            }                                                                   \
+            double t = (double)(host_ns() - t0) / N / por_vuelta;               \
+            if (t < ns)                                                         \
+                ns = t;                                                         \
+            criticas_bloque = (double)(host_criticas_isr - criticas) / N / por_vuelta; \
+        }                                                                       \
+        printf("QMPool %s: %-14s %5.1f ns y %.2f secciones críticas por bloque\n", \
+               VERSION, nombre, ns, criticas_bloque);                           \
+    } while (0)
+
+/* QMPool_init y el primer QMPool_get de un pool de BLOQUES_GRANDE bloques, el mínimo de varias rondas. Con
+   QF_MPOOL_LAZY el arranque no recorre los bloques y el primero se corta del almacenamiento sin usar. */
+static void medir_arranque(void)
+{
+    QMPool grande;
+    double init_ns = 1e12;
+    double get_ns = 1e12;
+    void* b;
+
+    for (uint32_t ronda = 0; ronda < 20; ronda++)
+    {
+        uint64_t t0 = host_ns();
+        QMPool_init(&grande, memoria_grande, sizeof(memoria_grande), TAM_BLOQUE);
+        uint64_t t1 = host_ns();
+        b = QMPool_get(&grande, 0);
+        uint64_t t2 = host_ns();
+        VERIFICAR((b != NULL) && (grande.nTot == BLOQUES_GRANDE) && (grande.nFree == BLOQUES_GRANDE - 1),
+                  "pool grande: %u bloques, %u libres", grande.nTot, grande.nFree);
+        if (t1 - t0 < init_ns)
+            init_ns = (double)(t1 - t0);
+        if (t2 - t1 < get_ns)
+            get_ns = (double)(t2 - t1);
+    }
+    printf("QMPool %s: %u bloques, QMPool_init %.0f ns, primer get %.0f ns\n", VERSION, BLOQUES_GRANDE,
+           init_ns, get_ns);
+}
+
+static void medir(void)
+{
+    const uint32_t N = 100000;
+    QMPoolMag mag = { .n = 0 };
+    void* b[4];
+    uint32_t por_vuelta;
+    double criticas_bloque;
+
+    QMPool_init(&pool, memoria, sizeof(memoria), TAM_BLOQUE);
+    por_vuelta = 1;
+    MEDIR("get + put", b[0] = QMPool_get(&pool, 0); QMPool_put(&pool, b[0]));
+    MEDIR("magGet + magPut", b[0] = QMPool_magGet(&pool, &mag, 0); QMPool_magPut(&pool, &mag, b[0]));
+    QMPool_magFlush(&pool, &mag);
+    por_vuelta = 4;
+    MEDIR("getN + putN x4", QMPool_getN(&pool, b, 4, 0); QMPool_putN(&pool, b, 4));
+    VERIFICAR(pool.nFree == BLOQUES, "%u bloques libres de %u", pool.nFree, BLOQUES);
+    medir_arranque();
+}
+
+int main(int argc, char** argv)
+{
+    probar();
+#if QF_MPOOL_TELEMETRY
+    probar_telemetria();
+#endif
+    if ((argc > 1) && (strcmp(argv[1], "bench") == 0))
+        medir();
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*
+ * sf_mensaje_escribible y sf_mensaje_corto con un frame compartido por un suscriptor: la copia, la falta de lugar
+ * para la copia sin esperar, y el error en una respuesta corta hasta que sale por la UART.
+ */
+#include "../src/separacion_frames.c"
+#include "../src/pool_clases.c"
+#include "../src/qf_mem.c"
+#include "../src/objeto.c"
+#include "../src/crc8.c"
+#include "../src/arena_rx.c"
+#include "../src/sf_perfil.c"
+#include "host.h"
+
+/* Arma "(ID datos CRC)" con el CRC correcto */
+static uint32_t frame_armar(uint8_t* f, const char* id, const char* datos)
+{
+    uint32_t n = 0;
+    uint8_t crc;
+
+    f[n++] = SOM_BYTE;
+    memcpy(&f[n], id, LEN_ID);
+    n += LEN_ID;
+    memcpy(&f[n], datos, strlen(datos));
+    n += strlen(datos);
+    crc = crc8_calc(0, &f[INDICE_INICIO_ID], n - INDICE_INICIO_ID);
+    f[n++] = sf_codificar_ascii(crc >> SHIFT_4b);
+    f[n++] = sf_codificar_ascii(crc & 0x0F);
+    f[n++] = EOM_BYTE;
+    return n;
+}
+
+static tMensaje* frame_recibir(sf_t* sf, const char* id, const char* datos)
+{
+    uint8_t f[MSG_MAX_SIZE];
+    uint32_t n = frame_armar(f, id, datos);
+    BaseType_t w = pdFALSE;
+    tMensaje* m;
+
+    sf_recibir_bytes(sf, f, n, &w);
+    VERIFICAR(uxQueueMessagesWaiting(sf->ptr_objeto1->cola) == 1, "no llegó el frame %s", datos);
+    sf_mensaje_recibir(sf, &m);
+    return m;
+}
+
+/* Transmite todo lo encolado, como la ISR de TX con la FIFO siempre vacía */
+static void transmitir(sf_t* sf)
+{
+    host_tx_n = 0;
+    while (uxQueueMessagesWaiting(sf->ptr_objeto2->cola) != 0 || sf->tx_indice != 0)
+        sf_tx_isr(sf);
+}
+
+int main(void)
+{
+    sf_t* sf = sf_crear();
+    tMensaje* m;
+    tMensaje* r;
+    tMensaje* cortos[SF_RESPUESTAS_CORTAS];
+    uint8_t esperado[MSG_MAX_SIZE];
+    uint64_t t0;
+
+    VERIFICAR(sf_init(sf, UART_USB, 115200), "sf_init");
+
+    /* Sin nadie más, el mismo evento */
+    m = frame_recibir(sf, "0A1B", "CholaMundo");
+    VERIFICAR(sf_mensaje_escribible(sf, m) == m, "con una referencia tiene que devolver el mismo evento");
+    objeto_evento_liberar(m);
+
+#if !SF_RX_ARENA
+    /* Con un suscriptor, una copia con los mismos bytes */
+    m = frame_recibir(sf, "0A1B", "CholaMundo");
+    objeto_evento_retener(m);
+    r = sf_mensaje_escribible(sf, m);
+    VERIFICAR((r != NULL) && (r != m), "tenía que copiar");
+    VERIFICAR((r->referencias == 1) && (m->referencias == 1), "referencias %u %u", r->referencias, m->referencias);
+    VERIFICAR((r->cantidad == m->cantidad) &&
+              (memcmp(r->ptr_datos - INDICE_INICIO_MENSAJE, m->ptr_datos - INDICE_INICIO_MENSAJE,
+                      m->cantidad + INDICE_INICIO_MENSAJE) == 0), "la copia no es igual");
+    objeto_evento_liberar(r);
+    objeto_evento_liberar(m);
+
+    /* Sin bloques libres no espera: NULL y el evento sigue compartido */
+    m = frame_recibir(sf, "0A1B", "CholaMundo");
+    objeto_evento_retener(m);
+    uint8_t clase;
+    uint32_t tomados = 0;
+    while (pool_clases_get(&sf->pool_memoria, 0, NULL, &clase) != NULL)
+        tomados++;
+    t0 = host_ns();
+    VERIFICAR(sf_mensaje_escribible(sf, m) == NULL, "sin bloques no puede copiar");
+    VERIFICAR(host_ns() - t0 < 1000000, "sf_mensaje_escribible esperó");
+    VERIFICAR(m->referencias == 2, "referencias %u", m->referencias);
+    printf("sin bloques (%u tomados): sf_mensaje_escribible devuelve NULL sin esperar\n", tomados);
+#else
+    /* En la arena no hay copia */
+    m = frame_recibir(sf, "0A1B", "CholaMundo");
+    objeto_evento_retener(m);
+    t0 = host_ns();
+    VERIFICAR(sf_mensaje_escribible(sf, m) == NULL, "en la arena no hay copia");
+    VERIFICAR(host_ns() - t0 < 1000000, "sf_mensaje_escribible esperó");
+    printf("arena: sf_mensaje_escribible devuelve NULL sin esperar\n");
+#endif
+
+    /* El error sale en una respuesta corta con el ID del paquete */
+    r = sf_mensaje_corto(sf, m);
+    VERIFICAR((r != NULL) && (r != m) && (m->referencias == 1), "respuesta corta");
+    memcpy(r->ptr_datos, "E02", SF_CORTO_DATOS);
+    r->cantidad = SF_CORTO_DATOS;
+    VERIFICAR(sf->pool_cortos.nFree == SF_RESPUESTAS_CORTAS - 1, "pool de cortas %u", sf->pool_cortos.nFree);
+    sf_mensaje_procesado_encolar(sf, r);
+    transmitir(sf);
+    VERIFICAR((host_tx_n == frame_armar(esperado, "0A1B", "E02")) && (memcmp(host_tx, esperado, host_tx_n) == 0),
+              "transmitió \"%.*s\"", (int)host_tx_n, host_tx);
+    VERIFICAR(sf->pool_cortos.nFree == SF_RESPUESTAS_CORTAS, "la respuesta corta no volvió a su pool");
+    printf("respuesta corta: \"%.*s\"\n", (int)host_tx_n, host_tx);
+
+    /* Sin respuestas cortas tampoco espera */
+    objeto_evento_retener(m);
+    for (uint32_t i = 0; i < SF_RESPUESTAS_CORTAS; i++)
+    {
+        objeto_evento_retener(m);
+        cortos[i] = sf_mensaje_corto(sf, m);
+        VERIFICAR(cortos[i] != NULL, "respuesta corta %u", i);
+    }
+    VERIFICAR(sf_mensaje_corto(sf, m) == NULL, "no quedaban respuestas cortas");
+    for (uint32_t i = 0; i < SF_RESPUESTAS_CORTAS; i++)
+        objeto_evento_liberar(cortos[i]);
+    VERIFICAR(sf->pool_cortos.nFree == SF_RESPUESTAS_CORTAS, "pool de cortas %u", sf->pool_cortos.nFree);
+    printf("sin respuestas cortas: sf_mensaje_corto devuelve NULL\n");
+    return 0;
+}
@@ -0,0 +1,288 @@
+/*
+ * Separador de frames (R_C2_3 a R_C2_21): se inyectan ráfagas de bytes con sf_recibir_bytes y se mira qué llega a
+ * la cola de la aplicación y a la de TX. Cada caso termina con un frame centinela, así con la validación diferida
+ * se sabe que la tarea validadora ya descartó lo que tenía que descartar cuando llega el centinela. Con "bench"
+ * cuenta las secciones críticas del pool por frame en un flujo de RX y TX, que se compila con y sin SF_MAG_UART.
+ */
+#include "../src/separacion_frames.c"
+#include "../src/pool_clases.c"
+#include "../src/qf_mem.c"
+#include "../src/objeto.c"
+#include "../src/crc8.c"
+#include "../src/arena_rx.c"
+#include "../src/sf_perfil.c"
+#include "host.h"
+
+#define CENTINELA_ID    "FFFF"
+#define CENTINELA       "Centinela"
+#define ESPERA_MS       (TIMEOUT_MS * 3)
+/* Con la validación diferida cada frame con el CRC incorrecto retiene su bloque hasta que lo descarta la tarea
+   validadora, así que no pueden ser más que los bloques del pool */
+#define CRC_MALOS       (SF_VALIDACION_DIFERIDA ? SF_POOL_BLOQUES / 4 : 2 * N_QUEUE)
+#define BENCH_FRAMES    10000
+#define BENCH_RAFAGA    6       // Frames por ráfaga como máximo, antes de que la aplicación los conteste
+
+/* Arma "(ID datos CRC)" con el CRC correcto */
+static uint32_t frame_armar(uint8_t* f, const char* id, const char* datos)
+{
+    uint32_t n = 0;
+    uint8_t crc;
+
+    f[n++] = SOM_BYTE;
+    memcpy(&f[n], id, LEN_ID);
+    n += LEN_ID;
+    memcpy(&f[n], datos, strlen(datos));
+    n += strlen(datos);
+    crc = crc8_calc(0, &f[INDICE_INICIO_ID], n - INDICE_INICIO_ID);
+    f[n++] = sf_codificar_ascii(crc >> SHIFT_4b);
+    f[n++] = sf_codificar_ascii(crc & 0x0F);
+    f[n++] = EOM_BYTE;
+    return n;
+}
+
+static void inyectar(sf_t* sf, const uint8_t* bytes, uint32_t n)
+{
+    BaseType_t w = pdFALSE;
+
+    VERIFICAR(sf_recibir_bytes(sf, bytes, n, &w) == n, "la recepción se detuvo");
+}
+
+static void inyectar_texto(sf_t* sf, const char* texto)
+{
+    inyectar(sf, (const uint8_t*)texto, strlen(texto));
+}
+
+static void inyectar_frame(sf_t* sf, const char* id, const char* datos)
+{
+    uint8_t f[2 * MSG_MAX_SIZE];
+
+    inyectar(sf, f, frame_armar(f, id, datos));
+}
+
+/* Arma un frame que termina en un solo dígito hexa antes del EOM, con los datos elegidos para que el CRC sea
+   correcto si se tomara como CRC el último byte de los datos y ese dígito. Sólo lo descarta la tabla de transiciones */
+static uint32_t frame_un_digito(uint8_t* f)
+{
+    char datos[32];
+    uint32_t n;
+    uint8_t crc;
+
+    for (uint32_t i = 0; ; i++)
+    {
+        n = sprintf(datos, "CholaMundo%uG", i);
+        memcpy(f, "(0A1B", LEN_SOM + LEN_ID);
+        memcpy(f + LEN_SOM + LEN_ID, datos, n);
+        n += LEN_SOM + LEN_ID;
+        crc = crc8_calc(0, &f[INDICE_INICIO_ID], n - 1 - INDICE_INICIO_ID);
+        // 'G' decodifica a 16, que desplazado queda fuera del byte: el CRC leído es sólo el dígito
+        if (crc <= 0x0F)
+            break;
+    }
+    f[n++] = sf_codificar_ascii(crc);
+    f[n++] = EOM_BYTE;
+    return n;
+}
+
+/* Inyecta el centinela y verifica que antes que él lleguen a la aplicación exactamente los frames esperados, "ID"
+   seguido de los datos. Nada tiene que llegar a la cola de TX y todos los bloques tienen que volver al pool. */
+static void verificar(sf_t* sf, const char* caso, const char* const* esperados, uint32_t cant)
+{
+    tMensaje* m;
+    uint32_t llegados = 0;
+
+    inyectar_frame(sf, CENTINELA_ID, CENTINELA);
+    for (;;)
+    {
+        sf_mensaje_recibir(sf, &m);
+        if ((m->cantidad == strlen(CENTINELA)) && (memcmp(m->ptr_datos - LEN_ID, CENTINELA_ID CENTINELA,
+                                                          LEN_ID + m->cantidad) == 0))
+        {
+            objeto_evento_liberar(m);
+            break;
+        }
+        VERIFICAR(llegados < cant, "%s: llegó de más \"%.*s\"", caso, (int)(LEN_ID + m->cantidad), m->ptr_datos - LEN_ID);
+        VERIFICAR((LEN_ID + m->cantidad == strlen(esperados[llegados])) &&
+                  (memcmp(m->ptr_datos - LEN_ID, esperados[llegados], LEN_ID + m->cantidad) == 0),
+                  "%s: llegó \"%.*s\" en lugar de \"%s\"", caso, (int)(LEN_ID + m->cantidad), m->ptr_datos - LEN_ID,
+                  esperados[llegados]);
+        llegados++;
+        objeto_evento_liberar(m);
+    }
+    VERIFICAR(llegados == cant, "%s: llegaron %u de %u frames", caso, llegados, cant);
+    VERIFICAR(uxQueueMessagesWaiting(sf->ptr_objeto1->cola) == 0, "%s: quedaron frames en la cola", caso);
+    VERIFICAR(uxQueueMessagesWaiting(sf->ptr_objeto2->cola) == 0, "%s: el separador transmitió", caso);
+    VERIFICAR(sf->pool_eventos.nFree == SF_EVENTOS, "%s: eventos libres %u", caso, sf->pool_eventos.nFree);
+    VERIFICAR(!sf->out_of_memory && (sf->bloques_en_uso == 1), "%s: bloques en uso %u", caso, sf->bloques_en_uso);
+    printf("%-36s %u frames\n", caso, llegados);
+}
+
+/* Transmite todo lo encolado, como la ISR de TX con la FIFO siempre vacía */
+static void transmitir(sf_t* sf)
+{
+    host_tx_n = 0;
+    while (uxQueueMessagesWaiting(sf->ptr_objeto2->cola) != 0 || sf->tx_indice != 0)
+        sf_tx_isr(sf);
+}
+
+/* Secciones críticas del pool (taskENTER_CRITICAL_FROM_ISR) por frame: ráfagas de frames de 12 a MSG_MAX_SIZE bytes
+   que la aplicación contesta sobre el mismo bloque y la ISR de TX transmite. Cada frame toma un evento y al menos un
+   bloque en la ISR de RX y los devuelve en la de TX: sin los magazines son al menos cuatro secciones críticas, con
+   ellos los bloques casi nunca llegan al pool y quedan las dos del pool de eventos. */
+static void medir(sf_t* sf)
+{
+    char datos[MSG_MAX_SIZE];
+    unsigned long criticas = host_criticas_isr;
+    uint32_t frames = 0;
+    uint32_t rafaga;
+    uint32_t largo;
+    tMensaje* m;
+    double por_frame;
+
+    host_semilla(1);
+    while (frames < BENCH_FRAMES)
+    {
+        rafaga = host_rand() % BENCH_RAFAGA + 1;
+        for (uint32_t k = 0; k < rafaga; k++)
+        {
+            largo = 12 + host_rand() % (MSG_MAX_SIZE - 12 + 1);
+            datos[0] = 'C';
+            for (uint32_t i = 1; i < largo - LEN_HEADER; i++)
+                datos[i] = 'a' + host_rand() % 26;
+            datos[largo - LEN_HEADER] = '\0';
+            inyectar_frame(sf, "0A1B", datos);
+        }
+        for (uint32_t k = 0; k < rafaga; k++)
+        {
+            sf_mensaje_recibir(sf, &m);
+            sf_mensaje_procesado_encolar(sf, m);
+        }
+        transmitir(sf);
+        frames += rafaga;
+    }
+    por_frame = (double)(host_criticas_isr - criticas) / frames;
+    printf("mag_uart %s: %.2f secciones críticas del pool por frame (%u frames)\n", SF_MAG_UART ? "sí" : "no",
+           por_frame, frames);
+#if SF_MAG_UART
+    VERIFICAR(por_frame < 3.0, "con los magazines los bloques entraron al pool en más de un frame de cada uno");
+#else
+    VERIFICAR(por_frame >= 4.0, "sin los magazines menos de cuatro secciones críticas por frame");
+#endif
+}
+
+int main(int argc, char** argv)
+{
+    sf_t* sf = sf_crear();
+    uint8_t f[2 * MSG_MAX_SIZE];
+    char datos[MSG_MAX_SIZE + 1];
+    char largo[MSG_MAX_SIZE + 1];
+    uint32_t n;
+    tMensaje* m;
+
+    VERIFICAR(sf_init(sf, UART_USB, 115200), "sf_init");
+    printf("SF_TIMEOUT_MODO %s, SF_VALIDACION_DIFERIDA %d\n",
+           (SF_TIMEOUT_MODO == SF_TIMEOUT_TIMER) ? "timer" : "timestamp", SF_VALIDACION_DIFERIDA);
+
+    /* R_C2_3 a R_C2_6: un frame válido, con datos que también son ASCII hexa */
+    inyectar_frame(sf, "0A1B", "CholaMundo");
+    inyectar_frame(sf, "9F00", "C12AB");
+    verificar(sf, "frames válidos", (const char*[]){ "0A1BCholaMundo", "9F00C12AB" }, 2);
+
+    /* R_C2_4: un SOM en medio de un frame lo reinicia, en el ID, los datos o el CRC */
+    inyectar_texto(sf, "(0A");
+    inyectar_frame(sf, "0A1B", "Cuno");
+    inyectar_texto(sf, "(0A1BCholaMun");
+    inyectar_frame(sf, "0A1B", "Cdos");
+    inyectar_texto(sf, "(0A1BCholaMundo4");
+    inyectar_frame(sf, "0A1B", "Ctres");
+    inyectar_texto(sf, "(((");
+    inyectar_frame(sf, "0A1B", "Ccuatro");
+    verificar(sf, "SOM en medio del frame",
+              (const char*[]){ "0A1BCuno", "0A1BCdos", "0A1BCtres", "0A1BCcuatro" }, 4);
+
+    /* R_C2_7: entra un frame de MSG_MAX_SIZE bytes, uno de un byte más se descarta y los bytes que siguen hasta el
+       próximo SOM también, aunque terminen en un EOM detrás de dos bytes hexa */
+    memset(datos, 'x', sizeof(datos));
+    datos[0] = 'C';
+    datos[MSG_MAX_SIZE - LEN_HEADER] = '\0';
+    n = frame_armar(f, "0A1B", datos);
+    VERIFICAR(n == MSG_MAX_SIZE, "frame de %u bytes", n);
+    inyectar(sf, f, n);
+    sprintf(largo, "0A1B%s", datos);
+    datos[MSG_MAX_SIZE - LEN_HEADER] = 'x';
+    datos[MSG_MAX_SIZE - LEN_HEADER + 1] = '\0';
+    n = frame_armar(f, "0A1B", datos);
+    VERIFICAR(n == MSG_MAX_SIZE + 1, "frame de %u bytes", n);
+    inyectar(sf, f, n);
+    memset(datos, 'x', MSG_MAX_SIZE);
+    datos[MSG_MAX_SIZE] = '\0';
+    inyectar_texto(sf, "(0A1BC");
+    inyectar_texto(sf, datos);
+    inyectar_texto(sf, datos);
+    inyectar_texto(sf, "AB)");
+    inyectar_frame(sf, "0A1B", "Cdespues");
+    verificar(sf, "más de MSG_MAX_SIZE bytes", (const char*[]){ largo, "0A1BCdespues" }, 2);
+
+    /* R_C2_17 a R_C2_19: un silencio de más de TIMEOUT_MS en medio del frame lo descarta. Con el timer, vence cuando
+       corre el daemon; con la marca de tiempo, al llegar el byte siguiente */
+    n = frame_armar(f, "0A1B", "CholaMundo");
+    inyectar(sf, f, 8);
+    vTaskDelay(pdMS_TO_TICKS(ESPERA_MS));
+    host_timers_correr();
+    inyectar(sf, f + 8, n - 8);
+    inyectar(sf, f, n);
+    verificar(sf, "timeout entre bytes", (const char*[]){ "0A1BCholaMundo" }, 1);
+
+    /* R_C2_3: los cuatro bytes del ID tienen que ser ASCII hexa en mayúsculas, aunque el CRC sea correcto */
+    inyectar_frame(sf, "GA1B", "CholaMundo");
+    inyectar_frame(sf, "0G1B", "CholaMundo");
+    inyectar_frame(sf, "0AG1", "CholaMundo");
+    inyectar_frame(sf, "0A1G", "CholaMundo");
+    inyectar_frame(sf, "0a1b", "CholaMundo");
+    inyectar_frame(sf, "0A1B", "Cbien");
+    verificar(sf, "ID no hexa", (const char*[]){ "0A1BCbien" }, 1);
+
+    /* R_C2_5: el EOM tiene que llegar detrás de dos dígitos del CRC */
+    inyectar_texto(sf, "(0A1B)");
+    inyectar_texto(sf, "(0A1BF)");
+    inyectar_texto(sf, "(0A1BCholaMundoC)");
+    inyectar_texto(sf, "(0A1BCholaMundo4a)");
+    inyectar_texto(sf, "(0A1BChola)Mundo4A)");
+    inyectar(sf, f, frame_un_digito(f));
+    inyectar_frame(sf, "0A1B", "Cbien");
+    verificar(sf, "EOM sin dos dígitos de CRC", (const char*[]){ "0A1BCbien" }, 1);
+
+    /* R_C2_10 a R_C2_12: un CRC distinto descarta el frame y el bloque se reutiliza, en cualquiera de los dos dígitos */
+    for (uint32_t i = 0; i < CRC_MALOS; i++)
+    {
+        n = frame_armar(f, "0A1B", "CholaMundo");
+        f[n - 2] = (f[n - 2] == '0') ? '1' : '0';
+        inyectar(sf, f, n);
+        n = frame_armar(f, "0A1B", "CholaMundo");
+        f[n - 3] = (f[n - 3] == 'F') ? 'E' : 'F';
+        inyectar(sf, f, n);
+    }
+    inyectar_frame(sf, "0A1B", "Cbien");
+    verificar(sf, "CRC incorrecto", (const char*[]){ "0A1BCbien" }, 1);
+
+    /* R_C2_12: los bytes fuera de un frame se ignoran, también los EOM y los dígitos hexa */
+    inyectar_texto(sf, "xx)AB)\r\n");
+    inyectar_frame(sf, "0A1B", "Cuno");
+    inyectar_texto(sf, "12)zz))");
+    inyectar(sf, (const uint8_t*)"\0\xff\x80", 3);
+    inyectar_frame(sf, "0A1B", "Cdos");
+    inyectar_frame(sf, "0A1B", "Ctres");
+    verificar(sf, "basura entre frames", (const char*[]){ "0A1BCuno", "0A1BCdos", "0A1BCtres" }, 3);
+
+    /* R_C2_13 a R_C2_16: la respuesta sale sellada con su CRC y el EOM */
+    inyectar_frame(sf, "0A1B", "CholaMundo");
+    sf_mensaje_recibir(sf, &m);
+    sf_mensaje_procesado_encolar(sf, m);
+    transmitir(sf);
+    n = frame_armar(f, "0A1B", "CholaMundo");
+    VERIFICAR((host_tx_n == n) && (memcmp(host_tx, f, n) == 0), "transmitió \"%.*s\"", (int)host_tx_n, host_tx);
+    verificar(sf, "respuesta", NULL, 0);
+
+    if ((argc > 1) && (strcmp(argv[1], "bench") == 0))
+        medir(sf);
+    return 0;
+}
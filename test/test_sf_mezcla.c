@@ -0,0 +1,149 @@
+/*
+ * Frames en vuelo según la mezcla de largos: se recibe una ráfaga de frames sin que la aplicación los consuma y se
+ * cuenta cuántos llegan a la cola antes de quedarse sin bloques, con cada geometría del pool sobre los mismos
+ * POOL_SIZE bytes. La de sepa_frame_def.h no puede quedar por debajo de la de un solo tamaño salvo en las mezclas
+ * de frames largos, donde tiene que conservar al menos la mitad.
+ */
+#include "../src/separacion_frames.c"
+#include "../src/pool_clases.c"
+#include "../src/qf_mem.c"
+#include "../src/objeto.c"
+#include "../src/crc8.c"
+#include "../src/arena_rx.c"
+#include "../src/sf_perfil.c"
+#include "host.h"
+
+#define RAFAGA          40      // Frames por ráfaga, más que los bloques de cualquier geometría
+#define RAFAGAS         500
+
+typedef struct
+{
+    const char* nombre;
+    uint8_t cant_clases;
+    uint16_t tamanios[POOL_CLASES_MAX];
+    uint16_t cantidades[POOL_CLASES_MAX];
+} geometria_t;
+
+typedef struct
+{
+    const char* nombre;
+    uint32_t pct_cortos;        // Porcentaje de frames de 12 a 40 bytes, el resto entre largo_min y MSG_MAX_SIZE
+    uint32_t largo_min;
+} mezcla_t;
+
+static const uint16_t tamanios_defecto[] = SF_POOL_TAMANIOS;
+static const uint16_t cantidades_defecto[] = SF_POOL_CANTIDADES;
+
+static const geometria_t geometrias[] =
+{
+    { "10 x 200",    1, { MSG_MAX_SIZE }, { POOL_SIZE / MSG_MAX_SIZE } },
+    { "12 x 40, 16 x 56, 3 x 200", 3, { 40, 56, MSG_MAX_SIZE }, { 12, 16, 3 } },
+    { "sepa_frame_def.h",       0 },
+};
+
+static const mezcla_t mezclas[] =
+{
+    { "cortos 12-40",           100, 0 },
+    { "90% cortos",             90, LEN_HEADER_COMPLETO + 1 },
+    { "uniforme 12-200",        0, LEN_HEADER_COMPLETO + 3 },
+    { "largos 100-200",         0, 100 },
+    { "máximos 180-200",        0, 180 },
+};
+
+static uint32_t largo_azar(const mezcla_t* mezcla)
+{
+    if (host_rand() % 100 < mezcla->pct_cortos)
+        return 12 + host_rand() % 29;
+    return mezcla->largo_min + host_rand() % (MSG_MAX_SIZE - mezcla->largo_min + 1);
+}
+
+/* Un frame válido de C con letras minúsculas, del largo total pedido */
+static uint32_t frame_armar(uint8_t* f, uint32_t largo)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    uint32_t n = 0;
+    uint8_t crc;
+
+    f[n++] = SOM_BYTE;
+    for (uint32_t i = 0; i < LEN_ID; i++)
+        f[n++] = hex[host_rand() % 16];
+    f[n++] = 'C';
+    while (n < largo - LEN_CRC - LEN_EOM)
+        f[n++] = 'a' + host_rand() % 26;
+    crc = crc8_calc(0, &f[INDICE_INICIO_ID], n - INDICE_INICIO_ID);
+    f[n++] = hex[crc >> SHIFT_4b];
+    f[n++] = hex[crc & 0x0F];
+    f[n++] = EOM_BYTE;
+    return n;
+}
+
+/* Reparte el segmento del pool con otra geometría, con todos los bloques libres */
+static void geometria_aplicar(sf_t* sf, const geometria_t* g)
+{
+    for (uint8_t i = 0; i < POOL_CLASES_MAX; i++)
+        sf->mag_uart[i].n = 0;
+    if (g->cant_clases == 0)
+        VERIFICAR(pool_clases_init(&sf->pool_memoria, sf->prt_pool, POOL_SIZE, tamanios_defecto, cantidades_defecto,
+                                   SF_POOL_CANT_CLASES), "geometría de sepa_frame_def.h");
+    else
+        VERIFICAR(pool_clases_init(&sf->pool_memoria, sf->prt_pool, POOL_SIZE, g->tamanios, g->cantidades,
+                                   g->cant_clases), "geometría %s", g->nombre);
+    // El bloque en recepción era de la geometría anterior, se pide otro como en sf_init
+    sf->estado = SF_ESTADO_ESPERA;
+    sf->cantidad = 0;
+    VERIFICAR(sf_bloque_de_memoria_nuevo(sf), "bloque de recepción");
+}
+
+/* Promedio de frames en la cola al terminar cada ráfaga */
+static double en_vuelo(sf_t* sf, const geometria_t* g, const mezcla_t* mezcla, uint32_t semilla)
+{
+    uint8_t f[MSG_MAX_SIZE];
+    uint64_t total = 0;
+    BaseType_t w;
+    tMensaje* m;
+
+    host_semilla(semilla);
+    for (uint32_t r = 0; r < RAFAGAS; r++)
+    {
+        geometria_aplicar(sf, g);
+        for (uint32_t i = 0; i < RAFAGA; i++)
+            sf_recibir_bytes(sf, f, frame_armar(f, largo_azar(mezcla)), &w);
+        total += uxQueueMessagesWaiting(sf->ptr_objeto1->cola);
+        while (uxQueueMessagesWaiting(sf->ptr_objeto1->cola) != 0)
+        {
+            sf_mensaje_recibir(sf, &m);
+            objeto_evento_liberar(m);
+        }
+    }
+    return (double)total / RAFAGAS;
+}
+
+int main(void)
+{
+    const uint32_t n_geo = sizeof(geometrias) / sizeof(geometrias[0]);
+    const uint32_t n_mez = sizeof(mezclas) / sizeof(mezclas[0]);
+    sf_t* sf = sf_crear();
+    double v[sizeof(geometrias) / sizeof(geometrias[0])];
+
+    VERIFICAR(sf_init(sf, UART_USB, 115200), "sf_init");
+    printf("%-18s", "frames en vuelo");
+    for (uint32_t g = 0; g < n_geo; g++)
+        printf(" %26s", geometrias[g].nombre);
+    printf("\n");
+    for (uint32_t k = 0; k < n_mez; k++)
+    {
+        printf("%-18s", mezclas[k].nombre);
+        for (uint32_t g = 0; g < n_geo; g++)
+        {
+            v[g] = en_vuelo(sf, &geometrias[g], &mezclas[k], 1 + k);
+            printf(" %26.1f", v[g]);
+        }
+        printf("\n");
+        if (mezclas[k].largo_min < 100)
+            VERIFICAR(v[n_geo - 1] >= v[0], "%s: menos frames en vuelo que con bloques de MSG_MAX_SIZE", mezclas[k].nombre);
+        else
+            VERIFICAR(2 * v[n_geo - 1] >= v[0], "%s: menos de la mitad de frames en vuelo que con bloques de MSG_MAX_SIZE",
+                      mezclas[k].nombre);
+    }
+    return 0;
+}
@@ -0,0 +1,198 @@
+/*
+ * Perfil de los frames recibidos y geometría del pool: se graba con sf_perfil_guardar el perfil de un tráfico de
+ * frames cortos, tools/sf_pool_autotune.py lo convierte en una geometría y otro sf_init con SF_PERFIL la carga.
+ * sf_geometria_valida rechaza las geometrías que no se pueden usar, y con una así sf_init se queda con la de
+ * sepa_frame_def.h.
+ */
+#define SF_PERFIL                       1
+#define SF_PERFIL_ARCHIVO               "build/sf_perfil_geometria.txt"
+#define SF_PERFIL_HISTOGRAMA_ARCHIVO    "build/sf_perfil_histograma.txt"
+#include "../src/separacion_frames.c"
+#include "../src/pool_clases.c"
+#include "../src/qf_mem.c"
+#include "../src/objeto.c"
+#include "../src/crc8.c"
+#include "../src/arena_rx.c"
+#include "../src/sf_perfil.c"
+#include "host.h"
+
+#define RAFAGA          12      // Frames por ráfaga, entran todos en el pool de sepa_frame_def.h
+#define RAFAGAS         200
+#define PCT_CORTOS      85      // Porcentaje de frames de 12 a 30 bytes, el resto de 60 a 90
+#define PCT_RECIBIDOS   98      // Con la geometría del perfil, que dimensiona el pico con un margen y no el peor caso
+
+static uint32_t largo_azar(void)
+{
+    if (host_rand() % 100 < PCT_CORTOS)
+        return 12 + host_rand() % 19;
+    return 60 + host_rand() % 31;
+}
+
+/* Un frame válido de C con letras minúsculas, del largo total pedido */
+static uint32_t frame_armar(uint8_t* f, uint32_t largo)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    uint32_t n = 0;
+    uint8_t crc;
+
+    f[n++] = SOM_BYTE;
+    for (uint32_t i = 0; i < LEN_ID; i++)
+        f[n++] = hex[host_rand() % 16];
+    f[n++] = 'C';
+    while (n < largo - LEN_CRC - LEN_EOM)
+        f[n++] = 'a' + host_rand() % 26;
+    crc = crc8_calc(0, &f[INDICE_INICIO_ID], n - INDICE_INICIO_ID);
+    f[n++] = hex[crc >> SHIFT_4b];
+    f[n++] = hex[crc & 0x0F];
+    f[n++] = EOM_BYTE;
+    return n;
+}
+
+/* Ráfagas de frames que se reciben todos antes de soltarlos, como una aplicación que tarda en contestar. Devuelve
+   cuántos llegaron a la cola */
+static uint32_t trafico(sf_t* sf, uint32_t rafagas)
+{
+    uint8_t f[MSG_MAX_SIZE];
+    BaseType_t w = pdFALSE;
+    uint32_t recibidos = 0;
+    tMensaje* m;
+
+    for (uint32_t r = 0; r < rafagas; r++)
+    {
+        for (uint32_t i = 0; i < RAFAGA; i++)
+            sf_recibir_bytes(sf, f, frame_armar(f, largo_azar()), &w);
+        while (uxQueueMessagesWaiting(sf->ptr_objeto1->cola) != 0)
+        {
+            sf_mensaje_recibir(sf, &m);
+            objeto_evento_liberar(m);
+            recibidos++;
+        }
+    }
+    return recibidos;
+}
+
+/* El pool de sf quedó repartido con la geometría g */
+static void geometria_verificar(sf_t* sf, const sf_geometria_t* g, const char* nombre)
+{
+    VERIFICAR(sf->pool_memoria.cant_clases == g->cant_clases, "%s: %u clases", nombre, sf->pool_memoria.cant_clases);
+    for (uint8_t i = 0; i < g->cant_clases; i++)
+        VERIFICAR((pool_clases_tam(&sf->pool_memoria, i) == ((g->tamanios[i] + sizeof(void*) - 1) & ~(sizeof(void*) - 1))) &&
+                  (sf->pool_memoria.pool[i].nTot == g->cantidades[i]),
+                  "%s: clase %u de %u x %u", nombre, i, pool_clases_tam(&sf->pool_memoria, i),
+                  (unsigned)sf->pool_memoria.pool[i].nTot);
+}
+
+static uint32_t geometria_ram(const sf_geometria_t* g)
+{
+    uint32_t ram = 0;
+
+    for (uint8_t i = 0; i < g->cant_clases; i++)
+        ram += ((g->tamanios[i] + sizeof(void*) - 1) & ~(sizeof(void*) - 1)) * g->cantidades[i];
+    return ram;
+}
+
+static void geometria_escribir(const sf_geometria_t* g)
+{
+    FILE* archivo = fopen(SF_PERFIL_ARCHIVO, "w");
+
+    VERIFICAR(archivo != NULL, "no se pudo escribir %s", SF_PERFIL_ARCHIVO);
+    for (uint8_t i = 0; i < g->cant_clases; i++)
+        fprintf(archivo, "clase %u %u\n", g->tamanios[i], g->cantidades[i]);
+    fclose(archivo);
+}
+
+/* Una geometría que tiene que rechazar sf_geometria_valida, armada cambiando la de sepa_frame_def.h */
+#define RECHAZAR(nombre, cambio)                                                    \
+    do {                                                                            \
+        sf_geometria_t g = sf_geometria_defecto;                                    \
+        cambio;                                                                     \
+        VERIFICAR(!sf_geometria_valida(&g), "aceptó: %s", nombre);                  \
+        printf("rechazada: %s\n", nombre);                                          \
+    } while (0)
+
+static void rechazos(void)
+{
+    sf_geometria_t g;
+
+    VERIFICAR(sf_geometria_valida(&sf_geometria_defecto), "rechazó la geometría de sepa_frame_def.h");
+    RECHAZAR("sin clases", g.cant_clases = 0);
+    RECHAZAR("más de POOL_CLASES_MAX clases", g.cant_clases = POOL_CLASES_MAX + 1);
+    RECHAZAR("clases desordenadas", (g.tamanios[0] = 56, g.tamanios[1] = 40));
+    RECHAZAR("dos clases del mismo tamaño", g.tamanios[1] = g.tamanios[0]);
+    RECHAZAR("una clase sin bloques", g.cantidades[1] = 0);
+    RECHAZAR("la última sin bloques", g.cantidades[g.cant_clases - 1] = 0);
+    RECHAZAR("la última menor que MSG_MAX_SIZE", g.tamanios[g.cant_clases - 1] = MSG_MAX_SIZE - 8);
+    RECHAZAR("la última mayor que MSG_MAX_SIZE", g.tamanios[g.cant_clases - 1] = MSG_MAX_SIZE + 8);
+    RECHAZAR("la primera sin lugar para la respuesta", g.tamanios[0] = LEN_HEADER + SF_MARGEN_RESPUESTA - 1);
+    RECHAZAR("más que POOL_SIZE", g.cantidades[g.cant_clases - 1] = POOL_SIZE / MSG_MAX_SIZE + 1);
+
+    /* Más bloques que eventos sin pasarse de POOL_SIZE: justo en el límite pasa, con uno más no, y tampoco con más
+       bloques que N_QUEUE */
+    g.cant_clases = 2;
+    g.tamanios[0] = LEN_HEADER + SF_MARGEN_RESPUESTA;
+    g.tamanios[1] = MSG_MAX_SIZE;
+    g.cantidades[0] = SF_EVENTOS - 1;
+    g.cantidades[1] = 1;
+    VERIFICAR(g.tamanios[0] * N_QUEUE + MSG_MAX_SIZE <= POOL_SIZE, "la geometría de prueba no entra en POOL_SIZE");
+    VERIFICAR(sf_geometria_valida(&g), "rechazó %u bloques, SF_EVENTOS es %u", SF_EVENTOS, SF_EVENTOS);
+    g.cantidades[0]++;
+    VERIFICAR(!sf_geometria_valida(&g), "aceptó %u bloques, SF_EVENTOS es %u", SF_EVENTOS + 1, SF_EVENTOS);
+    printf("rechazada: más bloques que SF_EVENTOS\n");
+    g.cantidades[0] = N_QUEUE;
+    VERIFICAR(!sf_geometria_valida(&g), "aceptó %u bloques, N_QUEUE es %u", N_QUEUE + 1, N_QUEUE);
+    printf("rechazada: más bloques que N_QUEUE\n");
+}
+
+int main(void)
+{
+    sf_t* sf;
+    sf_geometria_t g;
+    char comando[512];
+    uint32_t recibidos;
+    int res;
+
+    rechazos();
+
+    /* Sin perfil guardado arranca con la geometría de sepa_frame_def.h y graba el perfil del tráfico */
+    remove(SF_PERFIL_ARCHIVO);
+    remove(SF_PERFIL_HISTOGRAMA_ARCHIVO);
+    sf = sf_crear();
+    VERIFICAR(sf_init(sf, UART_USB, 115200), "sf_init");
+    geometria_verificar(sf, &sf_geometria_defecto, "sin perfil");
+    host_semilla(1);
+    VERIFICAR(trafico(sf, RAFAGAS) == RAFAGAS * RAFAGA, "se descartaron frames con la geometría de sepa_frame_def.h");
+    VERIFICAR(sf->bloques_en_uso_max >= RAFAGA, "bloques en uso %u", sf->bloques_en_uso_max);
+    VERIFICAR(sf_perfil_guardar(sf), "no guardó el perfil");
+
+    /* La geometría recomendada para ese perfil */
+    snprintf(comando, sizeof(comando),
+             "python3 ../tools/sf_pool_autotune.py %s --presupuesto %u --eventos %u --encabezado build/sf_pool_geometria.h"
+             " --perfil-salida %s", SF_PERFIL_HISTOGRAMA_ARCHIVO, POOL_SIZE, SF_EVENTOS, SF_PERFIL_ARCHIVO);
+    res = system(comando);
+    VERIFICAR(res == 0, "%s: terminó con %d", comando, res);
+    VERIFICAR(sf_perfil_cargar(&g), "no hay geometría en %s", SF_PERFIL_ARCHIVO);
+    VERIFICAR(sf_geometria_valida(&g), "sf_pool_autotune.py recomendó una geometría que no se puede usar");
+    VERIFICAR(geometria_ram(&g) < geometria_ram(&sf_geometria_defecto), "para frames cortos recomendó %u bytes",
+              geometria_ram(&g));
+
+    /* Al arrancar de nuevo se usa, y con ella pasa casi todo el mismo tráfico */
+    sf = sf_crear();
+    VERIFICAR(sf_init(sf, UART_USB, 115200), "sf_init con el perfil");
+    geometria_verificar(sf, &g, "con el perfil");
+    recibidos = trafico(sf, RAFAGAS);
+    VERIFICAR(recibidos * 100 >= PCT_RECIBIDOS * RAFAGAS * RAFAGA, "con el perfil llegaron %u de %u frames", recibidos,
+              RAFAGAS * RAFAGA);
+    printf("con el perfil: %u bytes de pool en lugar de %u, llegaron %u de %u frames\n", geometria_ram(&g),
+           geometria_ram(&sf_geometria_defecto), recibidos, RAFAGAS * RAFAGA);
+
+    /* Con una geometría guardada que no se puede usar se queda con la de sepa_frame_def.h */
+    g = sf_geometria_defecto;
+    g.tamanios[0] = 56;
+    g.tamanios[1] = 40;
+    geometria_escribir(&g);
+    sf = sf_crear();
+    VERIFICAR(sf_init(sf, UART_USB, 115200), "sf_init con un perfil desordenado");
+    geometria_verificar(sf, &sf_geometria_defecto, "con un perfil desordenado");
+    printf("con un perfil desordenado: la geometría de sepa_frame_def.h\n");
+    return 0;
+}
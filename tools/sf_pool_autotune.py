@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+# =============================================================================
+# Copyright (c) 2021, Fernando Prokopiuk <fernandoprokopiuk@gmail.com>
+#                     Jonathan Cagua <jonathan.cagua@gmail.com>
+#                     Leandro Arrieta <leandroarrieta@gmail.com>
+# All rights reserved.
+# License: Free
+# Date: 18/10/2026
+# Version: v1.0
+# =============================================================================
+"""Recomienda la geometría del pool de memoria de separacion_frames a partir del perfil de frames recibidos.
+
+El perfil es el archivo que escribe sf_perfil_guardar: histograma de largos de frame y máximo de bloques en uso
+al mismo tiempo. Se eligen las clases de tamaño que minimizan los bytes reservados por frame y la cantidad de
+bloques de cada clase para que, con la distribución observada, nunca falte un bloque en el pico de uso. Si esa
+geometría no entra en el presupuesto o en las colas se le quitan bloques, primero del margen, y se informa la
+fracción de frames que se descartarían en el pico. Cada bloque viaja en un evento, así que tampoco puede haber más
+bloques que eventos (SF_EVENTOS).
+
+Genera el encabezado inc/sf_pool_geometria.h (se compila con SF_POOL_GEOMETRIA_GENERADA) y, con --perfil-salida, el
+archivo de geometría que lee sf_perfil_cargar al arrancar (SF_PERFIL).
+
+Uso:
+    tools/sf_pool_autotune.py perfil.txt --presupuesto 2000 --clases 3
+"""
+
+import argparse
+import itertools
+import math
+import sys
+
+ALINEACION = 8          # Múltiplo de puntero en el target y en el host
+
+
+def leer_perfil(nombre):
+    perfil = {'paso': 8, 'margen': 16, 'msg_max': 200, 'en_uso_max': 0, 'largos': {}}
+    with open(nombre) as archivo:
+        for linea in archivo:
+            campos = linea.split()
+            if not campos or campos[0].startswith('#'):
+                continue
+            if campos[0] == 'largo':
+                perfil['largos'][int(campos[1])] = int(campos[2])
+            elif campos[0] in perfil:
+                perfil[campos[0]] = int(campos[1])
+    if not perfil['largos']:
+        sys.exit('%s: el perfil no tiene frames' % nombre)
+    return perfil
+
+
+def redondear(tam):
+    return (tam + ALINEACION - 1) // ALINEACION * ALINEACION
+
+
+def elegir_clases(perfil, cant_clases):
+    """Devuelve los tamaños de bloque que minimizan los bytes reservados por frame."""
+    msg_max = perfil['msg_max']
+    # Un frame pasa a la clase siguiente al llegar a tamaño - margen bytes, se toma el largo máximo del intervalo
+    necesario = {inicio: min(msg_max, redondear(inicio + perfil['paso'] + perfil['margen']))
+                 for inicio in perfil['largos']}
+    candidatos = sorted(set(t for t in necesario.values() if t < msg_max))
+    mejor = None
+    for cant in range(min(cant_clases - 1, len(candidatos)) + 1):
+        for chicas in itertools.combinations(candidatos, cant):
+            tamanios = list(chicas) + [msg_max]
+            costo = sum(cuenta * next(t for t in tamanios if t >= necesario[inicio])
+                        for inicio, cuenta in perfil['largos'].items())
+            if mejor is None or costo < mejor[0]:
+                mejor = (costo, tamanios)
+    return mejor[1], necesario
+
+
+def elegir_cantidades(perfil, tamanios, necesario, factor):
+    """Cantidad de bloques por clase: las clases desde la i en adelante alcanzan para los frames que las necesitan.
+
+    Un frame toma un bloque de la clase que necesita o de una más grande, así que alcanza con que para cada clase
+    la suma de bloques de ella y las mayores cubra el pico de frames que no entran en las menores.
+    """
+    total = sum(perfil['largos'].values())
+    pico = max(perfil['en_uso_max'], 1)
+    cola = []
+    for i in range(len(tamanios)):
+        # Los que no entran en la clase anterior
+        menor = tamanios[i - 1] if i > 0 else 0
+        frames = sum(c for inicio, c in perfil['largos'].items() if necesario[inicio] > menor)
+        cola.append(math.ceil(pico * factor * frames / total))
+    cola[0] = max(cola[0], math.ceil(pico * factor))
+    cola[-1] = max(cola[-1], 1)
+    cantidades = []
+    for i in range(len(tamanios)):
+        siguiente = cola[i + 1] if i + 1 < len(tamanios) else 0
+        cantidades.append(max(cola[i] - siguiente, 1 if i == len(tamanios) - 1 else 0))
+    # Una clase sin bloques no sirve, se une con la siguiente
+    return [(t, c) for t, c in zip(tamanios, cantidades) if c > 0]
+
+
+def demanda_pico(perfil, tamanios, necesario):
+    """Frames de cada clase en el pico de bloques en uso, con la distribución de largos observada."""
+    total = sum(perfil['largos'].values())
+    pico = max(perfil['en_uso_max'], 1)
+    demanda = [0.0] * len(tamanios)
+    for inicio, cuenta in perfil['largos'].items():
+        clase = next(i for i, t in enumerate(tamanios) if t >= necesario[inicio])
+        demanda[clase] += pico * cuenta / total
+    return demanda
+
+
+def descarte_pico(clases, demanda):
+    """Fracción de los frames del pico que no consiguen bloque.
+
+    Los frames de una clase pueden usar bloques de las mayores, así que se reparten desde la clase más grande.
+    """
+    sobrante = 0.0
+    faltan = 0.0
+    for (_, cant), frames in reversed(list(zip(clases, demanda))):
+        sobrante += cant - frames
+        if sobrante < 0:
+            faltan -= sobrante
+            sobrante = 0.0
+    return faltan / max(sum(demanda), 1e-9)
+
+
+def ajustar_presupuesto(clases, demanda, presupuesto, eventos):
+    """Quita bloques hasta entrar en el presupuesto y en los eventos.
+
+    Cada paso quita el bloque que menos aumenta el descarte en el pico; mientras sobre margen no se descarta nada y
+    entre dos bloques igual de prescindibles se quita el más grande. La última clase conserva al menos un bloque.
+    """
+    clases = list(clases)
+    while sum(t * c for t, c in clases) > presupuesto or sum(c for _, c in clases) > eventos:
+        candidatos = []
+        for i, (tam, cant) in enumerate(clases):
+            if cant > (1 if i == len(clases) - 1 else 0):
+                prueba = clases[:i] + [(tam, cant - 1)] + clases[i + 1:]
+                candidatos.append((descarte_pico(prueba, demanda), -tam, i))
+        if not candidatos:
+            return None
+        _, _, i = min(candidatos)
+        clases[i] = (clases[i][0], clases[i][1] - 1)
+    return clases
+
+
+def escribir_encabezado(nombre, origen, clases, ram):
+    tamanios = ', '.join('MSG_MAX_SIZE' if i == len(clases) - 1 else str(t) for i, (t, _) in enumerate(clases))
+    cantidades = ', '.join(str(c) for _, c in clases)
+    with open(nombre, 'w') as archivo:
+        archivo.write('/* Generado por tools/sf_pool_autotune.py a partir de %s, no editar */\n\n' % origen)
+        archivo.write('#ifndef SF_POOL_GEOMETRIA_H_\n#define SF_POOL_GEOMETRIA_H_\n\n')
+        archivo.write('#define POOL_SIZE               %d\n' % ram)
+        archivo.write('#define SF_POOL_CANT_CLASES     %d\n' % len(clases))
+        archivo.write('#define SF_POOL_TAMANIOS        { %s }\n' % tamanios)
+        archivo.write('#define SF_POOL_CANTIDADES      { %s }\n' % cantidades)
+        archivo.write('#define SF_POOL_BLOQUES         (%s)\n' % ' + '.join(str(c) for _, c in clases))
+        archivo.write('\n#endif /* SF_POOL_GEOMETRIA_H_ */\n')
+
+
+def escribir_perfil(nombre, origen, clases):
+    with open(nombre, 'w') as archivo:
+        archivo.write('# geometría del pool generada por tools/sf_pool_autotune.py a partir de %s\n' % origen)
+        for tam, cant in clases:
+            archivo.write('clase %d %d\n' % (tam, cant))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('perfil', help='archivo escrito por sf_perfil_guardar')
+    parser.add_argument('--presupuesto', type=int, default=2000, help='bytes de RAM para el pool (POOL_SIZE)')
+    parser.add_argument('--clases', type=int, default=3, help='cantidad máxima de clases, hasta POOL_CLASES_MAX')
+    parser.add_argument('--eventos', type=int, default=28,
+                        help='eventos de frame (SF_EVENTOS, N_QUEUE - SF_RESPUESTAS_CORTAS)')
+    parser.add_argument('--factor', type=float, default=1.25, help='margen sobre el pico de bloques en uso')
+    parser.add_argument('--encabezado', default='inc/sf_pool_geometria.h', help='encabezado a generar')
+    parser.add_argument('--perfil-salida', help='archivo de geometría para sf_perfil_cargar')
+    args = parser.parse_args()
+
+    if not 1 <= args.clases <= 4:
+        sys.exit('--clases tiene que estar entre 1 y POOL_CLASES_MAX (4)')
+    perfil = leer_perfil(args.perfil)
+    tamanios, necesario = elegir_clases(perfil, args.clases)
+    clases = elegir_cantidades(perfil, tamanios, necesario, args.factor)
+    demanda = demanda_pico(perfil, [t for t, _ in clases], necesario)
+    recomendada = sum(t * c for t, c in clases)
+    # La geometría tiene que entrar en el presupuesto y en los eventos: se resigna margen y, si no alcanza, frames
+    clases = ajustar_presupuesto(clases, demanda, args.presupuesto, args.eventos)
+    if clases is None:
+        sys.exit('el presupuesto no alcanza para un bloque de %d bytes' % perfil['msg_max'])
+    clases = [(t, c) for t, c in clases if c > 0]
+    demanda = demanda_pico(perfil, [t for t, _ in clases], necesario)
+    ram = sum(t * c for t, c in clases)
+    print('pico de bloques en uso: %d, frames: %d' % (perfil['en_uso_max'], sum(perfil['largos'].values())))
+    for tam, cant in clases:
+        print('  clase %4d bytes x %3d bloques' % (tam, cant))
+    print('RAM del pool: %d bytes (presupuesto %d)' % (ram, args.presupuesto))
+    if ram < recomendada:
+        print('recortada de %d bytes para entrar en el presupuesto y en SF_EVENTOS' % recomendada)
+    print('frames descartados en el pico: %.1f %%' % (100 * descarte_pico(clases, demanda)))
+
+    escribir_encabezado(args.encabezado, args.perfil, clases, ram)
+    if args.perfil_salida:
+        escribir_perfil(args.perfil_salida, args.perfil, clases)
+
+
+if __name__ == '__main__':
+    main()